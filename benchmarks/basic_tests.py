@@ -2,9 +2,12 @@ import os
 import sys
 import shutil
 import platform
+import subprocess
+import time
 import numpy as np
 import pandas as pd
 import platform
+from datetime import datetime
 import pyemu
 
 bin_path = os.path.join("test_bin")
@@ -163,6 +166,47 @@ def glm_save_binary_test():
     pe = pyemu.ParameterEnsemble.from_binary(pst=pst,filename=os.path.join(m_d,"pest_save_binary.post.paren.jcb"))
     pe = pyemu.ObservationEnsemble.from_binary(pst=pst,filename=os.path.join(m_d, "pest_save_binary.post.obsen.jcb"))
 
+def sparse_run_storage_test():
+    model_d = "ies_10par_xsec"
+    t_d = os.path.join(model_d, "template")
+    pst = pyemu.Pst(os.path.join(t_d, "pest.pst"))
+    pst.control_data.noptmax = -1
+    pst.write(os.path.join(t_d, "pest_dense.pst"))
+    pyemu.os_utils.run("{0} pest_dense.pst".format(exe_path.replace("-ies","-glm")),cwd=t_d)
+    pst.pestpp_options["sparse_run_storage"] = True
+    pst.write(os.path.join(t_d, "pest_sparse.pst"))
+    pyemu.os_utils.run("{0} pest_sparse.pst".format(exe_path.replace("-ies","-glm")),cwd=t_d)
+
+    jco_dense = pyemu.Jco.from_binary(os.path.join(t_d,"pest_dense.jcb")).to_dataframe()
+    jco_sparse = pyemu.Jco.from_binary(os.path.join(t_d,"pest_sparse.jcb")).to_dataframe()
+    d = (jco_dense - jco_sparse).apply(np.abs)
+    print(d.max().max())
+    assert d.max().max() < 1.0e-10, d.max()
+
+
+def rmic_bulk_test():
+    # builds a small driver of the C run manager api against the libraries in ../src
+    model_d = "rmic_test"
+    t_d = os.path.join(model_d, "test")
+    if os.path.exists(t_d):
+        shutil.rmtree(t_d)
+    shutil.copytree(os.path.join(model_d,"template"),t_d)
+    libs_d = os.path.abspath(os.path.join("..","src","libs"))
+    inc_dirs = ["Eigen","common","pestpp_common",os.path.join("run_managers","abstract_base"),
+                os.path.join("run_managers","serial"),os.path.join("run_managers","yamr"),
+                os.path.join("run_managers","wrappers")]
+    lib_dirs = [(os.path.join("run_managers","wrappers"),"rm_wrappers"),(os.path.join("run_managers","yamr"),"rm_yamr"),
+                (os.path.join("run_managers","serial"),"rm_serial"),(os.path.join("run_managers","abstract_base"),"rm_abstract"),
+                ("pestpp_common","pestpp_com"),("common","common"),("opt","opt")]
+    cmd = "g++ -std=c++11 -pthread rmic_test.cpp -o rmic_test"
+    cmd += "".join([" -I{0}".format(os.path.join(libs_d,d)) for d in inc_dirs])
+    cmd += "".join([" -L{0} -l{1}".format(os.path.join(libs_d,d),l) for d,l in lib_dirs])
+    cmd += " -lpthread -lgfortran -lquadmath -ldl"
+    pyemu.os_utils.run(cmd,cwd=t_d)
+    # row major add/get, NULL par and obs buffers, non-consecutive ids and status codes - exits non-zero on failure
+    pyemu.os_utils.run(os.path.join(".","rmic_test"),cwd=t_d)
+
+
 def sweep_forgive_test():
     model_d = "ies_10par_xsec"
     local=True
@@ -197,6 +241,174 @@ def sweep_forgive_test():
     assert diff.max().max() == 0.0
 
 
+def panther_attachments_test():
+    model_d = "ies_10par_xsec"
+    local=True
+    if "linux" in platform.platform().lower() and "10par" in model_d:
+        local=False
+
+    t_d = os.path.join(model_d,"template")
+    pst = pyemu.Pst(os.path.join(t_d,"pest.pst"))
+    pe = pyemu.ParameterEnsemble.from_uniform_draw(pst,num_reals=20)
+    pe.to_csv(os.path.join(t_d,"sweep_in.csv"))
+
+    # a well file with doubled rates that only the master has - the agents get it as a run attachment
+    a_d = os.path.join(t_d,"attach")
+    if os.path.exists(a_d):
+        shutil.rmtree(a_d)
+    os.makedirs(a_d)
+    lines = open(os.path.join(t_d,"10par_xsec.wel"),'r').readlines()
+    with open(os.path.join(a_d,"10par_xsec.wel"),'w') as f:
+        for line in lines:
+            raw = line.split()
+            if len(raw) == 4:
+                line = "{0:>9s}{1:>10s}{2:>10s}{3:>14.6e}\n".format(raw[0],raw[1],raw[2],2.0 * float(raw[3]))
+            f.write(line)
+
+    pst.pestpp_options["panther_attachments"] = os.path.join("attach","10par_xsec.wel")
+    pst.write(os.path.join(t_d,"pest_attach.pst"))
+    m_d = os.path.join(model_d,"master_attach")
+    if os.path.exists(m_d):
+        shutil.rmtree(m_d)
+    pyemu.os_utils.start_workers(t_d, exe_path.replace("-ies","-swp"), "pest_attach.pst", 5, master_dir=m_d,
+                           worker_root=model_d,local=local,port=port)
+    df1 = pd.read_csv(os.path.join(m_d, "sweep_out.csv"),index_col=0)
+
+    # the same sweep run in place with the doubled rates
+    r_d = os.path.join(model_d,"attach_ref")
+    if os.path.exists(r_d):
+        shutil.rmtree(r_d)
+    shutil.copytree(t_d,r_d)
+    shutil.copy2(os.path.join(a_d,"10par_xsec.wel"),os.path.join(r_d,"10par_xsec.wel"))
+    pst.pestpp_options.pop("panther_attachments")
+    pst.write(os.path.join(r_d,"pest_attach.pst"))
+    pyemu.os_utils.run("{0} pest_attach.pst".format(exe_path.replace("-ies","-swp")),cwd=r_d)
+    df2 = pd.read_csv(os.path.join(r_d, "sweep_out.csv"),index_col=0)
+    diff = (df1 - df2).apply(np.abs)
+    print(diff.max())
+    assert diff.max().max() < 1.0e-6, diff.max()
+
+    # the master's copy of the model files is untouched
+    assert open(os.path.join(m_d,"10par_xsec.wel"),'r').readlines() == lines
+
+
+def panther_attachment_retry_test():
+    model_d = "ies_10par_xsec"
+    t_d = os.path.join(model_d,"template")
+    pst = pyemu.Pst(os.path.join(t_d,"pest.pst"))
+    pe = pyemu.ParameterEnsemble.from_uniform_draw(pst,num_reals=10)
+    pe.to_csv(os.path.join(t_d,"sweep_in.csv"))
+    a_d = os.path.join(t_d,"attach")
+    if os.path.exists(a_d):
+        shutil.rmtree(a_d)
+    os.makedirs(a_d)
+    shutil.copy2(os.path.join(t_d,"10par_xsec.wel"),os.path.join(a_d,"10par_xsec.wel"))
+    pst.pestpp_options["panther_attachments"] = os.path.join("attach","10par_xsec.wel")
+    pst.pestpp_options["max_run_fail"] = 2
+    pst.write(os.path.join(t_d,"pest_attach_retry.pst"))
+
+    # master <- relay <- two local agents.  Both local agents cache the attachment, but
+    # agent_0 fails every run, so each of its failures has to be retried on agent_1
+    dirs = {}
+    for name in ["master","relay","agent_0","agent_1"]:
+        dirs[name] = os.path.join(model_d,"attach_retry_{0}".format(name))
+        if os.path.exists(dirs[name]):
+            shutil.rmtree(dirs[name])
+        shutil.copytree(t_d,dirs[name])
+    with open(os.path.join(dirs["agent_0"],"forward_run_fail.py"),'w') as f:
+        f.write("open('fail_count.txt','a').write('fail\\n')\n")
+        f.write("raise Exception('failing on purpose')\n")
+    pst.model_command = ["python forward_run_fail.py"]
+    pst.write(os.path.join(dirs["agent_0"],"pest_attach_retry.pst"))
+
+    relay_port = port + 1
+    swp = os.path.abspath(exe_path.replace("-ies","-swp"))
+    procs = [subprocess.Popen([swp,"pest_attach_retry.pst","/h",":{0}".format(port)],cwd=dirs["master"])]
+    procs.append(subprocess.Popen([swp,"pest_attach_retry.pst","/h","localhost:{0}".format(port),
+                                   "/relay",":{0}".format(relay_port),"2"],cwd=dirs["relay"]))
+    for name in ["agent_0","agent_1"]:
+        procs.append(subprocess.Popen([swp,"pest_attach_retry.pst","/h","localhost:{0}".format(relay_port)],
+                                      cwd=dirs[name]))
+    procs[0].wait()
+    for p in procs[1:]:
+        p.kill()
+        p.wait()
+
+    df = pd.read_csv(os.path.join(dirs["master"], "sweep_out.csv"),index_col=0)
+    print(df.failed_flag)
+    n_fail = len(open(os.path.join(dirs["agent_0"],"fail_count.txt"),'r').readlines())
+    assert n_fail > 0, n_fail
+    assert df.shape[0] == pe.shape[0], df.shape
+    # a retry never goes back to the agent that failed it, even though that agent holds the blob
+    assert df.failed_flag.sum() == 0, df.failed_flag
+
+
+def panther_tail_speculation_test():
+    model_d = "ies_10par_xsec"
+    t_d = os.path.join(model_d,"template")
+    pst = pyemu.Pst(os.path.join(t_d,"pest.pst"))
+    pe = pyemu.ParameterEnsemble.from_uniform_draw(pst,num_reals=10)
+    pe.to_csv(os.path.join(t_d,"sweep_in.csv"))
+    pst.pestpp_options["panther_tail_speculation"] = True
+    pst.write(os.path.join(t_d,"pest_tail.pst"))
+
+    # serial reference
+    s_d = os.path.join(model_d,"tail_serial")
+    if os.path.exists(s_d):
+        shutil.rmtree(s_d)
+    shutil.copytree(t_d,s_d)
+    pyemu.os_utils.run("{0} pest_tail.pst".format(exe_path.replace("-ies","-swp")),cwd=s_d)
+
+    # agent_0 connects first and stalls on its first run, so once the other
+    # agents have drained the queue that run has to be duplicated on an idle agent
+    slow_secs = 120
+    dirs = {}
+    for name in ["master","agent_0","agent_1","agent_2"]:
+        dirs[name] = os.path.join(model_d,"tail_{0}".format(name))
+        if os.path.exists(dirs[name]):
+            shutil.rmtree(dirs[name])
+        shutil.copytree(t_d,dirs[name])
+    with open(os.path.join(dirs["agent_0"],"forward_run_slow.py"),'w') as f:
+        f.write("import os,time\n")
+        f.write("time.sleep({0})\n".format(slow_secs))
+        f.write("open('slow_done.txt','w').write('done\\n')\n")
+        f.write("os.system('mfnwt 10par_xsec.nam')\n")
+    pst.model_command = ["python forward_run_slow.py"]
+    pst.write(os.path.join(dirs["agent_0"],"pest_tail.pst"))
+
+    swp = os.path.abspath(exe_path.replace("-ies","-swp"))
+    start = time.time()
+    procs = [subprocess.Popen([swp,"pest_tail.pst","/h",":{0}".format(port)],cwd=dirs["master"])]
+    time.sleep(1)
+    procs.append(subprocess.Popen([swp,"pest_tail.pst","/h","localhost:{0}".format(port)],cwd=dirs["agent_0"]))
+    time.sleep(2)
+    for name in ["agent_1","agent_2"]:
+        procs.append(subprocess.Popen([swp,"pest_tail.pst","/h","localhost:{0}".format(port)],cwd=dirs[name]))
+    procs[0].wait()
+    elapsed = time.time() - start
+    for p in procs[1:]:
+        p.kill()
+        p.wait()
+    print(elapsed)
+    assert elapsed < slow_secs, elapsed
+
+    # a duplicate of the stalled run was started...
+    rmr = open(os.path.join(dirs["master"],"pest_tail.rmr"),'r').read()
+    assert "speculative tail run" in rmr, rmr
+    # ...the copy that finished first was kept...
+    df = pd.read_csv(os.path.join(dirs["master"], "sweep_out.csv"),index_col=0)
+    assert df.shape[0] == pe.shape[0], df.shape
+    assert df.failed_flag.sum() == 0, df.failed_flag
+    df_s = pd.read_csv(os.path.join(s_d, "sweep_out.csv"),index_col=0).set_index("input_run_id")
+    df = df.set_index("input_run_id").loc[df_s.index,:]
+    diff = (df.loc[:,pst.obs_names].values - df_s.loc[:,pst.obs_names].values)
+    print(np.abs(diff).max())
+    assert np.abs(diff).max() < 1.0e-6, np.abs(diff).max()
+    # ...and the stalled copy was killed before it could finish
+    assert "reason: completed on alternative node" in rmr, rmr
+    assert not os.path.exists(os.path.join(dirs["agent_0"],"slow_done.txt"))
+
+
 def inv_regul_test():
     model_d = "ies_10par_xsec"
     local=True
@@ -764,6 +976,544 @@ def tplins1_test():
 
 
 
+def tplins_compiled_test():
+    model_d = "tplins_test_1"
+    local=True
+    if "linux" in platform.platform().lower():
+        local=False
+    t_d = os.path.join(model_d, "test_compiled")
+    if os.path.exists(t_d):
+        shutil.rmtree(t_d)
+    shutil.copytree(os.path.join(model_d,"template"),t_d)
+    pst = pyemu.Pst(os.path.join(t_d,"pest.pst"))
+    pst.control_data.noptmax = 0
+    pst.write(os.path.join(t_d,"pest.pst"))
+
+    # the serial run manager interprets the instruction file line by line on every read
+    pyemu.os_utils.run("{0} pest.pst".format(exe_path.replace("-ies","-glm")),cwd=t_d)
+    res1 = pyemu.Pst(os.path.join(t_d,"pest.pst")).res
+
+    # persistent agents compile the instruction file once and reuse it
+    pst.pestpp_options["panther_agent_persistent"] = True
+    pst.write(os.path.join(t_d,"pest_compiled.pst"))
+    m_d = os.path.join(model_d,"master_compiled")
+    if os.path.exists(m_d):
+        shutil.rmtree(m_d)
+    pyemu.os_utils.start_workers(t_d, exe_path.replace("-ies","-glm"), "pest_compiled.pst", 2, master_dir=m_d,
+                           worker_root=model_d,local=local,port=port)
+    res2 = pyemu.Pst(os.path.join(m_d,"pest_compiled.pst")).res
+    d = (res1.modelled - res2.loc[res1.index,"modelled"]).apply(np.abs)
+    print(d.max())
+    assert d.max() == 0.0, d
+
+
+def array_output_file_test():
+    model_d = "array_output_test"
+    t_d = os.path.join(model_d, "template")
+    if os.path.exists(t_d):
+        shutil.rmtree(t_d)
+    os.makedirs(t_d)
+    par_names = ["p1","p2"]
+    with open(os.path.join(t_d,"in.dat.tpl"),'w') as f:
+        f.write("ptf ~\n")
+        for par_name in par_names:
+            f.write("{0}  ~     {0}      ~\n".format(par_name))
+
+    # 10 doubles after a 16 byte header and the same values as a 2 x 5 csv with a header line
+    with open(os.path.join(t_d,"forward_run.py"),'w') as f:
+        f.write("import numpy as np\n")
+        f.write("vals = np.loadtxt('in.dat',usecols=[1])\n")
+        f.write("arr = vals[0] * np.arange(1,11) + vals[1]\n")
+        f.write("with open('out.bin','wb') as f:\n")
+        f.write("    f.write(b'0123456789abcdef')\n")
+        f.write("    arr.astype(np.float64).tofile(f)\n")
+        f.write("np.savetxt('out.csv',arr.reshape(2,5),delimiter=',',header='a,b,c,d,e',comments='')\n")
+
+    bin_names,csv_names = [],[]
+    with open(os.path.join(t_d,"out.bin.paf"),'w') as f:
+        f.write("paf binary 16\n")
+        for i in range(1,11):
+            bin_names.append("b{0:02d}".format(i))
+            f.write("{0} {1}\n".format(bin_names[-1],i))
+    with open(os.path.join(t_d,"out.csv.paf"),'w') as f:
+        f.write("paf csv 1\n")
+        for r in range(1,3):
+            for c in range(1,6):
+                csv_names.append("c{0}_{1}".format(r,c))
+                f.write("{0} {1} {2}\n".format(csv_names[-1],r,c))
+
+    pst = pyemu.Pst.from_par_obs_names(par_names=par_names,obs_names=bin_names+csv_names)
+    pst.parameter_data.loc[:,"partrans"] = "none"
+    pst.parameter_data.loc["p1","parval1"] = 2.0
+    pst.parameter_data.loc["p2","parval1"] = 0.5
+    pst.model_input_data = pd.DataFrame({"pest_file":["in.dat.tpl"],"model_file":["in.dat"]},index=["in.dat.tpl"])
+    pst.model_output_data = pd.DataFrame({"pest_file":["out.bin.paf","out.csv.paf"],"model_file":["out.bin","out.csv"]},
+                                         index=["out.bin.paf","out.csv.paf"])
+    pst.model_command = "python forward_run.py"
+    pst.control_data.noptmax = 0
+    pst.write(os.path.join(t_d,"pest.pst"))
+    pyemu.os_utils.run("{0} pest.pst".format(exe_path.replace("-ies","-glm")),cwd=t_d)
+
+    res = pyemu.Pst(os.path.join(t_d,"pest.pst")).res
+    arr = 2.0 * np.arange(1,11) + 0.5
+    d = np.abs(res.loc[bin_names,"modelled"].values - arr)
+    assert d.max() < 1.0e-10, d
+    d = np.abs(res.loc[csv_names,"modelled"].values - arr)
+    assert d.max() < 1.0e-10, d
+
+
+def model_plugin_test():
+    # needs binaries built with STATIC=no - static builds don't load model plugins
+    model_d = "model_plugin_test"
+    t_d = os.path.join(model_d, "template")
+    if os.path.exists(t_d):
+        shutil.rmtree(t_d)
+    os.makedirs(t_d)
+    # o<k> = p1 * k + p2, with the par and obs order taken from the names pest++ passes to init
+    with open(os.path.join(t_d,"model.c"),'w') as f:
+        f.write("#include <stdlib.h>\n")
+        f.write("#include <strings.h>\n")
+        f.write("static int ip1 = -1, ip2 = -1;\n")
+        f.write("static int obs_k[100];\n")
+        f.write("int pestpp_model_init(int npar, const char* const* par_names, int nobs, const char* const* obs_names)\n")
+        f.write("{\n")
+        f.write("    for (int i = 0; i < npar; ++i)\n")
+        f.write("    {\n")
+        f.write("        if (strcasecmp(par_names[i], \"p1\") == 0) ip1 = i;\n")
+        f.write("        if (strcasecmp(par_names[i], \"p2\") == 0) ip2 = i;\n")
+        f.write("    }\n")
+        f.write("    if ((ip1 < 0) || (ip2 < 0) || (nobs > 100))\n")
+        f.write("        return 1;\n")
+        f.write("    for (int i = 0; i < nobs; ++i)\n")
+        f.write("        obs_k[i] = atoi(obs_names[i] + 1);\n")
+        f.write("    return 0;\n")
+        f.write("}\n")
+        f.write("int pestpp_model_run(const double* pars, int npar, double* obs, int nobs)\n")
+        f.write("{\n")
+        f.write("    for (int i = 0; i < nobs; ++i)\n")
+        f.write("        obs[i] = pars[ip1] * obs_k[i] + pars[ip2];\n")
+        f.write("    return 0;\n")
+        f.write("}\n")
+    pyemu.os_utils.run("cc -shared -fPIC -o libmodel.so model.c",cwd=t_d)
+
+    par_names = ["p1","p2"]
+    obs_names = ["o{0}".format(k) for k in range(1,6)]
+    pst = pyemu.Pst.from_par_obs_names(par_names=par_names,obs_names=obs_names)
+    pst.parameter_data.loc[:,"partrans"] = "none"
+    pst.parameter_data.loc[:,"parlbnd"] = -10.0
+    pst.parameter_data.loc[:,"parubnd"] = 10.0
+    pst.model_command = "none"
+    pst.pestpp_options["model_plugin"] = "libmodel.so"
+    pe = pd.DataFrame({"p1":np.linspace(-2.0,2.0,10),"p2":np.linspace(1.0,3.0,10)})
+    pe.to_csv(os.path.join(t_d,"sweep_in.csv"))
+    expected = np.outer(pe.p1.values,np.arange(1,6)) + pe.p2.values[:,None]
+
+    def check(csv_file):
+        df = pd.read_csv(csv_file,index_col=0).set_index("input_run_id").loc[pe.index,:]
+        df.columns = df.columns.str.lower()
+        assert df.failed_flag.sum() == 0, df.failed_flag
+        d = np.abs(df.loc[:,obs_names].values - expected)
+        print(d.max())
+        assert d.max() < 1.0e-6, d
+
+    # serial
+    pst.write(os.path.join(t_d,"pest_plugin.pst"))
+    pyemu.os_utils.run("{0} pest_plugin.pst".format(exe_path.replace("-ies","-swp")),cwd=t_d)
+    check(os.path.join(t_d,"sweep_out.csv"))
+
+    # local workers share the one loaded library
+    pst.pestpp_options["num_local_workers"] = 3
+    pst.write(os.path.join(t_d,"pest_plugin_local.pst"))
+    pyemu.os_utils.run("{0} pest_plugin_local.pst".format(exe_path.replace("-ies","-swp")),cwd=t_d)
+    check(os.path.join(t_d,"sweep_out.csv"))
+
+    # panther agents
+    m_d = os.path.join(model_d,"master_plugin")
+    if os.path.exists(m_d):
+        shutil.rmtree(m_d)
+    pyemu.os_utils.start_workers(t_d, exe_path.replace("-ies","-swp"), "pest_plugin.pst", 2, master_dir=m_d,
+                           worker_root=model_d,port=port)
+    check(os.path.join(m_d,"sweep_out.csv"))
+
+
+def super_incremental_test():
+    model_d = "ies_10par_xsec"
+    t_d = os.path.join(model_d, "template")
+    pst = pyemu.Pst(os.path.join(t_d, "pest.pst"))
+    pst.control_data.noptmax = 6
+    pst.pestpp_options["n_iter_base"] = 1
+    pst.pestpp_options["n_iter_super"] = 2
+    pst.pestpp_options["max_n_super"] = 4
+    pst.write(os.path.join(t_d, "pest_super_full.pst"))
+    pyemu.os_utils.run("{0} pest_super_full.pst".format(exe_path.replace("-ies","-glm")),cwd=t_d)
+
+    pst.pestpp_options["super_incremental"] = True
+    pst.write(os.path.join(t_d, "pest_super_incr.pst"))
+    pyemu.os_utils.run("{0} pest_super_incr.pst".format(exe_path.replace("-ies","-glm")),cwd=t_d)
+
+    df_full = pd.read_csv(os.path.join(t_d, "pest_super_full.iobj"),index_col=0)
+    df_incr = pd.read_csv(os.path.join(t_d, "pest_super_incr.iobj"),index_col=0)
+    phi0 = df_full.total_phi.iloc[0]
+    print(df_full.total_phi.iloc[-1],df_incr.total_phi.iloc[-1])
+    # the warm-started subspace should reduce phi as well as a full svd does
+    assert df_incr.total_phi.iloc[-1] < phi0, df_incr.total_phi
+    assert df_incr.total_phi.iloc[-1] <= 1.1 * df_full.total_phi.iloc[-1], df_incr.total_phi
+
+
+def glm_broyden_test():
+    model_d = "ies_10par_xsec"
+    t_d = os.path.join(model_d, "template")
+    pst = pyemu.Pst(os.path.join(t_d, "pest.pst"))
+    pst.control_data.noptmax = 6
+    pst.write(os.path.join(t_d, "pest_fd_jac.pst"))
+    pyemu.os_utils.run("{0} pest_fd_jac.pst".format(exe_path.replace("-ies","-glm")),cwd=t_d)
+
+    pst.pestpp_options["glm_broyden_cadence"] = 3
+    pst.write(os.path.join(t_d, "pest_broyden.pst"))
+    pyemu.os_utils.run("{0} pest_broyden.pst".format(exe_path.replace("-ies","-glm")),cwd=t_d)
+
+    df_fd = pd.read_csv(os.path.join(t_d, "pest_fd_jac.iobj"),index_col=0)
+    df_br = pd.read_csv(os.path.join(t_d, "pest_broyden.iobj"),index_col=0)
+    print(df_fd.loc[:,["model_runs_completed","total_phi"]])
+    print(df_br.loc[:,["model_runs_completed","total_phi"]])
+    # secant updates replace most of the finite-difference jacobians but should still reduce phi
+    assert df_br.total_phi.iloc[-1] < df_br.total_phi.iloc[0], df_br.total_phi
+    assert df_br.model_runs_completed.iloc[-1] <= df_fd.model_runs_completed.iloc[-1], df_br.model_runs_completed
+
+
+def jac_refresh_frac_test():
+    model_d = "ies_10par_xsec"
+    t_d = os.path.join(model_d, "template")
+    pst = pyemu.Pst(os.path.join(t_d, "pest.pst"))
+    pst.control_data.noptmax = 4
+    pst.write(os.path.join(t_d, "pest_refresh_dflt.pst"))
+    pyemu.os_utils.run("{0} pest_refresh_dflt.pst".format(exe_path.replace("-ies","-glm")),cwd=t_d)
+
+    # a refresh fraction of one is the full jacobian
+    pst.pestpp_options["jac_refresh_frac"] = 1.0
+    pst.write(os.path.join(t_d, "pest_refresh_full.pst"))
+    pyemu.os_utils.run("{0} pest_refresh_full.pst".format(exe_path.replace("-ies","-glm")),cwd=t_d)
+    jco_dflt = pyemu.Jco.from_binary(os.path.join(t_d,"pest_refresh_dflt.jcb")).to_dataframe()
+    jco_full = pyemu.Jco.from_binary(os.path.join(t_d,"pest_refresh_full.jcb")).to_dataframe()
+    d = (jco_dflt - jco_full).apply(np.abs)
+    print(d.max().max())
+    assert d.max().max() < 1.0e-10, d.max()
+
+    pst.pestpp_options["jac_refresh_frac"] = 0.5
+    pst.pestpp_options["jac_refresh_max_age"] = 2
+    pst.write(os.path.join(t_d, "pest_refresh_part.pst"))
+    pyemu.os_utils.run("{0} pest_refresh_part.pst".format(exe_path.replace("-ies","-glm")),cwd=t_d)
+    df_full = pd.read_csv(os.path.join(t_d, "pest_refresh_full.iobj"),index_col=0)
+    df_part = pd.read_csv(os.path.join(t_d, "pest_refresh_part.iobj"),index_col=0)
+    print(df_full.loc[:,["model_runs_completed","total_phi"]])
+    print(df_part.loc[:,["model_runs_completed","total_phi"]])
+    assert df_part.total_phi.iloc[-1] < df_part.total_phi.iloc[0], df_part.total_phi
+    assert df_part.model_runs_completed.iloc[-1] < df_full.model_runs_completed.iloc[-1], df_part.model_runs_completed
+
+    pst.pestpp_options["jac_refresh_frac"] = 1.5
+    pst.write(os.path.join(t_d, "pest_refresh_bad.pst"))
+    try:
+        pyemu.os_utils.run("{0} pest_refresh_bad.pst".format(exe_path.replace("-ies","-glm")),cwd=t_d)
+    except Exception as e:
+        print(e)
+    else:
+        raise Exception("jac_refresh_frac > 1.0 should have been rejected")
+
+
+def weighted_jac_cache_test():
+    model_d = "ies_10par_xsec"
+    t_d = os.path.join(model_d, "template")
+    pst = pyemu.Pst(os.path.join(t_d, "pest.pst"))
+    pst.control_data.noptmax = 1
+    # the weighted jacobian products are reused across these lambdas and scale factors...
+    pst.pestpp_options["lambdas"] = "0.1,1.0,10.0"
+    pst.pestpp_options["lambda_scale_fac"] = "0.5,1.0"
+    pst.write(os.path.join(t_d, "pest_cache_multi.pst"))
+    pyemu.os_utils.run("{0} pest_cache_multi.pst".format(exe_path.replace("-ies","-glm")),cwd=t_d)
+
+    # ...and built fresh for a single lambda
+    pst.pestpp_options["lambdas"] = "1.0"
+    pst.pestpp_options["lambda_scale_fac"] = "1.0"
+    pst.write(os.path.join(t_d, "pest_cache_single.pst"))
+    pyemu.os_utils.run("{0} pest_cache_single.pst".format(exe_path.replace("-ies","-glm")),cwd=t_d)
+
+    upg_multi = pd.read_csv(os.path.join(t_d, "pest_cache_multi.upg.csv"))
+    upg_single = pd.read_csv(os.path.join(t_d, "pest_cache_single.upg.csv"))
+    upg_multi = upg_multi.loc[(upg_multi._is_super == 0) & (upg_multi._lambda == 1.0),pst.adj_par_names].iloc[0]
+    upg_single = upg_single.loc[(upg_single._is_super == 0) & (upg_single._lambda == 1.0),pst.adj_par_names].iloc[0]
+    d = (upg_multi - upg_single).apply(np.abs)
+    print(d.max())
+    assert d.max() < 1.0e-10, d
+
+
+def jac_batch_runs_test():
+    # log, tied and fixed pars, p2 at its upper bound in a forward group and p3 near its lower bound in an
+    # always-central group.  The model echoes its input values so every run's outputs are its model pars
+    model_d = "jac_build_test"
+    t_d = os.path.join(model_d, "test")
+    if os.path.exists(t_d):
+        shutil.rmtree(t_d)
+    shutil.copytree(os.path.join(model_d,"template"),t_d)
+    pst = pyemu.Pst(os.path.join(t_d,"pest.pst"))
+    pst.control_data.noptmax = -1
+    pst.pestpp_options["jac_batch_runs"] = True
+    pst.write(os.path.join(t_d,"pest_batch.pst"))
+    pyemu.os_utils.run("{0} pest_batch.pst".format(exe_path.replace("-ies","-glm")),cwd=t_d)
+
+    # the one run at a time builder
+    pst.pestpp_options["jac_batch_runs"] = False
+    pst.write(os.path.join(t_d,"pest_per_par.pst"))
+    pyemu.os_utils.run("{0} pest_per_par.pst".format(exe_path.replace("-ies","-glm")),cwd=t_d)
+
+    jco_batch = pyemu.Jco.from_binary(os.path.join(t_d,"pest_batch.jcb")).to_dataframe()
+    jco_per_par = pyemu.Jco.from_binary(os.path.join(t_d,"pest_per_par.jcb")).to_dataframe()
+    d = (jco_batch - jco_per_par).apply(np.abs)
+    print(d.max().max())
+    assert d.max().max() == 0.0, d.max()
+
+    # same run ids for each par...
+    rid_batch = open(os.path.join(t_d,"pest_batch.rid"),'r').read()
+    assert rid_batch == open(os.path.join(t_d,"pest_per_par.rid"),'r').read()
+    runs = {}
+    for line in rid_batch.split("\n"):
+        raw = line.strip().split(",")
+        if len(raw) > 1:
+            runs[raw[0].lower()] = raw[1:]
+    print(runs)
+    assert len(runs["p2"]) == 1, runs
+    assert len(runs["p3"]) == 2, runs
+    assert len(runs["p5"]) == 2, runs
+    assert "p4" not in runs and "p6" not in runs, runs
+    # ...and the same par values, info text, info values and results in every run record
+    rnj_batch = open(os.path.join(t_d,"pest_batch.rnj"),'rb').read()
+    assert rnj_batch == open(os.path.join(t_d,"pest_per_par.rnj"),'rb').read()
+
+
+def panther_agent_slots_test():
+    model_d = "ies_10par_xsec"
+    local=True
+    if "linux" in platform.platform().lower() and "10par" in model_d:
+        local=False
+
+    t_d = os.path.join(model_d,"template")
+    pst = pyemu.Pst(os.path.join(t_d,"pest.pst"))
+    pe = pyemu.ParameterEnsemble.from_uniform_draw(pst,num_reals=30)
+    pe.to_csv(os.path.join(t_d,"sweep_in.csv"))
+
+    pst.pestpp_options["panther_agent_slots"] = 3
+    pst.write(os.path.join(t_d,"pest_slots.pst"))
+    m_d = os.path.join(model_d,"master_slots")
+    if os.path.exists(m_d):
+        shutil.rmtree(m_d)
+    pyemu.os_utils.start_workers(t_d, exe_path.replace("-ies","-swp"), "pest_slots.pst", 2, master_dir=m_d,
+                           worker_root=model_d,local=local,port=port)
+    df1 = pd.read_csv(os.path.join(m_d, "sweep_out.csv"),index_col=0)
+    assert df1.shape[0] == pe.shape[0], df1.shape
+    assert df1.failed_flag.sum() == 0, df1.failed_flag
+
+    pst.pestpp_options.pop("panther_agent_slots")
+    pst.write(os.path.join(t_d,"pest_slots.pst"))
+    pyemu.os_utils.run("{0} pest_slots.pst".format(exe_path.replace("-ies","-swp")),cwd=t_d)
+    df2 = pd.read_csv(os.path.join(t_d, "sweep_out.csv"),index_col=0)
+    df1 = df1.set_index("input_run_id").loc[df2.input_run_id,:]
+    df2 = df2.set_index("input_run_id")
+    diff = (df1.loc[:,pst.obs_names].values - df2.loc[:,pst.obs_names].values)
+    print(np.abs(diff).max())
+    assert np.abs(diff).max() < 1.0e-6, np.abs(diff).max()
+
+    pst.pestpp_options["panther_agent_slots"] = 0
+    pst.write(os.path.join(t_d,"pest_slots.pst"))
+    try:
+        pyemu.os_utils.run("{0} pest_slots.pst".format(exe_path.replace("-ies","-swp")),cwd=t_d)
+    except Exception as e:
+        print(e)
+    else:
+        raise Exception("panther_agent_slots < 1 should have been rejected")
+
+
+def atomic_model_io_test():
+    model_d = "ies_10par_xsec"
+    t_d = os.path.join(model_d,"template")
+    new_d = os.path.join(model_d,"atomic_io")
+    if os.path.exists(new_d):
+        shutil.rmtree(new_d)
+    shutil.copytree(t_d,new_d)
+
+    # the model skips the simulation, leaving the last heads file in place, whenever k_02 is above 20
+    with open(os.path.join(new_d,"forward_run_stale.py"),'w') as f:
+        f.write("import os\n")
+        f.write("vals = [float(v) for v in open('hk_Layer_1.ref','r').read().split()]\n")
+        f.write("if max(vals) <= 20.0:\n")
+        f.write("    os.system('mfnwt 10par_xsec.nam')\n")
+    pst = pyemu.Pst(os.path.join(new_d,"pest.pst"))
+    pe = pyemu.ParameterEnsemble.from_uniform_draw(pst,num_reals=6)
+    pe.loc[:,pst.par_names] = pst.parameter_data.loc[pst.par_names,"parval1"].values
+    pe.loc[pe.index[2],"k_02"] = 24.0
+    pe.loc[pe.index[4],"k_02"] = 24.0
+    pe.to_csv(os.path.join(new_d,"sweep_in.csv"))
+    pst.model_command = ["python forward_run_stale.py"]
+    pst.pestpp_options["max_run_fail"] = 1
+    pst.write(os.path.join(new_d,"pest_stale.pst"))
+    pyemu.os_utils.run("{0} pest_stale.pst".format(exe_path.replace("-ies","-swp")),cwd=new_d)
+    df = pd.read_csv(os.path.join(new_d, "sweep_out.csv"),index_col=0).set_index("input_run_id")
+    print(df.failed_flag)
+    # an output the model did not rewrite is never read back as the result of the run
+    assert df.loc[pe.index[2],"failed_flag"] == 1, df.failed_flag
+    assert df.loc[pe.index[4],"failed_flag"] == 1, df.failed_flag
+    assert df.failed_flag.sum() == 2, df.failed_flag
+
+    if "linux" not in platform.platform().lower():
+        return
+    # the input file is written to a temp file and renamed into place, so a short write - here the
+    # temp file is a link to /dev/full - fails the run and leaves the model's input file alone
+    inp_file = os.path.join(new_d,"hk_Layer_1.ref")
+    tmp_file = inp_file + ".pestpp_tmp"
+    org_lines = open(inp_file,'r').readlines()
+    os.symlink("/dev/full",tmp_file)
+    pe.iloc[:1,:].to_csv(os.path.join(new_d,"sweep_in.csv"))
+    pst.model_command = ["mfnwt 10par_xsec.nam"]
+    pst.write(os.path.join(new_d,"pest_short.pst"))
+    pyemu.os_utils.run("{0} pest_short.pst".format(exe_path.replace("-ies","-swp")),cwd=new_d)
+    df = pd.read_csv(os.path.join(new_d, "sweep_out.csv"),index_col=0)
+    print(df.failed_flag)
+    assert df.failed_flag.sum() == 1, df.failed_flag
+    assert not os.path.lexists(tmp_file)
+    assert not os.path.islink(inp_file)
+    assert open(inp_file,'r').readlines() == org_lines
+
+
+def model_exit_code_test():
+    model_d = "ies_10par_xsec"
+    t_d = os.path.join(model_d,"template")
+    new_d = os.path.join(model_d,"exit_code")
+    if os.path.exists(new_d):
+        shutil.rmtree(new_d)
+    shutil.copytree(t_d,new_d)
+
+    # the model runs fine but its wrapper ends with a not-found style exit code
+    with open(os.path.join(new_d,"forward_run_127.py"),'w') as f:
+        f.write("import os\n")
+        f.write("import sys\n")
+        f.write("os.system('mfnwt 10par_xsec.nam')\n")
+        f.write("sys.exit(127)\n")
+    pst = pyemu.Pst(os.path.join(new_d,"pest.pst"))
+    pe = pyemu.ParameterEnsemble.from_uniform_draw(pst,num_reals=5)
+    pe.to_csv(os.path.join(new_d,"sweep_in.csv"))
+    pst.model_command = ["python forward_run_127.py"]
+    pst.write(os.path.join(new_d,"pest_127.pst"))
+    pyemu.os_utils.run("{0} pest_127.pst".format(exe_path.replace("-ies","-swp")),cwd=new_d)
+    df = pd.read_csv(os.path.join(new_d, "sweep_out.csv"),index_col=0)
+    print(df.failed_flag)
+    assert df.failed_flag.sum() == 0, df.failed_flag
+
+    # a command that can't be started fails every run
+    pst.model_command = ["not_a_model_command"]
+    pst.pestpp_options["max_run_fail"] = 1
+    pst.write(os.path.join(new_d,"pest_nocmd.pst"))
+    pyemu.os_utils.run("{0} pest_nocmd.pst".format(exe_path.replace("-ies","-swp")),cwd=new_d)
+    df = pd.read_csv(os.path.join(new_d, "sweep_out.csv"),index_col=0)
+    print(df.failed_flag)
+    assert df.failed_flag.sum() == pe.shape[0], df.failed_flag
+
+
+def serial_run_fail_test():
+    model_d = "ies_10par_xsec"
+    t_d = os.path.join(model_d,"template")
+    new_d = os.path.join(model_d,"serial_fail")
+    if os.path.exists(new_d):
+        shutil.rmtree(new_d)
+    shutil.copytree(t_d,new_d)
+
+    # the model fails, and counts the attempt, whenever any k is above 24
+    with open(os.path.join(new_d,"forward_run_fail.py"),'w') as f:
+        f.write("import os\n")
+        f.write("vals = [float(v) for v in open('hk_Layer_1.ref','r').read().split()]\n")
+        f.write("if os.path.exists('10par_xsec.hds'):\n")
+        f.write("    os.remove('10par_xsec.hds')\n")
+        f.write("if max(vals) > 24.0:\n")
+        f.write("    open('fail_count.txt','a').write('fail\\n')\n")
+        f.write("    raise Exception('failing on purpose')\n")
+        f.write("os.system('mfnwt 10par_xsec.nam')\n")
+
+    pst = pyemu.Pst(os.path.join(new_d,"pest.pst"))
+    pe = pyemu.ParameterEnsemble.from_uniform_draw(pst,num_reals=10)
+    pe.loc[:,pst.par_names] = pst.parameter_data.loc[pst.par_names,"parval1"].values
+    pe.loc[:,"k_03"] = np.linspace(1.0,10.0,pe.shape[0])
+    pe.loc[pe.index[3],"k_02"] = 24.9
+    pe.to_csv(os.path.join(new_d,"sweep_in.csv"))
+    pst.model_command = ["python forward_run_fail.py"]
+    pst.pestpp_options["max_run_fail"] = 3
+    pst.write(os.path.join(new_d,"pest_fail.pst"))
+    pyemu.os_utils.run("{0} pest_fail.pst".format(exe_path.replace("-ies","-swp")),cwd=new_d)
+
+    df = pd.read_csv(os.path.join(new_d, "sweep_out.csv"),index_col=0).set_index("input_run_id")
+    print(df.failed_flag)
+    assert df.loc[pe.index[3],"failed_flag"] == 1, df.failed_flag
+    assert df.failed_flag.sum() == 1, df.failed_flag
+    # the failing run is retried up to max_run_fail times and no more
+    n_fail = len(open(os.path.join(new_d,"fail_count.txt"),'r').readlines())
+    assert n_fail == 3, n_fail
+
+
+def local_workers_test():
+    model_d = "ies_10par_xsec"
+    t_d = os.path.join(model_d,"template")
+    new_d = os.path.join(model_d,"local_workers")
+    if os.path.exists(new_d):
+        shutil.rmtree(new_d)
+    shutil.copytree(t_d,new_d)
+    pst = pyemu.Pst(os.path.join(new_d,"pest.pst"))
+    pe = pyemu.ParameterEnsemble.from_uniform_draw(pst,num_reals=20)
+    pe.loc[:,"k_02"] = np.minimum(pe.loc[:,"k_02"].values,20.0)
+    pe.to_csv(os.path.join(new_d,"sweep_in.csv"))
+    pst.write(os.path.join(new_d,"pest_serial.pst"))
+    pyemu.os_utils.run("{0} pest_serial.pst".format(exe_path.replace("-ies","-swp")),cwd=new_d)
+    df1 = pd.read_csv(os.path.join(new_d, "sweep_out.csv"),index_col=0).set_index("input_run_id")
+
+    pst.pestpp_options["num_local_workers"] = 4
+    pst.write(os.path.join(new_d,"pest_local.pst"))
+    pyemu.os_utils.run("{0} pest_local.pst".format(exe_path.replace("-ies","-swp")),cwd=new_d)
+    df2 = pd.read_csv(os.path.join(new_d, "sweep_out.csv"),index_col=0).set_index("input_run_id")
+    for i in range(4):
+        assert os.path.exists(os.path.join(new_d,"local_worker_{0}".format(i)))
+    diff = (df1.loc[pe.index,pst.obs_names].values - df2.loc[pe.index,pst.obs_names].values)
+    print(np.abs(diff).max())
+    assert np.abs(diff).max() < 1.0e-6, np.abs(diff).max()
+
+    # one run hangs - it should be killed as overdue and reported as failed
+    with open(os.path.join(new_d,"forward_run_slow.py"),'w') as f:
+        f.write("import os\n")
+        f.write("import time\n")
+        f.write("vals = [float(v) for v in open('hk_Layer_1.ref','r').read().split()]\n")
+        f.write("if max(vals) > 24.0:\n")
+        f.write("    time.sleep(120)\n")
+        f.write("os.system('mfnwt 10par_xsec.nam')\n")
+    pe.loc[pe.index[5],"k_02"] = 24.9
+    pe.to_csv(os.path.join(new_d,"sweep_in.csv"))
+    pst.model_command = ["python forward_run_slow.py"]
+    pst.pestpp_options["overdue_giveup_fac"] = 5.0
+    pst.pestpp_options["max_run_fail"] = 1
+    pst.write(os.path.join(new_d,"pest_local.pst"))
+    # the existing worker directories are refreshed with the new model command files
+    start = datetime.now()
+    pyemu.os_utils.run("{0} pest_local.pst".format(exe_path.replace("-ies","-swp")),cwd=new_d)
+    elapsed = (datetime.now() - start).total_seconds()
+    df3 = pd.read_csv(os.path.join(new_d, "sweep_out.csv"),index_col=0).set_index("input_run_id")
+    print(elapsed,df3.failed_flag)
+    assert elapsed < 120, elapsed
+    assert df3.loc[pe.index[5],"failed_flag"] == 1, df3.failed_flag
+    assert df3.failed_flag.sum() == 1, df3.failed_flag
+
+    pst.pestpp_options["num_local_workers"] = 0
+    pst.write(os.path.join(new_d,"pest_local.pst"))
+    try:
+        pyemu.os_utils.run("{0} pest_local.pst".format(exe_path.replace("-ies","-swp")),cwd=new_d)
+    except Exception as e:
+        print(e)
+    else:
+        raise Exception("num_local_workers < 1 should have been rejected")
+
+
 if __name__ == "__main__":
     #glm_long_name_test()
     #sen_plusplus_test()
@@ -772,9 +1522,27 @@ if __name__ == "__main__":
     #secondary_marker_test()
     #basic_test("ies_10par_xsec")
     #glm_save_binary_test()
+    #sparse_run_storage_test()
+    #rmic_bulk_test()
     #sweep_forgive_test()
+    #panther_attachments_test()
+    #panther_attachment_retry_test()
+    #panther_tail_speculation_test()
     #inv_regul_test()
     #tie_by_group_test()
     sen_basic_test()
     #salib_verf()
     #tplins1_test()
+    #tplins_compiled_test()
+    #array_output_file_test()
+    #model_plugin_test()
+    #super_incremental_test()
+    #glm_broyden_test()
+    #jac_refresh_frac_test()
+    #weighted_jac_cache_test()
+    #jac_batch_runs_test()
+    #panther_agent_slots_test()
+    #atomic_model_io_test()
+    #model_exit_code_test()
+    #serial_run_fail_test()
+    #local_workers_test()
@@ -0,0 +1,7 @@
+ptf ~
+p1 ~   p1            ~
+p2 ~   p2            ~
+p3 ~   p3            ~
+p4 ~   p4            ~
+p5 ~   p5            ~
+p6 ~   p6            ~
@@ -0,0 +1,5 @@
+vals = [float(l.split()[1]) for l in open('in.dat')]
+with open('out.dat','w') as f:
+    for i,v in enumerate(vals):
+        f.write("{0:20.12e}\n".format(v))
+    f.write("{0:20.12e}\n".format(vals[0] * vals[1] + vals[2] ** 2))
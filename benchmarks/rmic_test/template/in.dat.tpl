@@ -0,0 +1,3 @@
+ptf ~
+p1 ~ p1 ~
+p2 ~ p2 ~
@@ -0,0 +1,4 @@
+v = [float(l.split()[1]) for l in open('in.dat')]
+if v[0] < 0.0:
+    raise Exception('failing on purpose')
+open('out.dat','w').write("{0}\n{1}\n".format(2.0 * v[0], v[1] + 1.0))
@@ -0,0 +1,101 @@
+#include <iostream>
+#include <cmath>
+#include <vector>
+#include "RunManagerCWrapper.h"
+
+using namespace std;
+
+static int n_errors = 0;
+
+static void check(bool ok, const char *what)
+{
+	if (!ok)
+	{
+		cerr << "rmic_test failed: " << what << endl;
+		++n_errors;
+	}
+}
+
+int main()
+{
+	char comline[] = "python model.py";
+	char tpl[] = "in.dat.tpl";
+	char inp[] = "in.dat";
+	char ins[] = "out.dat.ins";
+	char out[] = "out.dat";
+	char storfile[] = "rmic_test.rns";
+	char rundir[] = ".";
+	char *comline_arr[] = { comline };
+	char *tpl_arr[] = { tpl };
+	char *inp_arr[] = { inp };
+	char *ins_arr[] = { ins };
+	char *out_arr[] = { out };
+	RunManager *rm = rmic_create_serial(comline_arr, 1, tpl_arr, 1, inp_arr, 1, ins_arr, 1, out_arr, 1,
+		storfile, rundir, 1);
+	//names are upper case, as pest++ stores them
+	char p1[] = "P1", p2[] = "P2", o1[] = "O1", o2[] = "O2";
+	char *pnames[] = { p1, p2 };
+	char *onames[] = { o1, o2 };
+	check(rmic_initialize(rm, pnames, 2, onames, 2) == 0, "rmic_initialize");
+
+	//row major: run i has p1 = i + 1 and p2 = 10 * (i + 1), except run 1 which fails
+	const int nrun = 4, npar = 2, nobs = 2;
+	vector<double> pars(nrun * npar);
+	for (int i = 0; i < nrun; ++i)
+	{
+		pars[i * npar] = i + 1.0;
+		pars[i * npar + 1] = 10.0 * (i + 1);
+	}
+	pars[1 * npar] = -1.0;
+	vector<int> ids(nrun, -1);
+	check(rmic_add_runs(rm, pars.data(), nrun, npar + 1, ids.data()) != 0, "rmic_add_runs accepted the wrong npar");
+	check(rmic_add_runs(rm, pars.data(), nrun, npar, ids.data()) == 0, "rmic_add_runs");
+	for (int i = 0; i < nrun; ++i)
+		check(ids[i] == i, "run ids are not consecutive from 0");
+
+	vector<int> status(nrun, -1);
+	check(rmic_get_run_status(rm, ids.data(), nrun, status.data()) == 0, "rmic_get_run_status before run");
+	for (int i = 0; i < nrun; ++i)
+		check(status[i] == 0, "status of a run that has not been made is not 0");
+
+	check(rmic_run(rm) == 0, "rmic_run");
+
+	//non-consecutive ids, out of order
+	int sub_ids[] = { 3, 0, 2, 1 };
+	const int nsub = 4;
+	vector<double> sub_pars(nsub * npar), sub_obs(nsub * nobs);
+	vector<int> sub_status(nsub, 99);
+	check(rmic_get_runs(rm, sub_ids, nsub, sub_pars.data(), npar, sub_obs.data(), nobs, sub_status.data()) == 0,
+		"rmic_get_runs");
+	for (int i = 0; i < nsub; ++i)
+	{
+		int id = sub_ids[i];
+		check(sub_pars[i * npar] == pars[id * npar], "p1 is not row major in run id order");
+		check(sub_pars[i * npar + 1] == pars[id * npar + 1], "p2 is not row major in run id order");
+		if (id == 1)
+		{
+			check((sub_status[i] < 0) && (sub_status[i] != -100), "status of the failed run is not a failure count");
+			continue;
+		}
+		check(sub_status[i] == 1, "status of a completed run is not 1");
+		check(fabs(sub_obs[i * nobs] - 2.0 * pars[id * npar]) < 1.0e-6, "o1 is not row major in run id order");
+		check(fabs(sub_obs[i * nobs + 1] - (pars[id * npar + 1] + 1.0)) < 1.0e-6, "o2 is not row major in run id order");
+	}
+
+	//statuses only
+	vector<int> null_status(nsub, 99);
+	check(rmic_get_runs(rm, sub_ids, nsub, NULL, npar, NULL, nobs, null_status.data()) == 0,
+		"rmic_get_runs with NULL par and obs buffers");
+	check(null_status == sub_status, "statuses differ with NULL par and obs buffers");
+	check(rmic_get_runs(rm, sub_ids, nsub, NULL, npar, NULL, nobs + 1, null_status.data()) != 0,
+		"rmic_get_runs accepted the wrong nobs");
+
+	check(rmic_get_run_status(rm, sub_ids, nsub, status.data()) == 0, "rmic_get_run_status");
+	check(status == sub_status, "rmic_get_run_status and rmic_get_runs disagree");
+
+	rmic_delete(rm);
+	if (n_errors > 0)
+		return 1;
+	cout << "rmic_test passed" << endl;
+	return 0;
+}
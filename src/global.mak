@@ -122,6 +122,10 @@ LD = $(CXX)
 LDFLAGS += -pthread
 ifneq ($(STATIC),no)
     LDFLAGS += $(STATIC)
+else ifneq ($(SYSTEM),win)
+    # ++model_plugin loads a shared library, which a static binary can't do reliably
+    CPPFLAGS += -DPESTPP_MODEL_PLUGIN
+    EXT_LIBS += -ldl
 endif
 
 # r=insert with replacement; c=create archive; s=add index
@@ -93,6 +93,7 @@ public:
 	const_iterator find(const string &name) const;
 	size_t size() const {return items.size();}
 	void clear() {items.clear();}
+	void reserve(size_t n) {items.reserve(n);}
 	vector<string> get_notnormal_keys();
 	vector<string> get_keys() const;
 	vector<double> get_data_vec(const vector<string> &keys) const;
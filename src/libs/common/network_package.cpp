@@ -1,6 +1,7 @@
 #include <memory>
 #include <sstream>
 #include <cstring>
+#include <algorithm>
 #include "network_package.h"
 #include "network_wrapper.h"
 #include <cassert>
@@ -9,7 +10,7 @@ using namespace std;
 
 //Static Memeber Initialization
 int64_t NetPackage::last_group_id = 0;
-int8_t NetPackage::security_code[5] = { 1, 3, 5, 7, 9 };
+int8_t NetPackage::security_code[SECURITY_CODE_LEN] = { 1, 3, 5, 7, 9 };
 
 //Static Methods
 int NetPackage::get_new_group_id()
@@ -138,148 +139,176 @@ void NetPackage::reset(PackType _type, int _group, int _run_id, const string &_d
 	data.clear();
 }
 
-int NetPackage::send(int sockfd, const void *data, int64_t data_len_l)
+void NetPackage::pack_header(int64_t data_len_l, int8_t *header_buf) const
 {
-	int n;
-
-	// first send security code
-	int64_t security_code_size = sizeof(security_code);
-	n = w_sendall(sockfd, &security_code[0], &security_code_size);
-	if (n<1) {
-		cerr << "NetPackage::send error: could not send security code" << endl;
-		return n;
-	}
-	int64_t buf_sz = 0;
-	//calculate the size of buffer
-	buf_sz += sizeof(buf_sz);
-	buf_sz += sizeof(type);
-	buf_sz += sizeof(group);
-	buf_sz += sizeof(run_id);
-	buf_sz += sizeof(desc);
-	buf_sz += data_len_l;
-	//pack information into buffer
-	//unique_ptr<char[]> buf(new char[buf_sz]);
-	vector<int8_t> buf;
-	buf.resize(buf_sz, '\0');
+	int64_t payload_sz = (data_len_l > 0) ? data_len_l : 0;
+	int64_t buf_sz = HEADER_LEN - sizeof(security_code) + payload_sz;
 	size_t i_start = 0;
-	w_memcpy_s(&buf[i_start], buf_sz-i_start, &buf_sz, sizeof(buf_sz));
+	w_memcpy_s(&header_buf[i_start], HEADER_LEN - i_start, security_code, sizeof(security_code));
+	i_start += sizeof(security_code);
+	w_memcpy_s(&header_buf[i_start], HEADER_LEN - i_start, &buf_sz, sizeof(buf_sz));
 	i_start += sizeof(buf_sz);
-	w_memcpy_s(&buf[i_start], buf_sz-i_start, &type, sizeof(type));
+	w_memcpy_s(&header_buf[i_start], HEADER_LEN - i_start, &type, sizeof(type));
 	i_start += sizeof(type);
-	w_memcpy_s(&buf[i_start], buf_sz-i_start, &group, sizeof(group));
+	w_memcpy_s(&header_buf[i_start], HEADER_LEN - i_start, &group, sizeof(group));
 	i_start += sizeof(group);
-	w_memcpy_s(&buf[i_start], buf_sz-i_start, &run_id, sizeof(run_id));
+	w_memcpy_s(&header_buf[i_start], HEADER_LEN - i_start, &run_id, sizeof(run_id));
 	i_start += sizeof(run_id);
-	w_memcpy_s(&buf[i_start], buf_sz-i_start, desc, sizeof(desc));
+	w_memcpy_s(&header_buf[i_start], HEADER_LEN - i_start, desc, sizeof(desc));
 	i_start += sizeof(desc);
-	if (data_len_l > 0) {
-		w_memcpy_s(&buf[i_start], buf_sz-i_start, data, data_len_l);
-		i_start += data_len_l;
-	}
-	n = w_sendall(sockfd, buf.data(), &buf_sz);
-	if (i_start != buf_sz) {
-		cerr << "NetPackage::send error: could only send" << i_start
-			<< " out of " << buf_sz << "bytes" << endl;
+	assert(i_start == HEADER_LEN);
+}
+
+void NetPackage::append_to_batch(vector<int8_t> &batch, const void *data, int64_t data_len_l) const
+{
+	int64_t payload_sz = (data_len_l > 0) ? data_len_l : 0;
+	size_t i_start = batch.size();
+	batch.resize(i_start + HEADER_LEN + payload_sz);
+	pack_header(payload_sz, &batch[i_start]);
+	if (payload_sz > 0)
+		w_memcpy_s(&batch[i_start + HEADER_LEN], payload_sz, data, payload_sz);
+}
+
+int NetPackage::unpack_from_batch(const vector<int8_t> &batch, size_t &offset)
+{
+	if ((offset + HEADER_LEN > batch.size()) || (check_security_code(&batch[offset]) < 0) ||
+		(unpack_header(&batch[offset]) < 0) || (offset + HEADER_LEN + data_len > batch.size()))
+		return -2;
+	data.assign(batch.begin() + offset + HEADER_LEN, batch.begin() + offset + HEADER_LEN + data_len);
+	offset += HEADER_LEN + data_len;
+	return 1;
+}
+
+int NetPackage::send(int sockfd, const void *data, int64_t data_len_l)
+{
+	int n;
+	// security code and header are packed into a small stack buffer and go out in the same
+	// sendmsg() as the payload, which is sent in place from the caller's buffer
+	int8_t header_buf[HEADER_LEN];
+	int64_t payload_sz = (data_len_l > 0) ? data_len_l : 0;
+	pack_header(payload_sz, header_buf);
+
+	w_iobuf bufs[2] = { { header_buf, HEADER_LEN }, { (const int8_t*)data, payload_sz } };
+	int64_t n_sent = 0;
+	n = w_sendallv(sockfd, bufs, 2, &n_sent);
+	if (n > 0 && n_sent != HEADER_LEN + payload_sz) {
+		cerr << "NetPackage::send error: could only send " << n_sent
+			<< " out of " << HEADER_LEN + payload_sz << " bytes" << endl;
 		n = -2;
 	}
 	return n;  // return -2 on corrupt send, -1 on failure, 0 closed connection or 1 on success
 }
 
-int  NetPackage::recv(int sockfd)
+int NetPackage::check_security_code(const int8_t *header_buf)
 {
-	long n;
-	int64_t header_sz = 0;
-	int64_t buf_sz = 0;
-	size_t i_start = 0;
-	int8_t rcv_security_code[5] = { 0, 0, 0, 0, 0 };
-	int temp,temp1,temp2, sum;
-	int64_t rcv_security_code_size = sizeof(rcv_security_code);
-	bool corrupt_desc = false;
-
-	try{
-		//get header (ie size, seq_id, id and name)
-		header_sz = sizeof(buf_sz) + sizeof(type) + sizeof(group) + sizeof(run_id) + sizeof(desc);
-		vector<int8_t> header_buf;
-		header_buf.resize(header_sz, '\0');
-		n = w_recvall(sockfd, &rcv_security_code[0], &rcv_security_code_size);
-		//int security_cmp = memcmp(security_code, rcv_security_code, sizeof(security_code))
-
-		sum = 0;
-		bool wrong_code = false;
+	const int8_t *rcv_security_code = header_buf;
+	int temp, temp1, temp2, sum;
+	sum = 0;
+	bool wrong_code = false;
+	for (int i = 0; i < sizeof(security_code); i++)
+	{
+		temp1 = int(security_code[i]);
+		temp2 = int(rcv_security_code[i]);
+		sum = sum + temp2;
+		if (temp1 != temp2)
+		{
+			wrong_code = true;
+		}
+	}
+	if (sum == 0)
+	{
+		cerr << "NetPackage::recv empty security code, terminating connection..." << endl;
+		return -2;
+	}
+	if (wrong_code) //(security_cmp != 0)
+	{
+		// corrupt message; message did not originate from a PEST++ application
+		cerr << "NetPackage::recv wrong security code: ";
+		cerr << " raw value, int cast: ";
 		for (int i = 0; i < sizeof(security_code); i++)
 		{
-			temp1 = int(security_code[i]);
-			temp2 = int(rcv_security_code[i]);
-			sum = sum + temp2;
-			if (temp1 != temp2)
-			{
-				wrong_code = true;
-			}
+			temp = int(rcv_security_code[i]);
+			cerr << rcv_security_code[i] << "," << temp << "; ";
 		}
-		if (sum == 0)
+		cerr << endl;
+		return -2;
+	}
+	return 1;
+}
+
+int NetPackage::unpack_header(const int8_t *header_buf)
+{
+	int64_t buf_sz = 0;
+	size_t i_start = sizeof(security_code);
+	w_memcpy_s(&buf_sz, sizeof(buf_sz), &header_buf[i_start], sizeof(buf_sz));
+	i_start += sizeof(buf_sz);
+	w_memcpy_s(&type, sizeof(type), &header_buf[i_start], sizeof(type));
+	i_start += sizeof(type);
+	w_memcpy_s(&group, sizeof(group), &header_buf[i_start], sizeof(group));
+	i_start += sizeof(group);
+	w_memcpy_s(&run_id, sizeof(run_id), &header_buf[i_start], sizeof(run_id));
+	i_start += sizeof(run_id);
+	//w_memcpy_s(&desc, sizeof(desc), &header_buf[i_start], sizeof(desc));
+	// This is done to remove possible system dependicies on whether char/uchar
+	// is use to represent a standard char
+	for (int i = 0; i < DESC_LEN; ++i)
+	{
+		if (!allowable_ascii_char(header_buf[i_start + i]))
 		{
-			cerr << "NetPackage::recv empty security code, terminating connection..." << endl;
 			return -2;
 		}
-		if (wrong_code) //(security_cmp != 0)
+		else
 		{
-			// corrupt message; message did not originate from a PEST++ application
-			cerr << "NetPackage::recv wrong security code: ";
-			cerr << " raw value, int cast: ";
-			for (int i = 0; i < sizeof(security_code); i++)
-			{
-				temp = int(rcv_security_code[i]);
-				cerr << rcv_security_code[i] << "," << temp << "; ";
-			}
-			cerr << endl;
-			n = -2;
-			return n;
+			desc[i] = header_buf[i_start + i];
 		}
+	}
+	i_start += sizeof(desc);
+	desc[DESC_LEN - 1] = '\0';
+	data_len = buf_sz - (HEADER_LEN - sizeof(security_code));
+	if (data_len < 0)
+	{
+		cerr << "NetPackage::recv error: invalid message size " << buf_sz << endl;
+		return -2;
+	}
+	return 1;
+}
 
+int  NetPackage::recv(int sockfd)
+{
+	long n;
+	int64_t header_sz = HEADER_LEN;
+
+	try{
+		//get the security code and header (ie size, seq_id, id and name) in one read
+		int8_t header_buf[HEADER_LEN];
+		memset(header_buf, 0, HEADER_LEN);
 		n = w_recvall(sockfd, &header_buf[0], &header_sz);
-		if (n > 0 && header_sz != header_buf.size()) {
+		if (check_security_code(header_buf) < 0)
+		{
+			return -2;
+		}
+
+		if (n > 0 && header_sz != HEADER_LEN) {
 			// corrupt message; message not the correct length
 			n = -2;
-			cerr << "NetPackage::recv error reading header: expected" << header_buf.size()
+			cerr << "NetPackage::recv error reading header: expected" << HEADER_LEN
 				<< " bytes, but received " << header_sz << "bytes" << endl;
 		}
 		else if (n > 0) {
-			i_start = 0;
-			w_memcpy_s(&buf_sz, sizeof(buf_sz), &header_buf[i_start], sizeof(buf_sz));
-			i_start += sizeof(buf_sz);
-			w_memcpy_s(&type, sizeof(type), &header_buf[i_start], sizeof(type));
-			i_start += sizeof(type);
-			w_memcpy_s(&group, sizeof(group), &header_buf[i_start], sizeof(group));
-			i_start += sizeof(group);
-			w_memcpy_s(&run_id, sizeof(run_id), &header_buf[i_start], sizeof(run_id));
-			i_start += sizeof(run_id);
-			//w_memcpy_s(&desc, sizeof(desc), &header_buf[i_start], sizeof(desc));
-			// This is done to remove possible system dependicies on whether char/uchar
-			// is use to represent a standard char
-			for (int i = 0; i < DESC_LEN; ++i)
+			if (unpack_header(header_buf) < 0)
 			{
-				if (!allowable_ascii_char(header_buf[i_start + 1]))
-				{
-					corrupt_desc = true;
-					n = -2;
-					return n;
-				}
-				else
-				{
-					desc[i] = header_buf[i_start + 1];
-				}
+				return -2;
 			}
-			i_start += sizeof(desc);
-			desc[DESC_LEN - 1] = '\0';
-			//get data
-			data_len = buf_sz - i_start;
-			data.resize(data_len, '\0');
+			//get data straight into the package's buffer - a package reused across messages keeps its
+			//capacity so only a larger message allocates
+			data.resize(data_len);
 			if (data_len > 0) {
+				int64_t expected_len = data_len;
 				n = w_recvall(sockfd, &data[0], &data_len);
-				if (data_len != buf_sz - header_sz)
+				if (data_len != expected_len)
 				{
 					n = -2;
-					cerr << "NetPackage::recv error reading data: expected" << buf_sz - header_sz
+					cerr << "NetPackage::recv error reading data: expected" << expected_len
 						<< " bytes, but received " << data_len << "bytes" << endl;
 				}
 			}
@@ -305,6 +334,81 @@ void NetPackage::print_header(std::ostream &fout)
 		", data package size = " << data.size() << endl;
 }
 
+int NetPackageReader::read(int sockfd, NetPackage &net_pack)
+{
+	const int64_t header_len = NetPackage::HEADER_LEN;
+#ifdef OS_WIN
+	bool first_read = true;
+#endif
+	while (true)
+	{
+		if ((n_read >= header_len) && (n_read - header_len == header_pack.get_data_len()))
+		{
+			//the whole message is in - hand the payload over and keep the caller's old buffer for the next one
+			net_pack.unpack_header(header_buf);
+			net_pack.swap_data(data);
+			data.clear();
+			n_read = 0;
+			return 1;
+		}
+		int8_t *buf;
+		int64_t n_want;
+		if (n_read < header_len)
+		{
+			buf = &header_buf[n_read];
+			n_want = header_len - n_read;
+		}
+		else
+		{
+			buf = &data[n_read - header_len];
+			n_want = header_pack.get_data_len() - (n_read - header_len);
+		}
+#ifdef OS_WIN
+		//select() only promises one recv() that won't block
+		if (!first_read)
+			return 2;
+		int n = ::recv(sockfd, (char*)buf, int(min(n_want, int64_t(1 << 30))), 0);
+#endif
+#ifdef OS_LINUX
+		ssize_t n = ::recv(sockfd, buf, n_want, MSG_DONTWAIT);
+		if ((n < 0) && ((errno == EAGAIN) || (errno == EWOULDBLOCK) || (errno == EINTR)))
+			return 2;
+#endif
+		if (n == 0)
+		{
+			n_read = 0;
+			return 0;
+		}
+		if (n < 0)
+		{
+			cerr << "NetPackageReader::read error: " << w_get_error_msg() << endl;
+			n_read = 0;
+			return -1;
+		}
+#ifdef OS_WIN
+		first_read = false;
+#endif
+		int64_t n_before = n_read;
+		n_read += n;
+		//reject foreign traffic as soon as the security code is in
+		if ((n_before < NetPackage::SECURITY_CODE_LEN) && (n_read >= NetPackage::SECURITY_CODE_LEN) &&
+			(NetPackage::check_security_code(header_buf) < 0))
+		{
+			n_read = 0;
+			return -2;
+		}
+		if ((n_before < header_len) && (n_read == header_len))
+		{
+			if (header_pack.unpack_header(header_buf) < 0)
+			{
+				n_read = 0;
+				return -2;
+			}
+			data.resize(header_pack.get_data_len());
+		}
+	}
+}
+
 //template std::string NetPackage::extract_string< std::vector<int8_t>::iterator>(std::vector<int8_t>::iterator first, std::vector<int8_t>::iterator last);
 template std::vector<int8_t> NetPackage::pack_string< std::string::iterator>(std::string::iterator first, std::string::iterator last);
 template std::vector<int8_t> NetPackage::pack_string< std::string::const_iterator>(std::string::const_iterator first, std::string::const_iterator last);
@@ -19,18 +19,40 @@ public:
 	static std::vector<int8_t> pack_string(InputIterator first, InputIterator last);
 	enum class PackType :uint32_t {
 		UNKN, OK, CONFIRM_OK, READY, REQ_RUNDIR, RUNDIR, REQ_LINPACK, LINPACK, PAR_NAMES, OBS_NAMES,
-		START_RUN, RUN_FINISHED, RUN_FAILED, RUN_KILLED, TERMINATE,PING,REQ_KILL,IO_ERROR,CORRUPT_MESG};
+		START_RUN, RUN_FINISHED, RUN_FAILED, RUN_KILLED, TERMINATE,PING,REQ_KILL,IO_ERROR,CORRUPT_MESG, SLOTS,
+		BLOB_LIST, BLOB, ATTACH, BATCH};
 	static int get_new_group_id();
 	NetPackage(PackType _type=PackType::UNKN, int _group=-1, int _run_id=-1, const std::string &desc_str="");
 	~NetPackage(){}
 	const static int DESC_LEN = 41;
+	const static int SECURITY_CODE_LEN = 5;
+	//security code + size, type, group, run_id and desc
+	const static int HEADER_LEN = SECURITY_CODE_LEN + sizeof(int64_t) + sizeof(PackType) + 2 * sizeof(int64_t) + DESC_LEN;
 	int send(int sockfd, const void *data, int64_t data_len_l);
+	//pack the HEADER_LEN byte header (security code first) for a payload of data_len_l bytes into header_buf,
+	//for callers that send the message themselves
+	void pack_header(int64_t data_len_l, int8_t *header_buf) const;
 	int recv(int sockfd);
+	//check the security code at the start of a received message.  Returns 1, or -2 if it is wrong
+	static int check_security_code(const int8_t *header_buf);
+	//unpack a received header (HEADER_LEN bytes, starting with the security code).  Returns 1, or -2 if it is corrupt.
+	//get_data_len() then gives the size of the payload that follows
+	int unpack_header(const int8_t *header_buf);
+	int64_t get_data_len() const { return data_len; }
+	//append this package's header and a payload of data_len_l bytes to batch.  A BATCH message carries
+	//several framed messages in its payload so they go out in one send
+	void append_to_batch(std::vector<int8_t> &batch, const void *data, int64_t data_len_l) const;
+	//unpack the framed message starting at offset in a BATCH payload and advance offset past it.
+	//Returns 1, or -2 if it is corrupt
+	int unpack_from_batch(const std::vector<int8_t> &batch, size_t &offset);
 	void reset(PackType _type, int _group, int _run_id, const std::string &_desc);
 	PackType get_type() const {return type;}
 	int64_t get_run_id() const { return run_id; }
 	int64_t get_group_id() const { return group; }
+	std::string get_desc() const { return std::string((const char*)desc); }
 	const std::vector<int8_t> &get_data(){ return data; }
+	//hand the payload to another owner without copying it
+	void swap_data(std::vector<int8_t> &other) { data.swap(other); }
 	void print_header(std::ostream &fout);
 
 
@@ -42,7 +64,26 @@ private:
 	int64_t group;
 	int64_t run_id;
 	int8_t desc[DESC_LEN];
-	static int8_t security_code[5];
+	static int8_t security_code[SECURITY_CODE_LEN];
+	std::vector<int8_t> data;
+};
+
+//reassembles the messages arriving on one socket without blocking: each call reads what is available and
+//the package is only handed over once the whole message is in, so a stalled peer can't hold up the caller
+class NetPackageReader
+{
+public:
+	NetPackageReader() : n_read(0) {}
+	//call when select() reports sockfd readable.  Returns 1 when net_pack holds a complete message, 2 if the
+	//message is still incomplete, 0 if the connection closed, -1 on failure or -2 on a corrupt message
+	int read(int sockfd, NetPackage &net_pack);
+	//true while part of a message has been received
+	bool in_message() const { return n_read > 0; }
+private:
+	int8_t header_buf[NetPackage::HEADER_LEN];
+	//bytes of the current message read so far, header included
+	int64_t n_read;
+	NetPackage header_pack;
 	std::vector<int8_t> data;
 };
 
@@ -12,6 +12,7 @@
 #ifdef OS_WIN
 #include <Windows.h>
 #include <conio.h>
+#include <mstcpip.h>
 #endif
 
 
@@ -23,6 +24,9 @@
 #include<sys/wait.h>
 #include <errno.h>
 #include <signal.h>
+#include <netinet/tcp.h>
+#include <sys/uio.h>
+#include <climits>
 #endif
 
 using namespace std;
@@ -187,6 +191,121 @@ int w_sendall(int sockfd, int8_t *buf, int64_t *len)
 	return n; // return -1 on failure, 0 closed connection or 1 on success
 }
 
+int w_sendallv(int sockfd, const w_iobuf *bufs, int n_bufs, int64_t *len)
+{
+	int64_t total = 0; // how many bytes we've sent
+	int n = 1;
+#ifdef OS_WIN
+	vector<WSABUF> iov;
+	for (int i = 0; i < n_bufs; ++i)
+	{
+		if (bufs[i].len <= 0) continue;
+		WSABUF b;
+		b.buf = (CHAR*)bufs[i].buf;
+		b.len = (ULONG)bufs[i].len;
+		iov.push_back(b);
+	}
+	size_t i_iov = 0;
+	while (i_iov < iov.size())
+	{
+		DWORD n_sent = 0;
+		if (WSASend(sockfd, &iov[i_iov], DWORD(iov.size() - i_iov), &n_sent, 0, NULL, NULL) == SOCKET_ERROR)
+		{
+			n = -1;
+			break;
+		}
+		if (n_sent == 0) { n = 0; break; } //connection closed
+		total += n_sent;
+		//drop the buffers that went out and trim a partially sent one
+		while ((n_sent > 0) && (i_iov < iov.size()))
+		{
+			if (n_sent >= iov[i_iov].len)
+			{
+				n_sent -= iov[i_iov].len;
+				++i_iov;
+			}
+			else
+			{
+				iov[i_iov].buf += n_sent;
+				iov[i_iov].len -= n_sent;
+				n_sent = 0;
+			}
+		}
+	}
+#endif
+#ifdef OS_LINUX
+	vector<struct iovec> iov;
+	for (int i = 0; i < n_bufs; ++i)
+	{
+		if (bufs[i].len <= 0) continue;
+		struct iovec v;
+		v.iov_base = (void*)bufs[i].buf;
+		v.iov_len = (size_t)bufs[i].len;
+		iov.push_back(v);
+	}
+	size_t i_iov = 0;
+	while (i_iov < iov.size())
+	{
+		struct msghdr msg;
+		memset(&msg, 0, sizeof(msg));
+		msg.msg_iov = &iov[i_iov];
+		msg.msg_iovlen = min(iov.size() - i_iov, size_t(IOV_MAX));
+		ssize_t n_sent = sendmsg(sockfd, &msg, 0);
+		if (n_sent == -1) { n = -1; break; }  //error
+		if (n_sent == 0) { n = 0; break; } //connection closed
+		total += n_sent;
+		//drop the buffers that went out and trim a partially sent one
+		while ((n_sent > 0) && (i_iov < iov.size()))
+		{
+			if ((size_t)n_sent >= iov[i_iov].iov_len)
+			{
+				n_sent -= iov[i_iov].iov_len;
+				++i_iov;
+			}
+			else
+			{
+				iov[i_iov].iov_base = (char*)iov[i_iov].iov_base + n_sent;
+				iov[i_iov].iov_len -= n_sent;
+				n_sent = 0;
+			}
+		}
+	}
+#endif
+	*len = total; // return number actually sent here
+	if (n < 0) {
+		cerr << "w_sendallv error: " << w_get_error_msg() << endl;
+	}
+	return n; // return -1 on failure, 0 closed connection or 1 on success
+}
+
+int64_t w_send_nowait(int sockfd, const int8_t *buf, int64_t len)
+{
+	len = min(len, int64_t(W_SEND_NOWAIT_MAX));
+	if (len <= 0)
+		return 0;
+#ifdef OS_WIN
+	//select() only promises that one modest send() won't block
+	fd_set write_fds;
+	FD_ZERO(&write_fds);
+	FD_SET(sockfd, &write_fds);
+	timeval tv = { 0, 0 };
+	int n_ready = select(sockfd + 1, NULL, &write_fds, NULL, &tv);
+	if (n_ready == 0)
+		return 0;
+	int n = (n_ready < 0) ? -1 : ::send(sockfd, (const char*)buf, int(len), 0);
+#endif
+#ifdef OS_LINUX
+	ssize_t n = ::send(sockfd, buf, len, MSG_DONTWAIT);
+	if ((n < 0) && ((errno == EAGAIN) || (errno == EWOULDBLOCK) || (errno == EINTR)))
+		return 0;
+#endif
+	if (n <= 0)
+	{
+		cerr << "w_send_nowait error: " << w_get_error_msg() << endl;
+		return -1;
+	}
+	return n;
+}
 
 int w_recvall(int sockfd, int8_t *buf, int64_t *len)
 {
@@ -367,3 +486,37 @@ void w_sleep(int millisec)
    #endif
 }
 
+int w_set_keepalive(int sockfd, int idle_secs, int interval_secs)
+{
+	int err = 0;
+   #ifdef OS_WIN
+	struct tcp_keepalive ka;
+	ka.onoff = 1;
+	ka.keepalivetime = idle_secs * 1000;
+	ka.keepaliveinterval = interval_secs * 1000;
+	DWORD n_bytes = 0;
+	err = WSAIoctl(sockfd, SIO_KEEPALIVE_VALS, &ka, sizeof(ka), NULL, 0, &n_bytes, NULL, NULL);
+   #endif
+   #ifdef OS_LINUX
+	int on = 1;
+	int n_probes = 5;
+	err = setsockopt(sockfd, SOL_SOCKET, SO_KEEPALIVE, &on, sizeof(on));
+	//the idle time option is TCP_KEEPALIVE on mac
+	#if defined(TCP_KEEPIDLE)
+	if (err == 0) err = setsockopt(sockfd, IPPROTO_TCP, TCP_KEEPIDLE, &idle_secs, sizeof(idle_secs));
+	#elif defined(TCP_KEEPALIVE)
+	if (err == 0) err = setsockopt(sockfd, IPPROTO_TCP, TCP_KEEPALIVE, &idle_secs, sizeof(idle_secs));
+	#endif
+	#ifdef TCP_KEEPINTVL
+	if (err == 0) err = setsockopt(sockfd, IPPROTO_TCP, TCP_KEEPINTVL, &interval_secs, sizeof(interval_secs));
+	#endif
+	#ifdef TCP_KEEPCNT
+	if (err == 0) err = setsockopt(sockfd, IPPROTO_TCP, TCP_KEEPCNT, &n_probes, sizeof(n_probes));
+	#endif
+   #endif
+	if (err != 0)
+	{
+		cerr << "error setting keepalive on socket: " << w_get_error_msg() << endl;
+	}
+	return err;
+}
@@ -42,6 +42,19 @@ int w_listen(int sockfd, int backlog);
 int w_accept(int sockfd, struct sockaddr *addr, socklen_t *addr_len);
 int w_send(int sockfd, int8_t *buf, int64_t len, int flags);
 int w_sendall(int sockfd, int8_t *buf, int64_t *len);
+//one piece of a message sent with w_sendallv()
+struct w_iobuf
+{
+	const int8_t *buf;
+	int64_t len;
+};
+//send several buffers in place as one stream (sendmsg/WSASend) - len returns the number of bytes sent
+int w_sendallv(int sockfd, const w_iobuf *bufs, int n_bufs, int64_t *len);
+//largest piece handed to the socket by one w_send_nowait() call
+const int64_t W_SEND_NOWAIT_MAX = 1 << 16;
+//send as much of buf as the socket takes right now (at most W_SEND_NOWAIT_MAX bytes) without blocking.
+//Returns the number of bytes sent, 0 if the socket is full or -1 on failure
+int64_t w_send_nowait(int sockfd, const int8_t *buf, int64_t len);
 int w_recv(int sockfd, int8_t *buf, int64_t len, int flags);
 int w_recvall(int sockfd, int8_t *buf, int64_t *len);
 int w_select(int numfds, fd_set *readfds, fd_set *writefds,
@@ -53,5 +66,7 @@ void w_print_servinfo(struct addrinfo *res, std::ostream &fout);
 std::string w_get_addrinfo_string(struct addrinfo *p);
 std::string w_get_error_msg();
 void w_sleep(int millisec);
+//turn on TCP keepalive probes after idle_secs of silence, repeated every interval_secs
+int w_set_keepalive(int sockfd, int idle_secs, int interval_secs);
 #endif /* NETWORK_H_ */
 
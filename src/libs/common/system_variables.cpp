@@ -24,6 +24,7 @@
 #include <sstream>
 #include <cmath>
 #include <vector>
+#include <algorithm>
 #include "system_variables.h"
 
 #ifdef OS_WIN
@@ -33,6 +34,14 @@
 #ifdef OS_LINUX
 #include "stdio.h"
 #include <unistd.h>
+#include <poll.h>
+#include <thread>
+#include <chrono>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <cerrno>
+#include <cstring>
 
 #endif
 
@@ -123,14 +132,15 @@ bool OperSys::double_is_invalid(double x)
 
 
 #ifdef OS_WIN
-PROCESS_INFORMATION start(string &cmd_string)
+PROCESS_INFORMATION start(string &cmd_string, const string &work_dir)
 {
 	char* cmd_line = _strdup(cmd_string.c_str());
 	STARTUPINFO si;
 	PROCESS_INFORMATION pi;
 	ZeroMemory(&si, sizeof(si));
 	ZeroMemory(&pi, sizeof(pi));
-	if (!CreateProcess(NULL, cmd_line, NULL, NULL, false, 0, NULL, NULL, &si, &pi))
+	const char* cur_dir = work_dir.empty() ? NULL : work_dir.c_str();
+	if (!CreateProcess(NULL, cmd_line, NULL, NULL, false, 0, NULL, cur_dir, &si, &pi))
 	{
 		std::string cmd_string(cmd_line);
 		throw std::runtime_error("CreateProcess() failed for command: " + cmd_string);
@@ -142,7 +152,7 @@ PROCESS_INFORMATION start(string &cmd_string)
 
 
 #ifdef OS_LINUX
-int start(string &cmd_string)
+int start(string &cmd_string, const string &work_dir)
 {
 	//split cmd_string on whitespaces
 	stringstream cmd_ss(cmd_string);
@@ -167,23 +177,95 @@ int start(string &cmd_string)
 	//argv[cmds.size() + 1] = NULL; //last arg must be NULL
 
 	arg_v.push_back(NULL);
+	//the child of a multithreaded process may only make async-signal-safe calls and must never unwind
+	//back into the caller.  A chdir() or execvp() failure is written to a close-on-exec pipe as the errno
+	//value before _exit(), so a successful exec leaves the pipe empty and the command's own exit code
+	//(127 included) is never mistaken for a failure to start
+	int err_pipe[2];
+#ifdef __linux__
+	if (pipe2(err_pipe, O_CLOEXEC) != 0)
+		throw std::runtime_error("pipe() failed for command: " + cmd_string);
+#else
+	if (pipe(err_pipe) != 0)
+		throw std::runtime_error("pipe() failed for command: " + cmd_string);
+	fcntl(err_pipe[0], F_SETFD, FD_CLOEXEC);
+	fcntl(err_pipe[1], F_SETFD, FD_CLOEXEC);
+#endif
 	pid_t pid = fork();
 	if (pid == 0)
 	{
+		close(err_pipe[0]);
 		setpgid(0, 0);
-		int success = execvp(arg_v[0], const_cast<char* const*>(&(arg_v[0])));
-		if (success == -1)
+		int err_stage = 0;
+		if ((!work_dir.empty()) && (::chdir(work_dir.c_str()) != 0))
+			err_stage = 1;
+		else
 		{
-			throw std::runtime_error("execv() failed for command: " + cmd_string);
+			execvp(arg_v[0], const_cast<char* const*>(&(arg_v[0])));
+			err_stage = 2;
 		}
+		int err_info[2] = { err_stage, errno };
+		ssize_t n = write(err_pipe[1], err_info, sizeof(err_info));
+		(void)n;
+		_exit(127);
+	}
+	else if (pid < 0)
+	{
+		close(err_pipe[0]);
+		close(err_pipe[1]);
+		throw std::runtime_error("fork() failed for command: " + cmd_string);
 	}
-	else
+	setpgid(pid, pid);
+	close(err_pipe[1]);
+	int err_info[2] = { 0, 0 };
+	ssize_t n_read;
+	do
+	{
+		n_read = read(err_pipe[0], err_info, sizeof(err_info));
+	} while ((n_read < 0) && (errno == EINTR));
+	close(err_pipe[0]);
+	if (n_read > 0)
 	{
-		setpgid(pid, pid);
+		//reap the child so it does not linger as a zombie
+		int status;
+		waitpid(pid, &status, 0);
+		if (err_info[0] == 1)
+			throw std::runtime_error("chdir() failed for command: " + cmd_string + " in " + work_dir +
+				": " + strerror(err_info[1]));
+		throw std::runtime_error("execvp() failed for command: " + cmd_string + ": " + strerror(err_info[1]));
 	}
 	return pid;
 }
 
+
+int open_pid_fd(int pid)
+{
+#if defined(__linux__) && defined(SYS_pidfd_open)
+	return (int)syscall(SYS_pidfd_open, (pid_t)pid, 0);
+#else
+	return -1;
 #endif
+}
 
+void wait_pid_fd(int pid_fd, int wake_fd, int timeout_milli_secs)
+{
+	struct pollfd pfds[2];
+	int n_fds = 0;
+	for (int fd : { pid_fd, wake_fd })
+	{
+		if (fd < 0)
+			continue;
+		pfds[n_fds].fd = fd;
+		pfds[n_fds].events = POLLIN;
+		pfds[n_fds].revents = 0;
+		++n_fds;
+	}
+	if (n_fds == 0)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(max(timeout_milli_secs, 0)));
+		return;
+	}
+	poll(pfds, n_fds, timeout_milli_secs);
+}
 
+#endif
@@ -38,10 +38,18 @@ public:
 
 #ifdef OS_WIN
 #include <Windows.h>
-PROCESS_INFORMATION start(std::string &cmd_string);
+PROCESS_INFORMATION start(std::string &cmd_string, const std::string &work_dir = "");
 #endif
 #ifdef OS_LINUX
-int start(std::string &cmd_string);
+//fork and exec cmd_string in its own process group.  Throws if the command cannot be started in
+//work_dir; the exit code of a started command is left to the caller
+int start(std::string &cmd_string, const std::string &work_dir = "");
+//file descriptor that becomes readable when process pid exits (-1 if pidfds are not supported)
+int open_pid_fd(int pid);
+//wait up to timeout_milli_secs (-1 for no limit) for the process behind pid_fd to exit or for
+//wake_fd to become readable.  Invalid (-1) descriptors are skipped; sleeps for the full timeout
+//when neither is valid
+void wait_pid_fd(int pid_fd, int wake_fd, int timeout_milli_secs);
 #endif
 
 
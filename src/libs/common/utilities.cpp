@@ -9,6 +9,7 @@
 #include <cstring>
 #include <cmath>
 #include <cassert>
+#include <cstdio>
 #include <mutex>
 #include "config_os.h"
 #include "Transformable.h"
@@ -23,6 +24,20 @@
 
 #include "utilities.h"
 #include "system_variables.h"
+#ifdef OS_LINUX
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utime.h>
+#endif
+#ifdef __linux__
+#include <sys/eventfd.h>
+#endif
+#ifdef OS_WIN
+#include <direct.h>
+#include <io.h>
+#include <sys/utime.h>
+#endif
 
 
 using namespace std;
@@ -307,6 +322,79 @@ void copyfile(const string &from_file, const string &to_file)
     dest.close();
 }
 
+void copy_dir_contents(const string &src_dir, const string &dst_dir, const string &skip_prefix)
+{
+	copy_dir_contents(src_dir, dst_dir, [&skip_prefix](const string &name)
+	{
+		return (!skip_prefix.empty()) && (name.compare(0, skip_prefix.size(), skip_prefix) == 0);
+	});
+}
+
+void copy_dir_contents(const string &src_dir, const string &dst_dir, const std::function<bool(const string&)> &skip)
+{
+	vector<pair<string, bool>> entries;
+#ifdef OS_LINUX
+	DIR *dir = opendir(src_dir.c_str());
+	if (dir == NULL)
+		throw PestError("unable to open directory '" + src_dir + "' for copying");
+	struct dirent *entry;
+	while ((entry = readdir(dir)) != NULL)
+	{
+		struct stat st;
+		string src = src_dir + "/" + entry->d_name;
+		if ((stat(src.c_str(), &st) != 0) || !(S_ISDIR(st.st_mode) || S_ISREG(st.st_mode)))
+			continue;
+		entries.push_back(make_pair(string(entry->d_name), S_ISDIR(st.st_mode)));
+	}
+	closedir(dir);
+#endif
+#ifdef OS_WIN
+	struct _finddata_t entry;
+	intptr_t handle = _findfirst((src_dir + "\\*").c_str(), &entry);
+	if (handle == -1)
+		throw PestError("unable to open directory '" + src_dir + "' for copying");
+	do
+	{
+		entries.push_back(make_pair(string(entry.name), (entry.attrib & _A_SUBDIR) != 0));
+	} while (_findnext(handle, &entry) == 0);
+	_findclose(handle);
+#endif
+	for (auto &e : entries)
+	{
+		const string &name = e.first;
+		if ((name == ".") || (name == ".."))
+			continue;
+		if (skip(name))
+			continue;
+		string src = src_dir + OperSys::DIR_SEP + name;
+		string dst = dst_dir + OperSys::DIR_SEP + name;
+		if (e.second)
+		{
+#ifdef OS_LINUX
+			struct stat st;
+			stat(src.c_str(), &st);
+			mkdir(dst.c_str(), st.st_mode);
+#endif
+#ifdef OS_WIN
+			_mkdir(dst.c_str());
+#endif
+			copy_dir_contents(src, dst, string());
+		}
+		else
+		{
+			ifstream f_src(src, ios::binary);
+			ofstream f_dst(dst, ios::binary);
+			f_dst << f_src.rdbuf();
+			f_dst.close();
+#ifdef OS_LINUX
+			struct stat st;
+			if (stat(src.c_str(), &st) == 0)
+				chmod(dst.c_str(), st.st_mode);
+#endif
+		}
+	}
+}
+
 template <class keyType, class dataType>
 vector<keyType> get_map_keys(const map<keyType,dataType> &my_map)
 {
@@ -553,17 +641,140 @@ bool check_exist_out(std::string filename)
 	}
 }
 
+bool FileStamp::operator==(const FileStamp &other) const
+{
+	if (exists != other.exists)
+		return false;
+	if (!exists)
+		return true;
+	return (id == other.id) && (size == other.size) && (mtime_ns == other.mtime_ns);
+}
+
+FileStamp get_file_stamp(const std::string &filename)
+{
+	FileStamp stamp;
+	stamp.exists = false;
+	stamp.id = 0;
+	stamp.size = 0;
+	stamp.mtime_ns = 0;
+#ifdef OS_LINUX
+	struct stat st;
+	if (stat(filename.c_str(), &st) != 0)
+		return stamp;
+	stamp.exists = true;
+	stamp.id = st.st_ino;
+	stamp.size = st.st_size;
+#ifdef __APPLE__
+	stamp.mtime_ns = int64_t(st.st_mtimespec.tv_sec) * 1000000000 + st.st_mtimespec.tv_nsec;
+#else
+	stamp.mtime_ns = int64_t(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+#endif
+#endif
+#ifdef OS_WIN
+	WIN32_FILE_ATTRIBUTE_DATA data;
+	if (!GetFileAttributesExA(filename.c_str(), GetFileExInfoStandard, &data))
+		return stamp;
+	stamp.exists = true;
+	stamp.size = (int64_t(data.nFileSizeHigh) << 32) | data.nFileSizeLow;
+	//100 ns ticks
+	stamp.mtime_ns = ((int64_t(data.ftLastWriteTime.dwHighDateTime) << 32) | data.ftLastWriteTime.dwLowDateTime) * 100;
+#endif
+	return stamp;
+}
+
+bool backdate_file(const std::string &filename)
+{
+#ifdef OS_LINUX
+	struct utimbuf times;
+	times.actime = 1;
+	times.modtime = 1;
+	return utime(filename.c_str(), &times) == 0;
+#endif
+#ifdef OS_WIN
+	struct _utimbuf times;
+	times.actime = 1;
+	times.modtime = 1;
+	return _utime(filename.c_str(), &times) == 0;
+#endif
+}
+
+bool touch_file(const std::string &filename)
+{
+#ifdef OS_LINUX
+	return utime(filename.c_str(), NULL) == 0;
+#endif
+#ifdef OS_WIN
+	return _utime(filename.c_str(), NULL) == 0;
+#endif
+}
+
+bool replace_file(const std::string &src, const std::string &dest)
+{
+#ifdef OS_LINUX
+	return rename(src.c_str(), dest.c_str()) == 0;
+#endif
+#ifdef OS_WIN
+	return MoveFileExA(src.c_str(), dest.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#endif
+}
+
+void RunUsage::add(const RunUsage &other)
+{
+	if (!other.collected)
+		return;
+	collected = true;
+	cpu_sec += other.cpu_sec;
+	max_rss_kb = max(max_rss_kb, other.max_rss_kb);
+	n_read_ops += other.n_read_ops;
+	n_write_ops += other.n_write_ops;
+}
+
 thread_flag::thread_flag(bool _flag)
 {
 	flag = _flag;
+	wake_fd = -1;
+}
+
+thread_flag::~thread_flag()
+{
+#ifdef OS_LINUX
+	if (wake_fd >= 0)
+		close(wake_fd);
+#endif
 }
 
 bool thread_flag::set(bool f)
 {
 	std::lock_guard<std::mutex> lock(m);
 	flag = f;
+#ifdef __linux__
+	if (wake_fd >= 0)
+	{
+		//the eventfd counter is nonzero exactly while the flag is set
+		uint64_t count = 1;
+		ssize_t n;
+		if (flag)
+			n = write(wake_fd, &count, sizeof(count));
+		else
+			n = read(wake_fd, &count, sizeof(count));
+		(void)n;
+	}
+#endif
 	return flag;
 }
+
+int thread_flag::get_wake_fd()
+{
+	std::lock_guard<std::mutex> lock(m);
+	//eventfd is linux only - elsewhere callers fall back to a timed poll
+#ifdef __linux__
+	if (wake_fd < 0)
+	{
+		wake_fd = eventfd(flag ? 1 : 0, EFD_NONBLOCK | EFD_CLOEXEC);
+	}
+#endif
+	return wake_fd;
+}
 bool thread_flag::get()
 {
 	std::lock_guard<std::mutex> lock(m);
@@ -20,6 +20,7 @@
 #include "network_package.h"
 #include <thread>
 #include <chrono>
+#include <functional>
 #include <Eigen/Dense>
 #include <Eigen/Sparse>
 
@@ -217,6 +218,11 @@ class CompareItemInSet
 
 void copyfile(const string &from_file, const string &to_file);
 
+//recursively copy the contents of src_dir into the existing dst_dir, skipping top level entries that start with skip_prefix
+void copy_dir_contents(const string &src_dir, const string &dst_dir, const string &skip_prefix);
+//as above, skipping the top level entries whose names skip() returns true for
+void copy_dir_contents(const string &src_dir, const string &dst_dir, const std::function<bool(const string&)> &skip);
+
 std::string fortran_str_2_string(char *fstr, int str_len);
 
 std::vector<std::string> fortran_str_array_2_vec(char *fstr, int str_len, int fstr_len);
@@ -229,6 +235,42 @@ bool check_exist_in(std::string filename);
 
 bool check_exist_out(std::string filename);
 
+//what a file looked like at one point - used to tell whether it has been rewritten since
+struct FileStamp
+{
+	bool exists;
+	int64_t id;
+	int64_t size;
+	int64_t mtime_ns;
+	bool operator==(const FileStamp &other) const;
+};
+
+FileStamp get_file_stamp(const std::string &filename);
+
+//set the modification time of an existing file to the epoch, so any rewrite changes its stamp
+//even on filesystems with coarse timestamps
+bool backdate_file(const std::string &filename);
+
+//set the modification time of an existing file to now
+bool touch_file(const std::string &filename);
+
+//move src over dest in one step, so dest is never missing or half written
+bool replace_file(const std::string &src, const std::string &dest);
+
+//resources used by the processes of a model run.  Read and write counts are block operations
+//on linux and i/o operations on windows
+struct RunUsage
+{
+	RunUsage() : collected(false), cpu_sec(0.0), max_rss_kb(0.0), n_read_ops(0.0), n_write_ops(0.0) {}
+	bool collected;
+	double cpu_sec;
+	double max_rss_kb;
+	double n_read_ops;
+	double n_write_ops;
+	//fold in the usage of another command of the same run
+	void add(const RunUsage &other);
+};
+
 pair<string, string> parse_plusplus_line(const string& line);
 
 //template <class dataType>
@@ -245,11 +287,16 @@ class thread_flag
 public:
 
 	thread_flag(bool _flag);
+	~thread_flag();
 	bool set(bool _flag);
 	bool get();
+	//file descriptor that is readable while the flag is set, so a thread can poll() on it
+	//along with other descriptors.  -1 if not supported
+	int get_wake_fd();
 
 private:
 	bool flag;
+	int wake_fd;
 	std::mutex m;
 
 };
@@ -561,6 +561,7 @@ double sequentialLP::get_probit()
 void sequentialLP::initialize_and_check()
 {
 	ofstream &f_rec = file_mgr_ptr->rec_ofstream();
+	jco.set_batch_runs(pest_scenario.get_pestpp_options().get_jac_batch_runs());
 	//TODO: handle restart condition
 
 	if (pest_scenario.get_control_info().pestmode != ControlInfo::PestMode::ESTIMATION)
@@ -1924,7 +1925,33 @@ void sequentialLP::iter_presolve()
 
 		bool init_obs = false;
 		if (slp_iter == 1) init_obs = true;
-		bool success = jco.build_runs(all_pars_and_dec_vars, constraints_sim, names_to_run, par_trans,
+
+		//only re-perturb the decision vars whose response matrix columns are most likely stale
+		vector<string> refresh_names = names_to_run;
+		Jacobian prev_jco(*file_mgr_ptr);
+		bool partial_refresh = false;
+		double refresh_frac = pest_scenario.get_pestpp_options().get_jac_refresh_frac();
+		if ((slp_iter > 1) && (refresh_frac < 1.0) && (!jco.has_col_info()))
+		{
+			//eg read from ++base_jacobian - it can't be partly refreshed
+			f_rec << "  ---  response matrix has no column history, recomputing all columns" << endl;
+			cout << "  ---  response matrix has no column history, recomputing all columns" << endl;
+		}
+		else if ((slp_iter > 1) && (refresh_frac < 1.0))
+		{
+			refresh_names = jco.select_refresh_pars(names_to_run, par_trans.ctl2numeric_cp(all_pars_and_dec_vars),
+				refresh_frac, pest_scenario.get_pestpp_options().get_jac_refresh_max_age());
+			if (refresh_names.size() < names_to_run.size())
+			{
+				prev_jco = jco;
+				partial_refresh = true;
+				f_rec << "  ---  partial response matrix refresh: recomputing " << refresh_names.size() << " of "
+					<< names_to_run.size() << " columns" << endl;
+				cout << "  ---  partial response matrix refresh: recomputing " << refresh_names.size() << " of "
+					<< names_to_run.size() << " columns" << endl;
+			}
+		}
+		bool success = jco.build_runs(all_pars_and_dec_vars, constraints_sim, refresh_names, par_trans,
 			pest_scenario.get_base_group_info(), pest_scenario.get_ctl_parameter_info(),
 			*run_mgr_ptr, out_of_bounds,false,init_obs);
 		if (!success)
@@ -1941,6 +1968,8 @@ void sequentialLP::iter_presolve()
 			*null_prior, false,false);
 		if (!success)
 			throw_sequentialLP_error("error processing response matrix runs ", jco.get_failed_parameter_names());
+		if (partial_refresh)
+			jco.merge_stale_cols(prev_jco, names_to_run);
 
 		stringstream ss;
 		ss << slp_iter << ".jcb";
@@ -1886,6 +1886,8 @@ map<int,int> ParameterEnsemble::add_runs(RunManagerAbstract *run_mgr_ptr,const v
 			throw_ensemble_error(ss.str());
 		}
 		run_id = run_mgr_ptr->add_run(pars_real);
+		if (rname == base_name)
+			run_mgr_ptr->set_run_priority(run_id, 1);
 		real_run_ids[idx]  = run_id;
 	}
 	return real_run_ids;
@@ -21,6 +21,9 @@
 #include <vector>
 #include <fstream>
 #include <iomanip>
+#include <algorithm>
+#include <cmath>
+#include <limits>
 #include "Jacobian.h"
 #include "Transformable.h"
 #include "ParamTransformSeq.h"
@@ -58,6 +61,194 @@ void Jacobian::set_base_sim_obs(Observations _base_sim_obs)
 Jacobian::~Jacobian() {
 }
 
+int Jacobian::secant_update(const vector<string> &obs_names, const Eigen::MatrixXd &del_numeric_pars,
+	const Eigen::MatrixXd &del_obs, const Parameters &new_base_numeric_pars)
+{
+	//rank-k (multiple secant) Broyden update of the observation rows:
+	//  J = J + (dY - J dX) pinv(dX^T dX) dX^T
+	//the rows of del_numeric_pars are ordered as base_numeric_par_names and the rows of del_obs
+	//as obs_names.  Prior information rows are linear in the numeric parameters and are not changed.
+	//Returns the number of independent secant directions used.
+	debug_msg("Jacobian::secant_update begin");
+	if ((del_numeric_pars.cols() == 0) || ((size_t)del_numeric_pars.rows() != base_numeric_par_names.size()))
+		return 0;
+	MatrixXd gram = del_numeric_pars.transpose() * del_numeric_pars;
+	JacobiSVD<MatrixXd> svd_fac(gram, ComputeFullU | ComputeFullV);
+	VectorXd sing = svd_fac.singularValues();
+	if (sing(0) <= 0.0)
+		return 0;
+	int n_dir = 0;
+	VectorXd sing_inv = VectorXd::Zero(sing.size());
+	for (int i = 0; i < sing.size(); ++i)
+	{
+		if (sing(i) / sing(0) > 1.0e-10)
+		{
+			sing_inv(i) = 1.0 / sing(i);
+			++n_dir;
+		}
+	}
+	MatrixXd proj = svd_fac.matrixV() * sing_inv.asDiagonal() * svd_fac.matrixU().transpose() * del_numeric_pars.transpose();
+
+	MatrixXd jac_dense = matrix;
+	MatrixXd jac_del = jac_dense * del_numeric_pars;
+	unordered_map<string, int> obs2row_map = get_obs2row_map();
+	unordered_map<string, int>::const_iterator found;
+	for (size_t i = 0; i < obs_names.size(); ++i)
+	{
+		found = obs2row_map.find(obs_names[i]);
+		if (found == obs2row_map.end())
+			continue;
+		jac_dense.row(found->second) += (del_obs.row(i) - jac_del.row(found->second)) * proj;
+	}
+	matrix = jac_dense.sparseView();
+	base_numeric_parameters = new_base_numeric_pars;
+	debug_msg("Jacobian::secant_update end");
+	return n_dir;
+}
+
+void Jacobian::stamp_cols()
+{
+	//record the base parameter values used to compute the current columns
+	col_numeric_pars.clear();
+	col_age.clear();
+	for (auto &par_name : base_numeric_par_names)
+	{
+		col_numeric_pars.insert(par_name, base_numeric_parameters.get_rec(par_name));
+		col_age[par_name] = 0;
+	}
+}
+
+vector<string> Jacobian::select_refresh_pars(const vector<string> &numeric_par_names, const Parameters &cur_numeric_pars,
+	double refresh_frac, int max_age) const
+{
+	//rank the columns by how far the parameter has moved since the column was last computed, scaled by
+	//the column norm (a first-order measure of how stale the sensitivities are) and return the names of the
+	//top refresh_frac of the parameters.  Columns that are missing, failed or have been reused for max_age
+	//iterations are always returned.  Returned names are in the order of numeric_par_names
+	unordered_map<string, int> par2col_map = get_par2col_map();
+	set<string> refresh_names;
+	vector<pair<double, string> > score_vec;
+	for (auto &par_name : numeric_par_names)
+	{
+		auto icol = par2col_map.find(par_name);
+		auto iage = col_age.find(par_name);
+		auto i_col_par = col_numeric_pars.find(par_name);
+		auto i_cur_par = cur_numeric_pars.find(par_name);
+		if ((icol == par2col_map.end()) || (iage == col_age.end()) || (i_col_par == col_numeric_pars.end())
+			|| (i_cur_par == cur_numeric_pars.end()) || (failed_parameter_names.find(par_name) != failed_parameter_names.end())
+			|| (iage->second >= max_age))
+		{
+			refresh_names.insert(par_name);
+			continue;
+		}
+		double score = abs(i_cur_par->second - i_col_par->second) * matrix.col(icol->second).norm();
+		if (score > 0.0)
+			score_vec.push_back(make_pair(score, par_name));
+	}
+	sort(score_vec.begin(), score_vec.end(), [](const pair<double, string> &a, const pair<double, string> &b)
+		{ return a.first > b.first; });
+	int n_refresh = (int)ceil(refresh_frac * numeric_par_names.size()) - refresh_names.size();
+	for (size_t i = 0; ((int)i < n_refresh) && (i < score_vec.size()); ++i)
+		refresh_names.insert(score_vec[i].second);
+
+	vector<string> refresh_par_names;
+	for (auto &par_name : numeric_par_names)
+	{
+		if (refresh_names.find(par_name) != refresh_names.end())
+			refresh_par_names.push_back(par_name);
+	}
+	return refresh_par_names;
+}
+
+void Jacobian::merge_stale_cols(const Jacobian &prev_jac, const vector<string> &numeric_par_names)
+{
+	//fill the columns that were not recomputed by the last build_runs()/process_runs() with the
+	//columns from prev_jac.  Columns are reordered to follow numeric_par_names.
+	debug_msg("Jacobian::merge_stale_cols begin");
+	unordered_map<string, int> par2col_map = get_par2col_map();
+	unordered_map<string, int> prev_par2col_map = prev_jac.get_par2col_map();
+	unordered_map<string, int> obs2row_map = get_obs2row_map();
+	vector<int> prev_row2row(prev_jac.base_sim_obs_names.size(), -1);
+	for (size_t i = 0; i < prev_jac.base_sim_obs_names.size(); ++i)
+	{
+		auto found = obs2row_map.find(prev_jac.base_sim_obs_names[i]);
+		if (found != obs2row_map.end())
+			prev_row2row[i] = found->second;
+	}
+
+	vector<Eigen::Triplet<double> > triplet_list;
+	vector<string> new_par_names;
+	Parameters new_col_numeric_pars;
+	map<string, int> new_col_age;
+	for (auto &par_name : numeric_par_names)
+	{
+		int icol = new_par_names.size();
+		auto found = par2col_map.find(par_name);
+		if (found != par2col_map.end())
+		{
+			for (SparseMatrix<double>::InnerIterator it(matrix, found->second); it; ++it)
+				triplet_list.push_back(Eigen::Triplet<double>(it.row(), icol, it.value()));
+			new_col_numeric_pars.insert(par_name, col_numeric_pars.get_rec(par_name));
+			new_col_age[par_name] = 0;
+		}
+		else
+		{
+			found = prev_par2col_map.find(par_name);
+			if ((found == prev_par2col_map.end()) || (failed_parameter_names.find(par_name) != failed_parameter_names.end()))
+				continue;
+			for (SparseMatrix<double>::InnerIterator it(prev_jac.matrix, found->second); it; ++it)
+			{
+				if (prev_row2row[it.row()] >= 0)
+					triplet_list.push_back(Eigen::Triplet<double>(prev_row2row[it.row()], icol, it.value()));
+			}
+			auto i_col_par = prev_jac.col_numeric_pars.find(par_name);
+			if (i_col_par != prev_jac.col_numeric_pars.end())
+				new_col_numeric_pars.insert(par_name, i_col_par->second);
+			auto iage = prev_jac.col_age.find(par_name);
+			new_col_age[par_name] = (iage != prev_jac.col_age.end()) ? iage->second + 1 : 1;
+		}
+		new_par_names.push_back(par_name);
+	}
+	base_numeric_par_names = new_par_names;
+	matrix.resize(base_sim_obs_names.size(), base_numeric_par_names.size());
+	matrix.setZero();
+	matrix.setFromTriplets(triplet_list.begin(), triplet_list.end());
+	col_numeric_pars = new_col_numeric_pars;
+	col_age = new_col_age;
+	debug_msg("Jacobian::merge_stale_cols end");
+}
+
+void Jacobian::save_col_info(const string &ext) const
+{
+	//one line per column: parameter name, numeric value when last recomputed, age
+	ofstream fout(file_manager.build_filename(ext));
+	if (!fout.good())
+		throw runtime_error("unable to open jacobian column file: " + file_manager.build_filename(ext) + " for writing");
+	fout << setprecision(numeric_limits<double>::digits10 + 2);
+	for (auto &par : col_numeric_pars)
+	{
+		auto iage = col_age.find(par.first);
+		fout << par.first << " " << par.second << " " << ((iage != col_age.end()) ? iage->second : 0) << endl;
+	}
+}
+
+void Jacobian::read_col_info(const string &filename)
+{
+	ifstream fin(filename);
+	if (!fin.good())
+		throw runtime_error("unable to open jacobian column file: " + filename + " for reading");
+	col_numeric_pars.clear();
+	col_age.clear();
+	string par_name;
+	double value;
+	int age;
+	while (fin >> par_name >> value >> age)
+	{
+		col_numeric_pars.insert(par_name, value);
+		col_age[par_name] = age;
+	}
+}
+
 
 void Jacobian::remove_cols(std::set<string> &rm_parameter_names)
 {
@@ -220,6 +411,8 @@ bool Jacobian::build_runs(Parameters &ctl_pars, Observations &ctl_obs, vector<st
 	// add base run
 	Parameters model_pars = par_transform.ctl2model_cp(ctl_pars);
 	int run_id = run_manager.add_run(model_pars, "", 0);
+	//the base run is needed for every derivative so dispatch it first
+	run_manager.set_run_priority(run_id, 1);
 
 	if (!calc_init_obs) {
 		const Observations &observations = ctl_obs;
@@ -374,6 +567,7 @@ bool Jacobian::process_runs(ParamTransformSeq &par_transform,
 	matrix.resize(base_sim_obs_names.size(), base_numeric_par_names.size());
 	matrix.setZero();
 	matrix.setFromTriplets(triplet_list.begin(), triplet_list.end());
+	stamp_cols();
 	// clean up
 	run_manager.free_memory();
 	return true;
@@ -695,6 +889,8 @@ Jacobian& Jacobian::operator=(const Jacobian &rhs)
 	base_sim_observations = rhs.base_sim_observations;
 	matrix = rhs.matrix;
 	file_manager = rhs.file_manager;
+	col_numeric_pars = rhs.col_numeric_pars;
+	col_age = rhs.col_age;
 	return *this;
 }
 void Jacobian::transform(const ParamTransformSeq &par_trans, void(ParamTransformSeq::*meth_prt)(Jacobian &jac) const)
@@ -837,6 +1033,9 @@ void Jacobian::save(const string &ext) const
 void Jacobian::read(const string &filename)
 {
 	pest_utils::read_binary(filename,base_sim_obs_names, base_numeric_par_names, matrix);
+	//the jco format doesn't record where the columns were computed
+	col_numeric_pars.clear();
+	col_age.clear();
 	//ifstream fin;
 	//fin.open(filename.c_str(), ifstream::binary|ios::in);
 
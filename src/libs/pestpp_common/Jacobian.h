@@ -108,6 +108,16 @@ public:
 
 	void set_base_numeric_pars(Parameters _base_numeric_pars);
 	void set_base_sim_obs(Observations _base_sim_obs);
+	int secant_update(const vector<string> &obs_names, const Eigen::MatrixXd &del_numeric_pars,
+		const Eigen::MatrixXd &del_obs, const Parameters &new_base_numeric_pars);
+	vector<string> select_refresh_pars(const vector<string> &numeric_par_names, const Parameters &cur_numeric_pars,
+		double refresh_frac, int max_age) const;
+	void merge_stale_cols(const Jacobian &prev_jac, const vector<string> &numeric_par_names);
+	//the per-column refresh bookkeeping is not part of the jco format, so it is saved and read separately
+	void save_col_info(const string &ext) const;
+	void read_col_info(const string &filename);
+	//false for a jacobian read from a file - there is nothing to rank its columns by
+	bool has_col_info() const { return !col_age.empty(); }
 
 protected:
 
@@ -121,6 +131,10 @@ protected:
 	//const vector<string> &ctl_file_ordered_pi_names;
 	Eigen::SparseMatrix<double> matrix;
 	FileManager &file_manager;  // filemanger used to get name of jaobian file
+	Parameters col_numeric_pars;  //base parameter values used when each column was last recomputed
+	map<string, int> col_age;  //number of iterations each column has been reused without being recomputed
+
+	void stamp_cols();
 
 	virtual std::vector<Eigen::Triplet<double> > calc_derivative(const string &numeric_par_name, double base_numeric_par_value, int jcol, list<JacobianRun> &run_list, const ParameterGroupInfo &group_info,
 		const PriorInformation &prior_info, bool splitswh_flag);
@@ -24,6 +24,7 @@
 #include <iostream>
 #include <iomanip>
 #include <algorithm>
+#include <thread>
 #include "Jacobian_1to1.h"
 #include "Transformable.h"
 #include "ParamTransformSeq.h"
@@ -37,11 +38,12 @@
 #include "PriorInformation.h"
 #include "debug.h"
 #include "OutputFileWriter.h"
+#include "Transformation.h"
 
 using namespace std;
 using namespace pest_utils;
 
-Jacobian_1to1::Jacobian_1to1(FileManager &_file_manager, OutputFileWriter &_output_file_writer) : Jacobian(_file_manager)
+Jacobian_1to1::Jacobian_1to1(FileManager &_file_manager, OutputFileWriter &_output_file_writer) : Jacobian(_file_manager), batch_runs(true)
 {
 	output_file_writer_ptr = &_output_file_writer;
 }
@@ -62,6 +64,8 @@ bool Jacobian_1to1::build_runs(Parameters &ctl_pars, Observations &ctl_obs, vect
 	failed_ctl_parameters.clear();
 	// add base run
 	int run_id = run_manager.add_run(model_parameters, "", 0);
+	//the base run is needed for every derivative so dispatch it first
+	run_manager.set_run_priority(run_id, 1);
 	//if base run is has already been complete, update it and mark it as complete
 	// compute runs for to jacobain calculation as it is influenced by derivative type( forward or central)
 	if (!calc_init_obs) {
@@ -69,51 +73,9 @@ bool Jacobian_1to1::build_runs(Parameters &ctl_pars, Observations &ctl_obs, vect
 		run_manager.update_run(run_id, model_parameters, init_obs);
 	}
 
-	Parameters new_derivative_pars;
-	bool success;
-	Parameters base_derivative_parameters = par_transform.numeric2active_ctl_cp(base_numeric_parameters);
-	Parameters base_model_parameters = par_transform.numeric2model_cp(base_numeric_parameters);
 	//Loop through derivative parameters and build the parameter sets necessary for computing the jacobian
 	std::map<string, vector<int>> par_run_map;
-	for (auto &i_name : numeric_par_names)
-	{
-		assert(base_derivative_parameters.find(i_name) != base_derivative_parameters.end());
-		vector<double> tmp_del_numeric_par_vec;
-		double derivative_par_value = base_derivative_parameters.get_rec(i_name);
-		success = get_derivative_parameters(i_name, derivative_par_value, par_transform, group_info, ctl_par_info,
-			tmp_del_numeric_par_vec, phiredswh_flag);
-		if (success && !tmp_del_numeric_par_vec.empty())
-		{
-			// update changed model parameters in model_parameters
-			for (const auto &par : tmp_del_numeric_par_vec)
-			{
-				Parameters new_pars;
-				new_pars.insert(make_pair(i_name, par));
-				par_transform.active_ctl2model_ip(new_pars);
-				for (auto &ipar : new_pars)
-				{
-					model_parameters[ipar.first] = ipar.second;
-				}
-				int id = run_manager.add_run(model_parameters, i_name, par);
-				if (par_run_map.count(i_name) == 0)
-					par_run_map[i_name] = vector<int>{ id };
-				else
-					par_run_map[i_name].push_back(id);
-				//reset the perturbed parameters back to the values associated with the base condition
-				for (const auto &ipar : new_pars)
-				{
-					model_parameters[ipar.first] = base_model_parameters[ipar.first];
-				}
-			}
-		}
-		else
-		{
-			cout << endl << " warning: failed to compute parameter deriviative for " << i_name << endl;
-			file_manager.rec_ofstream() << " warning: failed to compute parameter deriviative for " << i_name << endl;
-			failed_parameter_names.insert(i_name);
-			failed_to_increment_parmaeters.insert(i_name, derivative_par_value);
-		}
-	}
+	add_derivative_runs(numeric_par_names, model_parameters, par_transform, group_info, ctl_par_info, run_manager, phiredswh_flag, par_run_map);
 	output_file_writer_ptr->write_jco_run_id(run_manager.get_cur_groupid(), par_run_map);
 	ofstream &fout_restart = file_manager.get_ofstream("rst");
 	debug_print(failed_parameter_names);
@@ -140,6 +102,8 @@ bool Jacobian_1to1::build_runs(ModelRun &init_model_run, vector<string> numeric_
 	failed_ctl_parameters.clear();
 	// add base run
 	int run_id = run_manager.add_run(model_parameters, "", 0);
+	//the base run is needed for every derivative so dispatch it first
+	run_manager.set_run_priority(run_id, 1);
 	//if base run is has already been complete, update it and mark it as complete
 	// compute runs for to jacobain calculation as it is influenced by derivative type( forward or central)
 	if (!calc_init_obs) {
@@ -147,12 +111,181 @@ bool Jacobian_1to1::build_runs(ModelRun &init_model_run, vector<string> numeric_
 		run_manager.update_run(run_id, model_parameters, init_obs);
 	}
 
-	Parameters new_derivative_pars;
-	bool success;
-	Parameters base_derivative_parameters = par_transform.numeric2active_ctl_cp(base_numeric_parameters);
-	Parameters base_model_parameters = par_transform.numeric2model_cp(base_numeric_parameters);
 	//Loop through derivative parameters and build the parameter sets necessary for computing the jacobian
 	std::map<string, vector<int>> par_run_map;
+	add_derivative_runs(numeric_par_names, model_parameters, par_transform, group_info, ctl_par_info, run_manager, phiredswh_flag, par_run_map);
+	output_file_writer_ptr->write_jco_run_id(run_manager.get_cur_groupid(), par_run_map);
+
+	ofstream &fout_restart = file_manager.get_ofstream("rst");
+	debug_print(failed_parameter_names);
+	debug_msg("Jacobian_1to1::build_runs end");
+
+	output_file_writer_ptr->write_jco_run_id(run_manager.get_cur_groupid(), par_run_map);
+	if (failed_parameter_names.size() > 0)
+		return false;
+	return true;
+}
+
+
+void Jacobian_1to1::add_derivative_runs(const vector<string> &numeric_par_names, const Parameters &base_model_parameters, ParamTransformSeq &par_transform,
+	const ParameterGroupInfo &group_info, const ParameterInfo &ctl_par_info, RunManagerAbstract &run_manager,
+	bool phiredswh_flag, std::map<string, vector<int>> &par_run_map)
+{
+	if (!batch_runs)
+	{
+		add_derivative_runs_per_par(numeric_par_names, base_model_parameters, par_transform, group_info, ctl_par_info, run_manager,
+			phiredswh_flag, par_run_map);
+		return;
+	}
+	debug_msg("Jacobian_1to1::add_derivative_runs begin");
+	Parameters base_derivative_parameters = par_transform.numeric2active_ctl_cp(base_numeric_parameters);
+	int n_par = numeric_par_names.size();
+	vector<double> base_derivative_vec(n_par);
+	for (int i = 0; i < n_par; ++i)
+	{
+		assert(base_derivative_parameters.find(numeric_par_names[i]) != base_derivative_parameters.end());
+		base_derivative_vec[i] = base_derivative_parameters.get_rec(numeric_par_names[i]);
+	}
+
+	//compute the perturbed values of each derivative parameter.  These only depend on the parameter and
+	//group info so large problems are split across threads
+	vector<vector<double> > del_par_vecs(n_par);
+	vector<char> success_vec(n_par, 0);
+	auto calc_perturb = [&](int i_start, int i_end)
+	{
+		for (int i = i_start; i < i_end; ++i)
+		{
+			bool success = get_derivative_parameters(numeric_par_names[i], base_derivative_vec[i], par_transform,
+				group_info, ctl_par_info, del_par_vecs[i], phiredswh_flag);
+			success_vec[i] = (success && !del_par_vecs[i].empty()) ? 1 : 0;
+		}
+	};
+	int n_threads = min((int)thread::hardware_concurrency(), n_par / min_pars_per_thread);
+	if (n_threads <= 1)
+	{
+		calc_perturb(0, n_par);
+	}
+	else
+	{
+		vector<thread> threads;
+		int n_per_thread = (n_par + n_threads - 1) / n_threads;
+		for (int i_start = 0; i_start < n_par; i_start += n_per_thread)
+			threads.push_back(thread(calc_perturb, i_start, min(n_par, i_start + n_per_thread)));
+		for (auto &t : threads)
+			t.join();
+	}
+	int max_n_perturb = 0;
+	for (int i = 0; i < n_par; ++i)
+	{
+		if (!success_vec[i])
+		{
+			cout << endl << " warning: failed to compute parameter deriviative for " << numeric_par_names[i] << endl;
+			file_manager.rec_ofstream() << " warning: failed to compute parameter deriviative for " << numeric_par_names[i] << endl;
+			failed_parameter_names.insert(numeric_par_names[i]);
+			failed_to_increment_parmaeters.insert(numeric_par_names[i], base_derivative_vec[i]);
+			del_par_vecs[i].clear();
+		}
+		max_n_perturb = max(max_n_perturb, (int)del_par_vecs[i].size());
+	}
+
+	//transform the perturbed values to model parameters.  For one-to-one transformations every parameter
+	//only effects itself (and any parameters tied to it) so all the k-th perturbations are transformed together
+	const vector<string> &model_par_names = run_manager.get_par_name_vec();
+	unordered_map<string, int> model_par_idx;
+	for (size_t i = 0; i < model_par_names.size(); ++i)
+		model_par_idx[model_par_names[i]] = i;
+	vector<vector<vector<pair<int, double> > > > model_changes(n_par);
+	if (par_transform.is_one_to_one())
+	{
+		unordered_map<string, vector<string> > tied_map;
+		TranTied *tied_ptr = par_transform.get_tied_ptr();
+		if (tied_ptr)
+		{
+			for (auto &t : tied_ptr->get_items())
+				tied_map[t.second.first].push_back(t.first);
+		}
+		for (size_t k = 0; k < (size_t)max_n_perturb; ++k)
+		{
+			Parameters perturb_pars;
+			for (int i = 0; i < n_par; ++i)
+			{
+				if (del_par_vecs[i].size() > k)
+					perturb_pars.insert(numeric_par_names[i], del_par_vecs[i][k]);
+			}
+			par_transform.active_ctl2model_ip(perturb_pars);
+			for (int i = 0; i < n_par; ++i)
+			{
+				if (del_par_vecs[i].size() <= k)
+					continue;
+				vector<pair<int, double> > changes;
+				const string &name = numeric_par_names[i];
+				changes.push_back(make_pair(model_par_idx.at(name), perturb_pars.get_rec(name)));
+				auto tied_iter = tied_map.find(name);
+				if (tied_iter != tied_map.end())
+				{
+					for (auto &tied_name : tied_iter->second)
+						changes.push_back(make_pair(model_par_idx.at(tied_name), perturb_pars.get_rec(tied_name)));
+				}
+				model_changes[i].push_back(changes);
+			}
+		}
+	}
+	else
+	{
+		for (int i = 0; i < n_par; ++i)
+		{
+			for (const auto &par : del_par_vecs[i])
+			{
+				Parameters new_pars;
+				new_pars.insert(make_pair(numeric_par_names[i], par));
+				par_transform.active_ctl2model_ip(new_pars);
+				vector<pair<int, double> > changes;
+				for (auto &ipar : new_pars)
+					changes.push_back(make_pair(model_par_idx.at(ipar.first), ipar.second));
+				model_changes[i].push_back(changes);
+			}
+		}
+	}
+
+	//assemble the runs in blocks over a contiguous base vector and add each block with a single write
+	vector<pair<int, int> > run_list;
+	for (int i = 0; i < n_par; ++i)
+	{
+		for (size_t k = 0; k < del_par_vecs[i].size(); ++k)
+			run_list.push_back(make_pair(i, k));
+	}
+	Eigen::VectorXd base_model_vec = base_model_parameters.get_data_eigen_vec(model_par_names);
+	int max_block_runs = max(1, (int)(max_run_block_bytes / (sizeof(double) * max(size_t(1), model_par_names.size()))));
+	for (int i_start = 0; i_start < (int)run_list.size(); i_start += max_block_runs)
+	{
+		int n_block = min(max_block_runs, (int)run_list.size() - i_start);
+		Eigen::MatrixXd block = base_model_vec.replicate(1, n_block);
+		vector<string> info_txt_vec;
+		vector<double> info_value_vec;
+		for (int j = 0; j < n_block; ++j)
+		{
+			int i_par = run_list[i_start + j].first;
+			int k = run_list[i_start + j].second;
+			for (auto &change : model_changes[i_par][k])
+				block(change.first, j) = change.second;
+			info_txt_vec.push_back(numeric_par_names[i_par]);
+			info_value_vec.push_back(del_par_vecs[i_par][k]);
+		}
+		vector<int> run_ids = run_manager.add_runs(block, info_txt_vec, info_value_vec);
+		for (int j = 0; j < n_block; ++j)
+			par_run_map[info_txt_vec[j]].push_back(run_ids[j]);
+	}
+	debug_msg("Jacobian_1to1::add_derivative_runs end");
+}
+
+void Jacobian_1to1::add_derivative_runs_per_par(const vector<string> &numeric_par_names, const Parameters &base_model_parameters, ParamTransformSeq &par_transform,
+	const ParameterGroupInfo &group_info, const ParameterInfo &ctl_par_info, RunManagerAbstract &run_manager,
+	bool phiredswh_flag, std::map<string, vector<int>> &par_run_map)
+{
+	debug_msg("Jacobian_1to1::add_derivative_runs_per_par begin");
+	Parameters model_parameters = base_model_parameters;
+	Parameters base_derivative_parameters = par_transform.numeric2active_ctl_cp(base_numeric_parameters);
+	bool success;
 	for (auto &i_name : numeric_par_names)
 	{
 		assert(base_derivative_parameters.find(i_name) != base_derivative_parameters.end());
@@ -173,15 +306,11 @@ bool Jacobian_1to1::build_runs(ModelRun &init_model_run, vector<string> numeric_
 					model_parameters[ipar.first] = ipar.second;
 				}
 				int id = run_manager.add_run(model_parameters, i_name, par);
-
-				if (par_run_map.count(i_name) == 0)
-					par_run_map[i_name] = vector<int>{ id };
-				else
-					par_run_map[i_name].push_back(id);
+				par_run_map[i_name].push_back(id);
 				//reset the perturbed parameters back to the values associated with the base condition
 				for (const auto &ipar : new_pars)
 				{
-					model_parameters[ipar.first] = base_model_parameters[ipar.first];
+					model_parameters[ipar.first] = base_model_parameters.get_rec(ipar.first);
 				}
 			}
 		}
@@ -193,19 +322,9 @@ bool Jacobian_1to1::build_runs(ModelRun &init_model_run, vector<string> numeric_
 			failed_to_increment_parmaeters.insert(i_name, derivative_par_value);
 		}
 	}
-	output_file_writer_ptr->write_jco_run_id(run_manager.get_cur_groupid(), par_run_map);
-
-	ofstream &fout_restart = file_manager.get_ofstream("rst");
-	debug_print(failed_parameter_names);
-	debug_msg("Jacobian_1to1::build_runs end");
-
-	output_file_writer_ptr->write_jco_run_id(run_manager.get_cur_groupid(), par_run_map);
-	if (failed_parameter_names.size() > 0)
-		return false;
-	return true;
+	debug_msg("Jacobian_1to1::add_derivative_runs_per_par end");
 }
 
-
 void Jacobian_1to1::make_runs(RunManagerAbstract &run_manager)
 {
 	// make model runs
@@ -310,6 +429,7 @@ bool Jacobian_1to1::process_runs(ParamTransformSeq &par_transform,
 	matrix.resize(base_sim_obs_names.size(), base_numeric_par_names.size());
 	matrix.setZero();
 	matrix.setFromTriplets(triplet_list.begin(), triplet_list.end());
+	stamp_cols();
 	// clean up
 	ofstream &fout_restart = file_manager.get_ofstream("rst");
 	run_manager.free_memory();
@@ -35,11 +35,14 @@ public:
 		const PriorInformation &prior_info, bool splitswh_flag,
 		bool debug_fail);
 	virtual void report_errors(std::ostream &fout);
+	//false builds the derivative runs one at a time, as a reference for the batched builder
+	void set_batch_runs(bool _flag) { batch_runs = _flag; }
 	virtual ~Jacobian_1to1();
 protected:
 	Parameters failed_ctl_parameters;
 	Parameters failed_to_increment_parmaeters;
 	OutputFileWriter* output_file_writer_ptr;
+	bool batch_runs;
 	bool forward_diff(const string &par_name, double derivative_par_value,
 		const ParameterGroupInfo &group_info, const ParameterInfo &ctl_par_info, const ParamTransformSeq &par_trans, double &new_par_val);
 	bool central_diff(const string &par_name, double derivative_par_value,
@@ -48,6 +51,14 @@ protected:
 	bool out_of_bounds(const Parameters &model_parameters, const ParameterRec *par_info_ptr) const;
 	bool get_derivative_parameters(const string &par_name, double derivative_par_value, const ParamTransformSeq &par_trans, const ParameterGroupInfo &group_info, const ParameterInfo &ctl_par_info,
 		vector<double> &delta_numeric_par_vec, bool phiredswh_flag);
+	void add_derivative_runs(const vector<string> &numeric_par_names, const Parameters &base_model_parameters, ParamTransformSeq &par_transform,
+		const ParameterGroupInfo &group_info, const ParameterInfo &ctl_par_info, RunManagerAbstract &run_manager,
+		bool phiredswh_flag, std::map<string, vector<int>> &par_run_map);
+	void add_derivative_runs_per_par(const vector<string> &numeric_par_names, const Parameters &base_model_parameters, ParamTransformSeq &par_transform,
+		const ParameterGroupInfo &group_info, const ParameterInfo &ctl_par_info, RunManagerAbstract &run_manager,
+		bool phiredswh_flag, std::map<string, vector<int>> &par_run_map);
+	static const int min_pars_per_thread = 5000;
+	static const size_t max_run_block_bytes = 64 * 1024 * 1024;
 };
 
 #endif /* JACOBIAN_1TO1H_ */
@@ -26,6 +26,7 @@
 #include "PriorInformation.h"
 #include "pest_data_structs.h"
 #include "Regularization.h"
+#include "Jacobian.h"
 
 using namespace std;
 using namespace Eigen;
@@ -37,8 +38,22 @@ QSqrtMatrix::QSqrtMatrix(const ObservationInfo *_obs_info_ptr, const PriorInform
 
 Eigen::SparseMatrix<double> QSqrtMatrix::get_sparse_matrix(const vector<string> &obs_names, const DynamicRegularization &regul, bool get_sqaure) const
 {
-
+	Eigen::VectorXd weight_vec = get_weight_vec(obs_names, regul, get_sqaure);
 	Eigen::SparseMatrix<double> weights(obs_names.size(), obs_names.size());
+	std::vector<Eigen::Triplet<double> > triplet_list;
+	for (int i = 0; i < weight_vec.size(); ++i)
+	{
+		if (weight_vec(i) != 0.0)
+			triplet_list.push_back(Eigen::Triplet<double>(i, i, weight_vec(i)));
+	}
+	weights.setZero();
+	weights.setFromTriplets(triplet_list.begin(), triplet_list.end());
+	return weights;
+}
+
+Eigen::VectorXd QSqrtMatrix::get_weight_vec(const vector<string> &obs_names, const DynamicRegularization &regul, bool get_sqaure) const
+{
+	Eigen::VectorXd weight_vec = Eigen::VectorXd::Zero(obs_names.size());
 	unordered_map<string, ObservationRec>::const_iterator found_obsinfo_iter;
 	unordered_map<string, ObservationRec>::const_iterator non_found_obsinfo_iter = obs_info_ptr->observations.end();
 	PriorInformation::const_iterator found_prior_info;
@@ -53,7 +68,6 @@ Eigen::SparseMatrix<double> QSqrtMatrix::get_sparse_matrix(const vector<string>
 	// of this
 	bool use_regul = regul.get_use_dynamic_reg();
 	if (use_regul) tikhonov_weight = sqrt(regul.get_weight());
-	std::vector<Eigen::Triplet<double> > triplet_list;
 	for (i = 0, b = obs_names.begin(), e = obs_names.end(); b != e; ++b, ++i)
 	{
 		found_obsinfo_iter = obs_info_ptr->observations.find(*b);
@@ -74,7 +88,7 @@ Eigen::SparseMatrix<double> QSqrtMatrix::get_sparse_matrix(const vector<string>
 				weight *= tikhonov_weight;
 			}
 			if (get_sqaure) weight = weight * weight;
-			triplet_list.push_back(Eigen::Triplet<double>(i, i, weight));
+			weight_vec(i) = weight;
 		}
 		// This section handles Prior Information
 		else if (found_prior_info != not_found_prior_info)
@@ -92,18 +106,139 @@ Eigen::SparseMatrix<double> QSqrtMatrix::get_sparse_matrix(const vector<string>
 				weight *= sqrt(regul.get_weight());
 			}
 			if (get_sqaure) weight = weight * weight;
-			triplet_list.push_back(Eigen::Triplet<double>(i, i, weight));
+			weight_vec(i) = weight;
 		}
 		else {
 			assert(true);  //observation not in standard observations or prior information
 		}
 	}
-	weights.resize(obs_names.size(), obs_names.size());
-	weights.setZero();
-	weights.setFromTriplets(triplet_list.begin(), triplet_list.end());
-	return weights;
+	return weight_vec;
 }
 
 QSqrtMatrix::~QSqrtMatrix(void)
 {
 }
+
+
+bool WeightedJacobianCache::RegulKey::operator==(const RegulKey &rhs) const
+{
+	return (use_regul == rhs.use_regul) && (weight == rhs.weight) && (grp_weights == rhs.grp_weights);
+}
+
+WeightedJacobianCache::RegulKey WeightedJacobianCache::get_regul_key(const DynamicRegularization &regul)
+{
+	RegulKey key;
+	key.use_regul = regul.get_use_dynamic_reg();
+	key.weight = key.use_regul ? regul.get_weight() : 1.0;
+	if (key.use_regul && regul.get_adj_grp_weights())
+		key.grp_weights = regul.get_regul_grp_weights();
+	return key;
+}
+
+void WeightedJacobianCache::invalidate()
+{
+	jacobian_ptr = nullptr;
+	obs_names.clear();
+	have_weights = false;
+	weight_vec.resize(0);
+	q_mat.resize(0, 0);
+	jac_map.clear();
+}
+
+void WeightedJacobianCache::check_key(const Jacobian *_jacobian_ptr, const vector<string> &_obs_names)
+{
+	if ((_jacobian_ptr != jacobian_ptr) || (_obs_names != obs_names))
+	{
+		invalidate();
+		jacobian_ptr = _jacobian_ptr;
+		obs_names = _obs_names;
+	}
+}
+
+const Eigen::VectorXd& WeightedJacobianCache::get_weight_vec(const QSqrtMatrix &Q_sqrt, const vector<string> &_obs_names,
+	const DynamicRegularization &regul)
+{
+	if (_obs_names != obs_names)
+		check_key(jacobian_ptr, _obs_names);
+	RegulKey key = get_regul_key(regul);
+	if ((!have_weights) || (!(key == weight_regul_key)))
+	{
+		weight_vec = Q_sqrt.get_weight_vec(obs_names, regul);
+		Eigen::VectorXd q_vec = weight_vec.cwiseProduct(weight_vec);
+		std::vector<Eigen::Triplet<double> > triplet_list;
+		for (int i = 0; i < q_vec.size(); ++i)
+		{
+			if (q_vec(i) != 0.0)
+				triplet_list.push_back(Eigen::Triplet<double>(i, i, q_vec(i)));
+		}
+		q_mat.resize(q_vec.size(), q_vec.size());
+		q_mat.setZero();
+		q_mat.setFromTriplets(triplet_list.begin(), triplet_list.end());
+		weight_regul_key = key;
+		have_weights = true;
+	}
+	return weight_vec;
+}
+
+const Eigen::SparseMatrix<double>& WeightedJacobianCache::get_q_mat(const QSqrtMatrix &Q_sqrt, const vector<string> &_obs_names,
+	const DynamicRegularization &regul)
+{
+	get_weight_vec(Q_sqrt, _obs_names, regul);
+	return q_mat;
+}
+
+WeightedJacobianCache::JacEntry& WeightedJacobianCache::get_entry(const Jacobian &jacobian, const vector<string> &_obs_names,
+	const vector<string> &par_names)
+{
+	check_key(&jacobian, _obs_names);
+	++n_uses;
+	auto found = jac_map.find(par_names);
+	if (found == jac_map.end())
+	{
+		if (jac_map.size() >= MAX_JAC_SETS)
+		{
+			auto oldest = jac_map.begin();
+			for (auto it = jac_map.begin(); it != jac_map.end(); ++it)
+			{
+				if (it->second.last_use < oldest->second.last_use)
+					oldest = it;
+			}
+			jac_map.erase(oldest);
+		}
+		JacEntry &entry = jac_map[par_names];
+		entry.jac = jacobian.get_matrix(obs_names, par_names);
+		entry.have_weighted = false;
+		entry.last_use = n_uses;
+		return entry;
+	}
+	found->second.last_use = n_uses;
+	return found->second;
+}
+
+const Eigen::SparseMatrix<double>& WeightedJacobianCache::get_jac(const Jacobian &jacobian, const vector<string> &_obs_names,
+	const vector<string> &par_names)
+{
+	return get_entry(jacobian, _obs_names, par_names).jac;
+}
+
+const Eigen::SparseMatrix<double>& WeightedJacobianCache::get_weighted_jac(const Jacobian &jacobian, const QSqrtMatrix &Q_sqrt,
+	const vector<string> &_obs_names, const vector<string> &par_names, const DynamicRegularization &regul)
+{
+	JacEntry &entry = get_entry(jacobian, _obs_names, par_names);
+	const Eigen::VectorXd &w_vec = get_weight_vec(Q_sqrt, _obs_names, regul);
+	if ((!entry.have_weighted) || (!(entry.regul_key == weight_regul_key)))
+	{
+		entry.weighted_jac = w_vec.asDiagonal() * entry.jac;
+		entry.JtQJ = entry.weighted_jac.transpose() * entry.weighted_jac;
+		entry.regul_key = weight_regul_key;
+		entry.have_weighted = true;
+	}
+	return entry.weighted_jac;
+}
+
+const Eigen::SparseMatrix<double>& WeightedJacobianCache::get_JtQJ(const Jacobian &jacobian, const QSqrtMatrix &Q_sqrt,
+	const vector<string> &_obs_names, const vector<string> &par_names, const DynamicRegularization &regul)
+{
+	get_weighted_jac(jacobian, Q_sqrt, _obs_names, par_names, regul);
+	return get_entry(jacobian, _obs_names, par_names).JtQJ;
+}
@@ -19,7 +19,11 @@
 #ifndef QSQRT_MATRIX_H_
 #define QSQRT_MATRIX_H_
 
+#include <cstdint>
 #include <vector>
+#include <map>
+#include <unordered_map>
+#include <string>
 #include <Eigen/Dense>
 #include<Eigen/Sparse>
 
@@ -28,6 +32,7 @@ class Observations;
 class PriorInformation;
 class Parameters;
 class DynamicRegularization;
+class Jacobian;
 
 using namespace std;
 
@@ -37,10 +42,61 @@ public:
 	QSqrtMatrix(){};
 	QSqrtMatrix(const ObservationInfo *obs_info_ptr, const PriorInformation *prior_info_ptr);
 	Eigen::SparseMatrix<double> get_sparse_matrix(const vector<string> &obs_names, const DynamicRegularization &regul, bool get_square = false) const;
+	Eigen::VectorXd get_weight_vec(const vector<string> &obs_names, const DynamicRegularization &regul, bool get_square = false) const;
 	~QSqrtMatrix(void);
 private:
 	const ObservationInfo *obs_info_ptr;
 	const PriorInformation *prior_info_ptr;
 };
 
+// Caches the weights and the jacobian sub-matrices (and their weighted products) used repeatedly
+// while computing the upgrades for a single iteration.  Weighted products are recomputed when the
+// regularization weights change; everything is discarded by invalidate(), which must be called
+// whenever the jacobian changes.  At most MAX_JAC_SETS parameter sets are held - the least recently
+// used one is dropped to make room, so a reference returned for one set is only good until a
+// different set is requested.
+class WeightedJacobianCache
+{
+public:
+	WeightedJacobianCache() : jacobian_ptr(nullptr), have_weights(false), n_uses(0) {}
+	static const size_t MAX_JAC_SETS = 4;
+	void invalidate();
+	const Eigen::VectorXd& get_weight_vec(const QSqrtMatrix &Q_sqrt, const vector<string> &obs_names, const DynamicRegularization &regul);
+	const Eigen::SparseMatrix<double>& get_q_mat(const QSqrtMatrix &Q_sqrt, const vector<string> &obs_names, const DynamicRegularization &regul);
+	const Eigen::SparseMatrix<double>& get_jac(const Jacobian &jacobian, const vector<string> &obs_names, const vector<string> &par_names);
+	const Eigen::SparseMatrix<double>& get_weighted_jac(const Jacobian &jacobian, const QSqrtMatrix &Q_sqrt, const vector<string> &obs_names,
+		const vector<string> &par_names, const DynamicRegularization &regul);
+	const Eigen::SparseMatrix<double>& get_JtQJ(const Jacobian &jacobian, const QSqrtMatrix &Q_sqrt, const vector<string> &obs_names,
+		const vector<string> &par_names, const DynamicRegularization &regul);
+private:
+	struct RegulKey
+	{
+		bool use_regul;
+		double weight;
+		std::unordered_map<std::string, double> grp_weights;
+		bool operator==(const RegulKey &rhs) const;
+	};
+	struct JacEntry
+	{
+		Eigen::SparseMatrix<double> jac;
+		bool have_weighted;
+		RegulKey regul_key;
+		Eigen::SparseMatrix<double> weighted_jac;
+		Eigen::SparseMatrix<double> JtQJ;
+		int64_t last_use;
+	};
+	const Jacobian *jacobian_ptr;
+	vector<string> obs_names;
+	bool have_weights;
+	RegulKey weight_regul_key;
+	Eigen::VectorXd weight_vec;
+	Eigen::SparseMatrix<double> q_mat;
+	std::map<vector<string>, JacEntry> jac_map;
+	int64_t n_uses;
+
+	static RegulKey get_regul_key(const DynamicRegularization &regul);
+	void check_key(const Jacobian *_jacobian_ptr, const vector<string> &_obs_names);
+	JacEntry& get_entry(const Jacobian &jacobian, const vector<string> &_obs_names, const vector<string> &par_names);
+};
+
 #endif /* QSQRT_MATRIX_H_ */
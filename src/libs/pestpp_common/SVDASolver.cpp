@@ -243,6 +243,7 @@ ModelRun SVDASolver::iteration_reuse_jac(RunManagerAbstract &run_manager, Termin
 
 void SVDASolver::iteration_jac(RunManagerAbstract &run_manager, TerminationController &termination_ctl, ModelRun &base_run, bool calc_init_obs, bool restart_runs)
 {
+	jac_cache.invalidate();
 	ostream &fout_restart = file_manager.get_ofstream("rst");
 	ostream &os = file_manager.rec_ofstream();
 	vector<string> numeric_par_names_vec;
@@ -379,6 +380,8 @@ void SVDASolver::iteration_jac(RunManagerAbstract &run_manager, TerminationContr
 
 ModelRun SVDASolver::iteration_upgrd(RunManagerAbstract &run_manager, TerminationController &termination_ctl, ModelRun &base_run, bool restart_runs)
 {
+	//the jacobian has changed since the last upgrade calculations
+	jac_cache.invalidate();
 	ostream &os = file_manager.rec_ofstream();
 	ostream &fout_restart = file_manager.get_ofstream("rst");
 
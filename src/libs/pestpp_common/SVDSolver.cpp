@@ -100,10 +100,12 @@ SVDSolver::SVDSolver(Pest &_pest_scenario, FileManager &_file_manager, Objective
 	splitswh_flag(_splitswh_flag), save_next_jacobian(_save_next_jacobian), prior_info_ptr(_pest_scenario.get_prior_info_ptr()), jacobian(_jacobian),
 	regul_scheme_ptr(_pest_scenario.get_regul_scheme_ptr()), output_file_writer(_output_file_writer), description(_description), best_lambda(20.0),
 	performance_log(_performance_log), base_lambda_vec(_pest_scenario.get_pestpp_options().get_base_lambda_vec()), lambda_scale_vec(_pest_scenario.get_pestpp_options().get_lambda_scale_vec()),
-	terminate_local_iteration(false), parcov(_parcov)
+	terminate_local_iteration(false), parcov(_parcov), n_broyden_iter(0), force_full_jacobian(false)
 {
 	svd_package = new SVD_REDSVD();
 	glm_normal_form = pest_scenario.get_pestpp_options().get_glm_normal_form();
+	broyden_cadence = pest_scenario.get_pestpp_options().get_glm_broyden_cadence();
+	broyden_phi_stall = pest_scenario.get_pestpp_options().get_glm_broyden_phi_stall();
 
 }
 
@@ -144,6 +146,10 @@ ModelRun SVDSolver::solve(RunManagerAbstract &run_manager, TerminationController
 	terminate_local_iteration = false;
 
 	bool calc_jacobian = calc_first_jacobian;
+	//secant information from a previous call can't be used since the parameters may have been changed elsewhere
+	clear_secant_info();
+	n_broyden_iter = 0;
+	force_full_jacobian = false;
 
 	if (restart_controller.get_restart_option() == RestartController::RestartOption::RESUME_NEW_ITERATION)
 	{
@@ -193,11 +199,18 @@ ModelRun SVDSolver::solve(RunManagerAbstract &run_manager, TerminationController
 			{
 				calc_jacobian = true;
 			}
+			else if ((restart_controller.get_restart_option() == RestartController::RestartOption::NONE) && use_broyden_update())
+			{
+				iteration_broyden(termination_ctl, best_upgrade_run);
+				++n_broyden_iter;
+			}
 			else
 			{
 				bool restart_runs = (restart_controller.get_restart_option() == RestartController::RestartOption::RESUME_JACOBIAN_RUNS);
 				iteration_jac(run_manager, termination_ctl, best_upgrade_run, false, restart_runs);
 				if (restart_runs) restart_controller.get_restart_option() = RestartController::RestartOption::NONE;
+				n_broyden_iter = 0;
+				force_full_jacobian = false;
 			}
 
 			// Update Regularization weights if REG_FRAC is used
@@ -249,6 +262,14 @@ ModelRun SVDSolver::solve(RunManagerAbstract &run_manager, TerminationController
 		cout << "    starting phi = " << prev_phi << ";  ending phi = " << best_new_phi <<
 			"  (" << phi_ratio * 100 << "% of starting phi)" << endl;
 
+		if ((n_broyden_iter > 0) && (prev_phi != 0) && ((prev_phi - best_new_phi) / prev_phi < broyden_phi_stall))
+		{
+			force_full_jacobian = true;
+			os << endl << "    phi reduction with Broyden-updated jacobian below glm_broyden_phi_stall, " <<
+				"recomputing full jacobian next iteration" << endl;
+			cout << endl << "    phi reduction with Broyden-updated jacobian stalled, recomputing full jacobian next iteration" << endl;
+		}
+
 		if (prev_phi != 0 && par_group_info_ptr->have_switch_derivative() && !phiredswh_flag &&
 			termination_ctl.get_iteration_number() + 1 > ctl_info->noptswitch &&
 			(prev_phi - best_new_phi) / prev_phi < ctl_info->phiredswh)
@@ -356,7 +377,7 @@ VectorXd SVDSolver::calc_residual_corrections(const Jacobian &jacobian, const Pa
 
 		VectorXd frz_del_par_vec = del_numeric_pars.get_data_eigen_vec(frz_par_name_vec);
 
-		MatrixXd jac_frz = jacobian.get_matrix(obs_name_vec, frz_par_name_vec);
+		MatrixXd jac_frz = jac_cache.get_jac(jacobian, obs_name_vec, frz_par_name_vec);
 		del_residuals = (jac_frz)*  frz_del_par_vec;
 	}
 	else
@@ -393,14 +414,13 @@ void SVDSolver::calc_lambda_upgrade_vec_JtQJ(const Jacobian &jacobian, const QSq
 	VectorXd Sigma_trunc;
 	Eigen::SparseMatrix<double> U;
 	Eigen::SparseMatrix<double> Vt;
-	// the last boolean arguement is an instruction to compute the square weights
-	Eigen::SparseMatrix<double> q_mat = Q_sqrt.get_sparse_matrix(obs_name_vec, regul, true);
-	// removed this line when true added to end of the previous call to get_sparce_matrix
-	//q_mat = (q_mat * q_mat).eval();
-	Eigen::SparseMatrix<double> jac = jacobian.get_matrix(obs_name_vec, numeric_par_names);
+	// the jacobian sub-matrix, the squared weights and JtQJ are shared by all upgrade calculations
+	// in this iteration that use the same parameters and regularization weights
+	const Eigen::SparseMatrix<double> &jac = jac_cache.get_jac(jacobian, obs_name_vec, numeric_par_names);
+	const Eigen::SparseMatrix<double> &q_mat = jac_cache.get_q_mat(Q_sqrt, obs_name_vec, regul);
 	
 	performance_log->log_event("forming JtQJ matrix");
-	Eigen::SparseMatrix<double> JtQJ = jac.transpose() * q_mat * jac;
+	Eigen::SparseMatrix<double> JtQJ = jac_cache.get_JtQJ(jacobian, Q_sqrt, obs_name_vec, numeric_par_names, regul);
 	
 	Eigen::VectorXd upgrade_vec;
 	stringstream info_str;
@@ -457,7 +477,6 @@ void SVDSolver::calc_lambda_upgrade_vec_JtQJ(const Jacobian &jacobian, const QSq
 	else if ((glm_normal_form == PestppOptions::GLMNormalForm::IDENT) ||
 		(glm_normal_form == PestppOptions::GLMNormalForm::PRIOR))
 	{
-		JtQJ = jac.transpose() * q_mat * jac;
 		Eigen::VectorXd innovation = jac.transpose() * (q_mat * corrected_residuals);
 		
 		if (glm_normal_form == PestppOptions::GLMNormalForm::IDENT)
@@ -516,9 +535,7 @@ void SVDSolver::calc_lambda_upgrade_vec_JtQJ(const Jacobian &jacobian, const QSq
 	{
 		double beta = 1.0;
 		Eigen::VectorXd gama = jac * upgrade_vec;
-		Eigen::SparseMatrix<double> Q_mat_tmp = Q_sqrt.get_sparse_matrix(obs_name_vec, regul);
-		Eigen::SparseMatrix<double> Q_diag = get_diag_matrix(Q_mat_tmp);
-		Q_diag = (Q_diag * Q_diag).eval();
+		const Eigen::SparseMatrix<double> &Q_diag = q_mat;
 		double top = corrected_residuals.transpose() * Q_diag * gama;
 		double bot = gama.transpose() * Q_diag * gama;
 		if (bot != 0)
@@ -780,26 +797,64 @@ ModelRun SVDSolver::iteration_reuse_jac(RunManagerAbstract &run_manager, Termina
 
 void SVDSolver::iteration_jac(RunManagerAbstract &run_manager, TerminationController &termination_ctl, ModelRun &base_run, bool calc_init_obs, bool restart_runs)
 {
+	jac_cache.invalidate();
 	ostream &os = file_manager.rec_ofstream();
 	ostream &fout_restart = file_manager.get_ofstream("rst");
 	set<string> out_ofbound_pars;
 	vector<string> numeric_parname_vec = par_transform.ctl2numeric_cp(base_run.get_ctl_pars()).get_keys();
+	Jacobian prev_jacobian(file_manager);
+	bool partial_refresh = false;
+	//the columns that a partial refresh reuses are saved next to the run storage so that resuming the
+	//jacobian runs can merge them back in.  The file only exists while the current run set is partial
+	string prev_jco_filename = file_manager.build_filename("prev.jcb");
 
 	if (!restart_runs)
 	{
+		remove(prev_jco_filename.c_str());
+		remove(file_manager.build_filename("prev.jcb.cols").c_str());
 
 		// Calculate Jacobian
 		if (!base_run.obs_valid() || calc_init_obs == true) {
 			calc_init_obs = true;
 		}
+		vector<string> refresh_parname_vec = numeric_parname_vec;
+		double refresh_frac = pest_scenario.get_pestpp_options().get_jac_refresh_frac();
+		if ((refresh_frac < 1.0) && (jacobian.get_base_numeric_par_names().size() > 0))
+		{
+			//only re-perturb the parameters whose columns are most likely stale
+			refresh_parname_vec = jacobian.select_refresh_pars(numeric_parname_vec,
+				par_transform.ctl2numeric_cp(base_run.get_ctl_pars()), refresh_frac,
+				pest_scenario.get_pestpp_options().get_jac_refresh_max_age());
+			if (refresh_parname_vec.size() < numeric_parname_vec.size())
+			{
+				prev_jacobian = jacobian;
+				//the jco is written last since its presence marks the run set as partial
+				prev_jacobian.save_col_info("prev.jcb.cols");
+				prev_jacobian.save("prev.jcb");
+				partial_refresh = true;
+				os << "  partial jacobian refresh: recomputing " << refresh_parname_vec.size() << " of "
+					<< numeric_parname_vec.size() << " columns" << endl;
+				performance_log->log_event("partial jacobian refresh: " + to_string(refresh_parname_vec.size()) +
+					" of " + to_string(numeric_parname_vec.size()) + " columns");
+			}
+		}
 		cout << "  calculating jacobian... ";
 		performance_log->log_event("commencing to build jacobian parameter sets");
-		jacobian.build_runs(base_run, numeric_parname_vec, par_transform,
+		jacobian.build_runs(base_run, refresh_parname_vec, par_transform,
 			*par_group_info_ptr, *ctl_par_info_ptr, run_manager, out_ofbound_pars,
 			phiredswh_flag, calc_init_obs);
 
 		RestartController::write_jac_runs_built(fout_restart);
 	}
+	else if (pest_utils::check_exist_in(prev_jco_filename))
+	{
+		//the resumed run set only holds the refreshed columns
+		prev_jacobian.read(prev_jco_filename);
+		prev_jacobian.read_col_info(file_manager.build_filename("prev.jcb.cols"));
+		partial_refresh = true;
+		os << "  resuming partial jacobian refresh: stale columns restored from " << prev_jco_filename << endl;
+		performance_log->log_event("resuming partial jacobian refresh, stale columns read from " + prev_jco_filename);
+	}
 
 	performance_log->log_event("jacobian parameter sets built, commencing model runs");
 	jacobian.make_runs(run_manager);
@@ -807,6 +862,8 @@ void SVDSolver::iteration_jac(RunManagerAbstract &run_manager, TerminationContro
 	jacobian.process_runs(par_transform,
 		*par_group_info_ptr, run_manager, *prior_info_ptr, splitswh_flag,
 		pest_scenario.get_pestpp_options().get_glm_debug_der_fail());
+	if (partial_refresh)
+		jacobian.merge_stale_cols(prev_jacobian, numeric_parname_vec);
 	performance_log->log_event("processing jacobian runs complete");
 
 	performance_log->log_event("saving jacobian and sen files");
@@ -826,8 +883,46 @@ void SVDSolver::iteration_jac(RunManagerAbstract &run_manager, TerminationContro
 		*(base_run.get_obj_func_ptr()), get_parameter_group_info(), *regul_scheme_ptr, false, par_transform);
 }
 
+bool SVDSolver::use_broyden_update() const
+{
+	if (broyden_cadence <= 1)
+		return false;
+	if (force_full_jacobian)
+		return false;
+	if (n_broyden_iter >= broyden_cadence - 1)
+		return false;
+	return secant_del_numeric_pars.cols() > 0;
+}
+
+void SVDSolver::clear_secant_info()
+{
+	secant_obs_names.clear();
+	secant_del_numeric_pars.resize(0, 0);
+	secant_del_obs.resize(0, 0);
+}
+
+void SVDSolver::iteration_broyden(TerminationController &termination_ctl, ModelRun &base_run)
+{
+	ostream &os = file_manager.rec_ofstream();
+	cout << "  updating jacobian with Broyden secant update (no model runs)... " << endl;
+	performance_log->log_event("commencing Broyden update of jacobian");
+	Parameters base_numeric_pars = par_transform.ctl2numeric_cp(base_run.get_ctl_pars());
+	int n_dir = jacobian.secant_update(secant_obs_names, secant_del_numeric_pars, secant_del_obs, base_numeric_pars);
+	jacobian.set_base_sim_obs(base_run.get_obs());
+	clear_secant_info();
+	os << "  jacobian updated with rank-" << n_dir << " Broyden secant update from previous lambda runs (" <<
+		n_broyden_iter + 1 << " of " << broyden_cadence - 1 << " iterations between full jacobians)" << endl;
+	performance_log->log_event("Broyden update of jacobian complete");
+
+	output_file_writer.write_jco(true, "jcb", jacobian);
+	output_file_writer.append_sen(file_manager.sen_ofstream(), termination_ctl.get_iteration_number() + 1, jacobian,
+		*(base_run.get_obj_func_ptr()), get_parameter_group_info(), *regul_scheme_ptr, false, par_transform);
+}
+
 ModelRun SVDSolver::iteration_upgrd(RunManagerAbstract &run_manager, TerminationController &termination_ctl, ModelRun &base_run, bool restart_runs)
 {
+	//the jacobian has changed since the last upgrade calculations
+	jac_cache.invalidate();
 	ostream &os = file_manager.rec_ofstream();
 	ostream &fout_restart = file_manager.get_ofstream("rst");
 	int num_success_calc = 0;
@@ -1039,6 +1134,17 @@ ModelRun SVDSolver::iteration_upgrd(RunManagerAbstract &run_manager, Termination
 
 	//int n_runs = run_manager.get_nruns();
 	bool one_success = false;
+	//collect secant information from the lambda runs for Broyden updates of the jacobian
+	clear_secant_info();
+	vector<Eigen::VectorXd> secant_par_vecs, secant_obs_vecs;
+	vector<string> jac_par_names = jacobian.get_base_numeric_par_names();
+	Eigen::VectorXd base_numeric_vec, base_obs_vec;
+	if (broyden_cadence > 1)
+	{
+		secant_obs_names = run_manager.get_obs_name_vec();
+		base_numeric_vec = par_transform.ctl2numeric_cp(base_run.get_ctl_pars()).get_data_eigen_vec(jac_par_names);
+		base_obs_vec = base_run.get_obs().get_data_eigen_vec(secant_obs_names);
+	}
 	for (int i = 1; i < num_lamb_runs; ++i) {
 		ModelRun upgrade_run(base_run);
 		Parameters tmp_pars;
@@ -1060,6 +1166,11 @@ ModelRun SVDSolver::iteration_upgrd(RunManagerAbstract &run_manager, Termination
 
 			Parameters frozen_pars = read_frozen_pars(fin_frz, i);
 			upgrade_run.set_frozen_ctl_parameters(frozen_pars);
+			if ((broyden_cadence > 1) && (upgrade_run.obs_valid()))
+			{
+				secant_par_vecs.push_back(par_transform.ctl2numeric_cp(tmp_pars).get_data_eigen_vec(jac_par_names) - base_numeric_vec);
+				secant_obs_vecs.push_back(tmp_obs.get_data_eigen_vec(secant_obs_names) - base_obs_vec);
+			}
 
 			par_transform.ctl2active_ctl_ip(tmp_pars);
 			double magnitude = Transformable::l2_norm(base_run_active_ctl_par_tmp, tmp_pars);
@@ -1096,6 +1207,16 @@ ModelRun SVDSolver::iteration_upgrd(RunManagerAbstract &run_manager, Termination
 		}
 	}
 	file_manager.close_file("fpr");
+	if (secant_par_vecs.size() > 0)
+	{
+		secant_del_numeric_pars.resize(jac_par_names.size(), secant_par_vecs.size());
+		secant_del_obs.resize(secant_obs_names.size(), secant_obs_vecs.size());
+		for (size_t i = 0; i < secant_par_vecs.size(); ++i)
+		{
+			secant_del_numeric_pars.col(i) = secant_par_vecs[i];
+			secant_del_obs.col(i) = secant_obs_vecs[i];
+		}
+	}
 
 	if (fosm_real_info.second.size() > 0)
 	{
@@ -1592,7 +1713,7 @@ PhiComponets SVDSolver::phi_estimate(const ModelRun &base_run, const Jacobian &j
 		- par_transform.active_ctl2numeric_cp(base_run_active_ctl_par);
 	vector<string> numeric_par_names = delta_par.get_keys();
 	VectorXd delta_par_vec = transformable_2_eigen_vec(delta_par, numeric_par_names);
-	Eigen::SparseMatrix<double> jac = jacobian.get_matrix(obs_names_vec, numeric_par_names);
+	const Eigen::SparseMatrix<double> &jac = jac_cache.get_jac(jacobian, obs_names_vec, numeric_par_names);
 	VectorXd delta_obs_vec = jac * delta_par_vec;
 	//Transformable delta_obs(obs_names_vec, delta_obs_vec);
 	Observations projected_obs = base_run.get_obs();
@@ -34,11 +34,11 @@
 #include "RestartController.h"
 #include "PerformanceLog.h"
 #include "covariance.h"
+#include "QSqrtMatrix.h"
 
 
 class FileManager;
 class ModelRun;
-class QSqrtMatrix;
 class PriorInformation;
 class DynamicRegularization;
 class SVDPackage;
@@ -78,6 +78,7 @@ public:
 		ModelRun &optimum_run, RestartController &restart_controller, bool calc_first_jacobian = true);
 	virtual ModelRun iteration_reuse_jac(RunManagerAbstract &run_manager, TerminationController &termination_ctl, ModelRun &base_run, bool rerun_base = true, const std::string &jco_filename = "",const std::string &res_filename="");
 	virtual void iteration_jac(RunManagerAbstract &run_manager, TerminationController &termination_ctl, ModelRun &base_run, bool calc_init_obs = false, bool restart_runs = false);
+	virtual void iteration_broyden(TerminationController &termination_ctl, ModelRun &base_run);
 	virtual ModelRun iteration_upgrd(RunManagerAbstract &run_manager, TerminationController &termination_ctl, ModelRun &base_run, bool restart_runs = false);
 	virtual void set_svd_package(PestppOptions::SVD_PACK _svd_pack);
 	bool get_phiredswh_flag() const { return phiredswh_flag;}
@@ -133,6 +134,14 @@ protected:
 	std::vector<double> lambda_scale_vec;
 	bool terminate_local_iteration;
 	bool der_forgive;
+	int broyden_cadence;
+	double broyden_phi_stall;
+	int n_broyden_iter;
+	bool force_full_jacobian;
+	vector<string> secant_obs_names;
+	Eigen::MatrixXd secant_del_numeric_pars;
+	Eigen::MatrixXd secant_del_obs;
+	WeightedJacobianCache jac_cache;
 		
 	virtual Parameters limit_parameters_freeze_all_ip(const Parameters &init_active_ctl_pars,
 		Parameters &upgrade_active_ctl_pars, const Parameters &frozen_active_ctl_pars = Parameters());
@@ -160,6 +169,8 @@ protected:
 		const Eigen::VectorXd &residuals_vec, const vector<string> &obs_names_vec,
 		const Parameters &base_run_active_ctl_par, const Parameters &freeze_active_ctl_pars,
 		DynamicRegularization &tmp_regul_scheme, bool scale_upgrade = false);
+	bool use_broyden_update() const;
+	void clear_secant_info();
 	int check_bnd_par(Parameters &new_freeze_active_ctl_pars, const Parameters &current_active_ctl_pars, const Parameters &new_upgrade_active_ctl_pars, const Parameters &new_grad_active_ctl_pars = Parameters());
 };
 
@@ -22,6 +22,7 @@
 #include <algorithm>
 #include <math.h>
 #include <sstream>
+#include <limits>
 #include <Eigen/Dense>
 #include <cassert>
 #include <iostream>
@@ -555,14 +556,17 @@ const  Eigen::SparseMatrix<double>& TranSVD::get_vt() const
 }
 
 
-TranSVD::TranSVD(int _max_sing, double _eign_thresh, const string &_name) : Transformation(_name)
+TranSVD::TranSVD(int _max_sing, double _eign_thresh, const string &_name) : Transformation(_name),
+	performance_log(nullptr), incremental(false), incremental_drift_tol(1.0e-2)
 {
 	tran_svd_pack = new SVD_REDSVD(_max_sing, _eign_thresh);
 }
 
 
 TranSVD::TranSVD(const TranSVD& rhs)
-	: Transformation(rhs), base_parameter_names(rhs.base_parameter_names),
+	: Transformation(rhs), performance_log(rhs.performance_log),
+	incremental(rhs.incremental), incremental_drift_tol(rhs.incremental_drift_tol),
+	base_parameter_names(rhs.base_parameter_names),
 	super_parameter_names(rhs.super_parameter_names),
 	obs_names(rhs.obs_names),
 	//SqrtQ_J(rhs.SqrtQ_J),
@@ -585,15 +589,33 @@ void TranSVD::set_SVD_pack()
 	tran_svd_pack = new SVD_EIGEN(max_sing, eigthresh);
 }
 
-void TranSVD::set_performance_log(PerformanceLog *performance_log)
+void TranSVD::set_performance_log(PerformanceLog *_performance_log)
 {
+	performance_log = _performance_log;
 	tran_svd_pack->set_performance_log(performance_log);
 }
 
+void TranSVD::build_super_parameter_names()
+{
+	stringstream sup_name;
+	int n_sing_val = Sigma.size();
+
+	super_parameter_names.clear();
+	for(int i=0; i<n_sing_val; ++i) {
+		sup_name.str("");
+		sup_name << "SUP_";
+		sup_name << i+1;
+		super_parameter_names.push_back(sup_name.str());
+	}
+	if (n_sing_val <= 0 )
+	{
+		throw PestError("TranSVD::update() - super parameter transformation returned 0 super parameters.  Jacobian must equal 0.");
+	}
+}
+
 void TranSVD::calc_svd()
 {
 	debug_msg("TranSVD::calc_svd begin");
-	stringstream sup_name;
 	VectorXd Sigma_trunc;
 	//tran_svd_pack->solve_ip(SqrtQ_J, Sigma, U, Vt, Sigma_trunc);
 	tran_svd_pack->solve_ip(jtqj, Sigma, U, Vt, Sigma_trunc);
@@ -604,22 +626,100 @@ void TranSVD::calc_svd()
 	debug_print(Vt);
 	debug_print(Sigma_trunc);
 
+	build_super_parameter_names();
+	debug_print(super_parameter_names);
+	debug_msg("TranSVD::calc_svd end");
+}
 
-	int n_sing_val = Sigma.size();
+bool TranSVD::calc_svd_incremental(const vector<string> &prev_base_parameter_names)
+{
+	//Update the existing right singular subspace of JtQJ using a block subspace iteration that is
+	//warm-started with the previous V.  Since JtQJ is symmetric positive semi-definite, the Ritz pairs
+	//of the iteration are its singular triplets (U = V).  Returns false without modifying the
+	//current factorization if the previous subspace can't be reused or has drifted too far, in
+	//which case the caller should fall back to a full SVD
+	debug_msg("TranSVD::calc_svd_incremental begin");
+	const int max_iter = 3;
+	int n_base = jtqj.rows();
+	int n_prev = Vt.rows();
+	if ((n_prev == 0) || (Vt.cols() != n_base) || (prev_base_parameter_names != base_parameter_names))
+	{
+		if (performance_log)
+			performance_log->log_event("incremental super parameter update not possible: parameter set changed");
+		return false;
+	}
+	int max_sing = min(tran_svd_pack->get_max_sing(), n_base);
+	double eigthresh = tran_svd_pack->get_eign_thres();
+	//oversample the block so that growth of the significant subspace can be detected
+	int n_over = min(5 + n_prev / 10, n_base - n_prev);
+	int n_block = n_prev + n_over;
+
+	Eigen::MatrixXd V(n_base, n_block);
+	V.leftCols(n_prev) = Eigen::MatrixXd(Vt.transpose());
+	if (n_over > 0)
+		V.rightCols(n_over) = Eigen::MatrixXd::Random(n_base, n_over);
+
+	Eigen::MatrixXd Q, AQ, Ritz_vecs;
+	Eigen::VectorXd Ritz_vals;
+	Eigen::SelfAdjointEigenSolver<Eigen::MatrixXd> eig_solver;
+	double drift = numeric_limits<double>::max();
+	int i_iter = 0;
+	for (; i_iter < max_iter; ++i_iter)
+	{
+		Eigen::HouseholderQR<Eigen::MatrixXd> qr(V);
+		Q = qr.householderQ() * Eigen::MatrixXd::Identity(n_base, n_block);
+		AQ = jtqj * Q;
+		eig_solver.compute(Q.transpose() * AQ);
+		//eigen values are returned in increasing order
+		Ritz_vals = eig_solver.eigenvalues().reverse();
+		Ritz_vecs = Q * eig_solver.eigenvectors().rowwise().reverse();
+		if (Ritz_vals(0) <= 0.0)
+			break;
+		//relative residual of the leading Ritz pairs
+		Eigen::MatrixXd resid = AQ * eig_solver.eigenvectors().rowwise().reverse().leftCols(n_prev) -
+			Ritz_vecs.leftCols(n_prev) * Ritz_vals.head(n_prev).asDiagonal();
+		drift = resid.norm() / Ritz_vals.head(n_prev).norm();
+		if (drift < incremental_drift_tol)
+			break;
+		V = AQ;
+	}
+	stringstream ss;
+	ss << "incremental super parameter update: relative residual " << drift << " after " << min(i_iter + 1, max_iter) << " subspace iterations";
+	if (performance_log)
+		performance_log->log_event(ss.str());
+	if ((Ritz_vals.size() == 0) || (Ritz_vals(0) <= 0.0) || (drift >= incremental_drift_tol))
+	{
+		if (performance_log)
+			performance_log->log_event("incremental super parameter update: subspace drifted too far, reverting to full SVD");
+		return false;
+	}
 
-	super_parameter_names.clear();
-	for(int i=0; i<n_sing_val; ++i) {
-		sup_name.str("");
-		sup_name << "SUP_";
-		sup_name << i+1;
-		super_parameter_names.push_back(sup_name.str());
+	int num_sing_used = 0;
+	for (int i_sing = 0; i_sing < min(n_block, max_sing); ++i_sing)
+	{
+		if (Ritz_vals(i_sing) / Ritz_vals(0) > eigthresh)
+			++num_sing_used;
+		else
+			break;
 	}
-	if (n_sing_val <= 0 )
+	//if every value in the block is significant, the new spectrum may extend past the
+	//block so the truncation can't be trusted
+	if ((num_sing_used == n_block) && (n_block < max_sing))
 	{
-		throw PestError("TranSVD::update() - super parameter transformation returned 0 super parameters.  Jacobian must equal 0.");
+		if (performance_log)
+			performance_log->log_event("incremental super parameter update: significant subspace grew, reverting to full SVD");
+		return false;
 	}
+	Sigma = Ritz_vals.head(num_sing_used);
+	Vt = Eigen::MatrixXd(Ritz_vecs.leftCols(num_sing_used).transpose()).sparseView();
+	U = Eigen::MatrixXd(Ritz_vecs.leftCols(num_sing_used)).sparseView();
+
+	debug_print(Sigma);
+	debug_print(Vt);
+	build_super_parameter_names();
 	debug_print(super_parameter_names);
-	debug_msg("TranSVD::calc_svd end");
+	debug_msg("TranSVD::calc_svd_incremental end");
+	return true;
 }
 
 void TranSVD::update_reset_frozen_pars(const Jacobian &jacobian, const QSqrtMatrix &Q_sqrt, const Parameters &base_numeric_pars,
@@ -628,7 +728,7 @@ void TranSVD::update_reset_frozen_pars(const Jacobian &jacobian, const QSqrtMatr
 {
 	debug_msg("TranSVD::update_reset_frozen_pars begin");
 	debug_print(_frozen_derivative_pars);
-	stringstream sup_name;
+	vector<string> prev_base_parameter_names = base_parameter_names;
 	super_parameter_names.clear();
 
 	tran_svd_pack->set_max_sing(maxsing);
@@ -659,7 +759,8 @@ void TranSVD::update_reset_frozen_pars(const Jacobian &jacobian, const QSqrtMatr
 		jtqj = lamb.sparseView();
 		lamb.resize(0, 0);
 	}
-	calc_svd();
+	if (!(incremental && calc_svd_incremental(prev_base_parameter_names)))
+		calc_svd();
 	debug_print(this->base_parameter_names);
 	debug_print(this->frozen_derivative_parameters);
 	debug_msg("TranSVD::update_reset_frozen_pars end");
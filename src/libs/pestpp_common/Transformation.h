@@ -317,8 +317,13 @@ public:
 	void save(ostream &fout) const;
 	void read(istream &fin);
 	void set_performance_log(PerformanceLog *_performance_log);
+	void set_incremental(bool _incremental, double _drift_tol) { incremental = _incremental; incremental_drift_tol = _drift_tol; }
+	bool get_incremental() const { return incremental; }
 protected:
 	SVDPackage *tran_svd_pack;
+	PerformanceLog *performance_log;
+	bool incremental;
+	double incremental_drift_tol;
 
 	vector<string> base_parameter_names;
 	vector<string> super_parameter_names;
@@ -331,6 +336,8 @@ protected:
 	Parameters init_base_numeric_parameters;
 	Parameters frozen_derivative_parameters;
 	void calc_svd();
+	bool calc_svd_incremental(const vector<string> &prev_base_parameter_names);
+	void build_super_parameter_names();
 };
 
 //class TranNormalize: public Transformation {
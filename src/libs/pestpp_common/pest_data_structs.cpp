@@ -319,6 +319,15 @@ map<string,PestppOptions::ARG_STATUS> PestppOptions::parse_plusplus_line(const s
 		stat = assign_value_by_key(spair.first, spair.second);
 		arg_map[spair.first] = stat;
 	}
+	catch (const PestError &)
+	{
+		arg_map[spair.first] = ARG_STATUS::ARG_INVALID;
+	}
+	catch (const runtime_error &)
+	{
+		//a value assign_value_by_key() rejected - the message says what is wrong with it
+		throw;
+	}
 	catch (...)
 	{
 		arg_map[spair.first] = ARG_STATUS::ARG_INVALID;
@@ -359,6 +368,14 @@ PestppOptions::ARG_STATUS PestppOptions::assign_value_by_key(string key, const s
 	else if (key=="N_ITER_SUPER"){
 		convert_ip(value, n_iter_super);
 	}
+	else if (key == "SUPER_INCREMENTAL")
+	{
+		super_incremental = pest_utils::parse_string_arg_to_bool(value);
+	}
+	else if (key == "SUPER_INCREMENTAL_TOL")
+	{
+		convert_ip(value, super_incremental_tol);
+	}
 	else if (key=="SVD_PACK"){
 
 		if (value == "PROPACK")
@@ -478,6 +495,14 @@ PestppOptions::ARG_STATUS PestppOptions::assign_value_by_key(string key, const s
 	{
 		glm_accept_mc_phi = pest_utils::parse_string_arg_to_bool(value);
 	}
+	else if (key == "GLM_BROYDEN_CADENCE")
+	{
+		convert_ip(value, glm_broyden_cadence);
+	}
+	else if (key == "GLM_BROYDEN_PHI_STALL")
+	{
+		convert_ip(value, glm_broyden_phi_stall);
+	}
 	else if (key == "OVERDUE_RESCHED_FAC"){
 		convert_ip(value, overdue_reched_fac);
 	}
@@ -493,6 +518,56 @@ PestppOptions::ARG_STATUS PestppOptions::assign_value_by_key(string key, const s
 		//convert_ip(value, condor_submit_file);
 		condor_submit_file = org_value;
 	}
+	else if (key == "PANTHER_SCHEDULE")
+	{
+		if ((value != "FIFO") && (value != "PRIORITY"))
+			throw runtime_error("++panther_schedule arg must be in {FIFO,PRIORITY}, not " + org_value);
+		panther_schedule = value;
+	}
+	else if (key == "PANTHER_TAIL_SPECULATION")
+	{
+		panther_tail_speculation = pest_utils::parse_string_arg_to_bool(value);
+	}
+	else if (key == "PANTHER_AGENT_PERSISTENT")
+	{
+		panther_agent_persistent = pest_utils::parse_string_arg_to_bool(value);
+	}
+	else if (key == "PANTHER_AGENT_SLOTS")
+	{
+		convert_ip(value, panther_agent_slots);
+		if (panther_agent_slots < 1)
+			throw runtime_error("++panther_agent_slots must be greater than 0, not " + org_value);
+	}
+	else if (key == "PANTHER_AGENT_CACHE_MB")
+	{
+		convert_ip(value, panther_agent_cache_mb);
+		if (panther_agent_cache_mb < 0.0)
+			throw runtime_error("++panther_agent_cache_mb must not be negative, not " + org_value);
+	}
+	else if (key == "PANTHER_KEEPALIVE_IDLE")
+	{
+		convert_ip(value, panther_keepalive_idle);
+	}
+	else if (key == "PANTHER_KEEPALIVE_INTERVAL")
+	{
+		convert_ip(value, panther_keepalive_interval);
+	}
+	else if (key == "PANTHER_ATTACHMENTS")
+	{
+		panther_attachments.clear();
+		vector<string> tok;
+		tokenize(org_value, tok, ",");
+		for (const auto &name : tok)
+		{
+			panther_attachments.push_back(strip_cp(name));
+		}
+	}
+	else if (key == "NUM_LOCAL_WORKERS")
+	{
+		convert_ip(value, num_local_workers);
+		if (num_local_workers < 1)
+			throw runtime_error("++num_local_workers must be greater than 0, not " + org_value);
+	}
 	else if ((key == "SWEEP_PARAMETER_CSV_FILE") || (key == "SWEEP_PAR_CSV"))
 	{
 		passed_args.insert("SWEEP_PARAMETER_CSV_FILE");
@@ -800,6 +875,20 @@ PestppOptions::ARG_STATUS PestppOptions::assign_value_by_key(string key, const s
 	{
 		convert_ip(value, par_sigma_range);
 	}
+	else if (key == "JAC_REFRESH_FRAC")
+	{
+		convert_ip(value, jac_refresh_frac);
+		if ((jac_refresh_frac <= 0.0) || (jac_refresh_frac > 1.0))
+			throw runtime_error("++jac_refresh_frac must be greater than 0.0 and less than or equal to 1.0, not " + org_value);
+	}
+	else if (key == "JAC_REFRESH_MAX_AGE")
+	{
+		convert_ip(value, jac_refresh_max_age);
+	}
+	else if (key == "JAC_BATCH_RUNS")
+	{
+		jac_batch_runs = pest_utils::parse_string_arg_to_bool(value);
+	}
 	else if (key == "YAMR_POLL_INTERVAL") 
 	{
 		convert_ip(value, worker_poll_interval);
@@ -954,6 +1043,18 @@ PestppOptions::ARG_STATUS PestppOptions::assign_value_by_key(string key, const s
 	{
 		fill_tpl_zeros = pest_utils::parse_string_arg_to_bool(value);
 	}
+	else if (key == "ATOMIC_MODEL_IO")
+	{
+		atomic_model_io = pest_utils::parse_string_arg_to_bool(value);
+	}
+	else if (key == "SPARSE_RUN_STORAGE")
+	{
+		sparse_run_storage = pest_utils::parse_string_arg_to_bool(value);
+	}
+	else if (key == "MODEL_PLUGIN")
+	{
+		model_plugin = org_value;
+	}
 	else if (key == "ADDITIONAL_INS_DELIMITERS")
 	{
 		convert_ip(value, additional_ins_delimiters);
@@ -992,13 +1093,31 @@ void PestppOptions::summary(ostream& os) const
 	os << "overdue_resched_fac: " << overdue_giveup_fac << endl;
 	os << "overdue_giveup_minutes: " << overdue_giveup_minutes << endl;
 	os << "condor_submit_file: " << condor_submit_file << endl;
+	os << "panther_schedule: " << panther_schedule << endl;
+	os << "panther_tail_speculation: " << panther_tail_speculation << endl;
+	os << "panther_agent_persistent: " << panther_agent_persistent << endl;
+	os << "panther_agent_slots: " << panther_agent_slots << endl;
+	os << "panther_agent_cache_mb: " << panther_agent_cache_mb << endl;
+	os << "panther_keepalive_idle: " << panther_keepalive_idle << endl;
+	os << "panther_keepalive_interval: " << panther_keepalive_interval << endl;
+	os << "panther_attachments: ";
+	for (auto &name : panther_attachments)
+		os << name << ",";
+	os << endl;
+	os << "num_local_workers: " << num_local_workers << endl;
 	os << "tie_by_group: " << tie_by_group << endl;
 	os << "par_sigma_range: " << par_sigma_range << endl;
+	os << "jac_refresh_frac: " << jac_refresh_frac << endl;
+	os << "jac_refresh_max_age: " << jac_refresh_max_age << endl;
+	os << "jac_batch_runs: " << jac_batch_runs << endl;
 	os << "enforce_tied_bounds: " << enforce_tied_bounds << endl;
 	os << "debug_parse_only: " << debug_parse_only << endl;
 	os << "check_tplins: " << check_tplins << endl;
 	os << "fill_tpl_zeros: " << fill_tpl_zeros << endl;
 	os << "additional_ins_delimiters: " << additional_ins_delimiters << endl;
+	os << "atomic_model_io: " << atomic_model_io << endl;
+	os << "model_plugin: " << model_plugin << endl;
+	os << "sparse_run_storage: " << sparse_run_storage << endl;
 	
 
 	os << endl << "...pestpp-glm specific options:" << endl;
@@ -1006,6 +1125,8 @@ void PestppOptions::summary(ostream& os) const
 	os << "super_eigthresh: " << super_eigthres << endl;
 	os << "n_iter_base: " << n_iter_base << endl;
 	os << "n_iter_super: " << n_iter_super << endl;;
+	os << "super_incremental: " << super_incremental << endl;
+	os << "super_incremental_tol: " << super_incremental_tol << endl;
 	os << "super_relparmax: " << super_relparmax << endl;
 	os << "max_super_frz_iter: " << max_super_frz_iter << endl;	
 	os << "max_reg_iter: " << max_reg_iter << endl;
@@ -1035,6 +1156,8 @@ void PestppOptions::summary(ostream& os) const
 	os << "glm_debug_lamb_fail: " << glm_debug_lamb_fail << endl;
 	os << "glm_debug_real_fail: " << glm_debug_real_fail << endl;
 	os << "glm_accept_mc_phi: " << glm_accept_mc_phi << endl;
+	os << "glm_broyden_cadence: " << glm_broyden_cadence << endl;
+	os << "glm_broyden_phi_stall: " << glm_broyden_phi_stall << endl;
 
 
 	if (global_opt == OPT_DE)
@@ -1161,6 +1284,8 @@ void PestppOptions::set_defaults()
 	set_n_iter_base(1000000);
 	set_super_eigthres(1.0e-6);
 	set_max_n_super(1000000);
+	set_super_incremental(false);
+	set_super_incremental_tol(1.0e-2);
 	set_max_super_frz_iter(5);
 	set_max_reg_iter(20);
 	set_uncert_flag(true);
@@ -1170,6 +1295,8 @@ void PestppOptions::set_defaults()
 	set_glm_debug_lamb_fail(false);
 	set_glm_debug_real_fail(false);
 	set_glm_accept_mc_phi(false);
+	set_glm_broyden_cadence(1);
+	set_glm_broyden_phi_stall(0.05);
 	set_prediction_names(vector<string>());
 	set_parcov_filename(string());
 	set_obscov_filename(string());
@@ -1216,6 +1343,9 @@ void PestppOptions::set_defaults()
 	set_ies_group_draws(true);
 	set_ies_enforce_bounds(true);
 	set_par_sigma_range(4.0);
+	set_jac_refresh_frac(1.0);
+	set_jac_refresh_max_age(3);
+	set_jac_batch_runs(true);
 	set_ies_save_binary(false);
 	set_ies_localizer("");
 	set_ies_accept_phi_fac(1.05);
@@ -1255,6 +1385,15 @@ void PestppOptions::set_defaults()
 	set_gsa_rand_seed(2);
 
 	set_condor_submit_file(string());
+	set_panther_schedule("FIFO");
+	set_panther_tail_speculation(false);
+	set_panther_agent_persistent(false);
+	set_panther_agent_slots(1);
+	set_panther_agent_cache_mb(1024.0);
+	set_panther_keepalive_idle(0);
+	set_panther_keepalive_interval(10);
+	set_panther_attachments(vector<string>());
+	set_num_local_workers(0);
 	set_overdue_giveup_minutes(1.0e+30);
 	set_overdue_reched_fac(1.15);
 	set_overdue_giveup_fac(100);
@@ -1266,6 +1405,9 @@ void PestppOptions::set_defaults()
 	set_check_tplins(true);
 	set_fill_tpl_zeros(false);
 	set_additional_ins_delimiters("");
+	set_atomic_model_io(true);
+	set_model_plugin("");
+	set_sparse_run_storage(false);
 }
 
 ostream& operator<< (ostream &os, const ParameterInfo& val)
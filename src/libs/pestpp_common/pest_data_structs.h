@@ -234,6 +234,10 @@ public:
 	void set_super_eigthres(double _super_eigthres) { super_eigthres = _super_eigthres; }
 	void set_n_iter_base(int _n_iter_base) { n_iter_base = _n_iter_base; }
 	void set_n_iter_super(int _n_iter_super) { n_iter_super = _n_iter_super; }
+	bool get_super_incremental() const { return super_incremental; }
+	void set_super_incremental(bool _flag) { super_incremental = _flag; }
+	double get_super_incremental_tol() const { return super_incremental_tol; }
+	void set_super_incremental_tol(double _tol) { super_incremental_tol = _tol; }
 	void set_svd_pack(const SVD_PACK _svd_pack) { svd_pack = _svd_pack; }
 	void set_super_relparmax(double _super_relparmax) { super_relparmax = _super_relparmax; };
 	void set_max_run_fail(int _max_run_fail) { max_run_fail = _max_run_fail; }
@@ -262,6 +266,10 @@ public:
 	void set_glm_debug_real_fail(bool _flag) { glm_debug_real_fail = _flag; }
 	bool get_glm_accept_mc_phi() const { return glm_accept_mc_phi; }
 	void set_glm_accept_mc_phi(bool _flag) { glm_accept_mc_phi = _flag; }
+	int get_glm_broyden_cadence() const { return glm_broyden_cadence; }
+	void set_glm_broyden_cadence(int _cadence) { glm_broyden_cadence = _cadence; }
+	double get_glm_broyden_phi_stall() const { return glm_broyden_phi_stall; }
+	void set_glm_broyden_phi_stall(double _stall) { glm_broyden_phi_stall = _stall; }
 
 	double get_overdue_reched_fac()const { return overdue_reched_fac; }
 	void set_overdue_reched_fac(double _val) { overdue_reched_fac = _val; }
@@ -269,6 +277,26 @@ public:
 	void set_overdue_giveup_fac(double _val) { overdue_giveup_fac = _val; }
 	string get_condor_submit_file() const { return condor_submit_file; }
 	void set_condor_submit_file(string _condor_submit_file) { condor_submit_file = _condor_submit_file; }
+	string get_panther_schedule() const { return panther_schedule; }
+	void set_panther_schedule(string _panther_schedule) { panther_schedule = _panther_schedule; }
+	bool get_panther_tail_speculation() const { return panther_tail_speculation; }
+	void set_panther_tail_speculation(bool _flag) { panther_tail_speculation = _flag; }
+	bool get_panther_agent_persistent() const { return panther_agent_persistent; }
+	void set_panther_agent_persistent(bool _flag) { panther_agent_persistent = _flag; }
+	int get_panther_agent_slots() const { return panther_agent_slots; }
+	void set_panther_agent_slots(int _n_slots) { panther_agent_slots = _n_slots; }
+	//size the agent's attachment cache is trimmed to at startup
+	double get_panther_agent_cache_mb() const { return panther_agent_cache_mb; }
+	void set_panther_agent_cache_mb(double _mb) { panther_agent_cache_mb = _mb; }
+	int get_panther_keepalive_idle() const { return panther_keepalive_idle; }
+	void set_panther_keepalive_idle(int _secs) { panther_keepalive_idle = _secs; }
+	int get_panther_keepalive_interval() const { return panther_keepalive_interval; }
+	void set_panther_keepalive_interval(int _secs) { panther_keepalive_interval = _secs; }
+	//master side files shipped to the agents with every run
+	vector<string> get_panther_attachments() const { return panther_attachments; }
+	void set_panther_attachments(vector<string> _files) { panther_attachments = _files; }
+	int get_num_local_workers() const { return num_local_workers; }
+	void set_num_local_workers(int _n_workers) { num_local_workers = _n_workers; }
 	string get_sweep_parameter_csv_file()const { return sweep_parameter_csv_file; }
 	void set_sweep_parameter_csv_file(string _file) { sweep_parameter_csv_file = _file; }
 	string get_sweep_output_csv_file()const { return sweep_output_csv_file; }
@@ -360,6 +388,12 @@ public:
 
 	double get_par_sigma_range() const { return par_sigma_range; }
 	void set_par_sigma_range(double _par_sigma_range) { par_sigma_range = _par_sigma_range; }
+	double get_jac_refresh_frac() const { return jac_refresh_frac; }
+	void set_jac_refresh_frac(double _frac) { jac_refresh_frac = _frac; }
+	int get_jac_refresh_max_age() const { return jac_refresh_max_age; }
+	void set_jac_refresh_max_age(int _age) { jac_refresh_max_age = _age; }
+	bool get_jac_batch_runs() const { return jac_batch_runs; }
+	void set_jac_batch_runs(bool _flag) { jac_batch_runs = _flag; }
 	bool get_ies_save_binary() const { return ies_save_binary; }
 	void set_ies_save_binary(bool _ies_save_binary) { ies_save_binary = _ies_save_binary; }
 	string get_ies_localizer() const { return ies_localizer; }
@@ -449,6 +483,12 @@ public:
 	bool get_fill_tpl_zeros() const { return fill_tpl_zeros; }
 	void set_additional_ins_delimiters(string _delims) { additional_ins_delimiters = _delims; }
 	string get_additional_ins_delimiters() const { return additional_ins_delimiters; }
+	void set_atomic_model_io(bool _flag) { atomic_model_io = _flag; }
+	bool get_atomic_model_io() const { return atomic_model_io; }
+	void set_model_plugin(string _lib_name) { model_plugin = _lib_name; }
+	string get_model_plugin() const { return model_plugin; }
+	void set_sparse_run_storage(bool _flag) { sparse_run_storage = _flag; }
+	bool get_sparse_run_storage() const { return sparse_run_storage; }
 
 
 	void set_defaults();
@@ -460,6 +500,8 @@ private:
 	int n_iter_super;
 	int max_n_super;
 	double super_eigthres;
+	bool super_incremental;
+	double super_incremental_tol;
 	SVD_PACK svd_pack;
 	double super_relparmax;
 	int max_run_fail;
@@ -471,6 +513,8 @@ private:
 	bool glm_debug_lamb_fail;
 	bool glm_debug_real_fail;
 	bool glm_accept_mc_phi;
+	int glm_broyden_cadence;
+	double glm_broyden_phi_stall;
 
 	vector<double> base_lambda_vec;
 	vector<double> lambda_scale_vec;
@@ -490,6 +534,9 @@ private:
 	bool check_tplins;
 	bool fill_tpl_zeros;
 	string additional_ins_delimiters;
+	bool atomic_model_io;
+	string model_plugin;
+	bool sparse_run_storage;
 
 
 
@@ -498,6 +545,15 @@ private:
 	double overdue_giveup_minutes;
 	double worker_poll_interval;
 	string condor_submit_file;
+	string panther_schedule;
+	bool panther_tail_speculation;
+	bool panther_agent_persistent;
+	int panther_agent_slots;
+	double panther_agent_cache_mb;
+	int panther_keepalive_idle;
+	int panther_keepalive_interval;
+	vector<string> panther_attachments;
+	int num_local_workers;
 
 	string sweep_parameter_csv_file;
 	string sweep_output_csv_file;
@@ -546,6 +602,9 @@ private:
 	//bool ies_num_reals_passed;
 	bool ies_enforce_bounds;
 	double par_sigma_range;
+	double jac_refresh_frac;
+	int jac_refresh_max_age;
+	bool jac_batch_runs;
 	bool ies_save_binary;
 	string ies_localizer;
 	double ies_accept_phi_fac;
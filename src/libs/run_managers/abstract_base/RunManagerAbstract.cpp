@@ -46,11 +46,13 @@ RunManagerAbstract::RunManagerAbstract(const vector<string> _comline_vec,
 
 void RunManagerAbstract::initialize(const Parameters &model_pars, const Observations &obs, const string &_filename)
 {
+	submitted_runs.clear();
 	file_stor.reset(model_pars.get_keys(), obs.get_keys(), _filename);
 }
 
 void RunManagerAbstract::initialize(const std::vector<std::string> &par_names, std::vector<std::string> &obs_names, const string &_filename)
 {
+	submitted_runs.clear();
 	file_stor.reset(par_names, obs_names, _filename);
 }
 
@@ -58,6 +60,7 @@ void RunManagerAbstract::reinitialize(const string &_filename)
 {
 	vector<string> par_names = get_par_name_vec();
 	vector<string> obs_names = get_obs_name_vec();
+	submitted_runs.clear();
 	file_stor.reset(par_names, obs_names, _filename);
 }
 
@@ -85,6 +88,17 @@ int RunManagerAbstract::add_run(const Eigen::VectorXd &model_pars, const string
 	return run_id;
 }
 
+vector<int> RunManagerAbstract::add_runs(const Eigen::MatrixXd &model_pars_mat, const vector<string> &info_txt_vec,
+	const vector<double> &info_value_vec)
+{
+	return file_stor.add_runs(model_pars_mat, info_txt_vec, info_value_vec);
+}
+
+vector<int> RunManagerAbstract::add_runs(const double *model_pars, int n_runs)
+{
+	return file_stor.add_runs(model_pars, n_runs);
+}
+
 void RunManagerAbstract::update_run(int run_id, const Parameters &pars, const Observations &obs)
 {
 
@@ -165,8 +179,19 @@ bool  RunManagerAbstract::get_run(int run_id, double *pars, size_t npars, double
 }
 
 
+void RunManagerAbstract::get_runs(const int *run_ids, int n_runs, double *pars, double *obs, int *status)
+{
+	file_stor.get_runs(run_ids, n_runs, pars, obs, status);
+}
+
+void RunManagerAbstract::get_run_statuses(const int *run_ids, int n_runs, int *status)
+{
+	file_stor.get_run_statuses(run_ids, n_runs, status);
+}
+
 void  RunManagerAbstract::free_memory()
 {
+	submitted_runs.clear();
 }
 
 bool RunManagerAbstract::n_run_failures_exceeded(int id)
@@ -295,3 +320,78 @@ bool RunManagerAbstract::get_observations_vec(int run_id, vector<double> &data_v
 	 run();
 	 return RUN_UNTIL_COND::NORMAL;
  }
+
+ int RunManagerAbstract::submit_run(const Parameters &model_pars, RunCallback callback, const string &info_txt, double info_value)
+ {
+	 int run_id = add_run(model_pars, info_txt, info_value);
+	 track_run(run_id, callback);
+	 return run_id;
+ }
+
+ int RunManagerAbstract::submit_run(const Eigen::VectorXd &model_pars, RunCallback callback, const string &info_txt, double info_value)
+ {
+	 int run_id = add_run(model_pars, info_txt, info_value);
+	 track_run(run_id, callback);
+	 return run_id;
+ }
+
+ void RunManagerAbstract::track_run(int run_id, RunCallback callback)
+ {
+	 submitted_runs[run_id] = callback;
+ }
+
+ int RunManagerAbstract::wait_any(double sec)
+ {
+	 vector<int> run_ids = wait_n(1, sec);
+	 if (run_ids.empty())
+		 return -1;
+	 return run_ids[0];
+ }
+
+ vector<int> RunManagerAbstract::wait_n(int n, double sec)
+ {
+	 vector<int> done_ids;
+	 std::chrono::system_clock::time_point start_time = std::chrono::system_clock::now();
+	 while (true)
+	 {
+		 //collect first so callbacks are free to submit more runs
+		 vector<pair<int, bool>> finished;
+		 for (auto &s : submitted_runs)
+		 {
+			 bool success;
+			 if (submitted_run_done(s.first, success))
+				 finished.push_back(make_pair(s.first, success));
+		 }
+		 for (auto &f : finished)
+		 {
+			 RunCallback callback = submitted_runs[f.first];
+			 submitted_runs.erase(f.first);
+			 done_ids.push_back(f.first);
+			 if (callback)
+				 callback(f.first, f.second);
+		 }
+		 if ((int)done_ids.size() >= n || submitted_runs.empty())
+			 break;
+		 double remaining_sec = -1.0;
+		 if (sec >= 0.0)
+		 {
+			 remaining_sec = sec - pest_utils::get_duration_sec(start_time);
+			 if (remaining_sec <= 0.0)
+				 break;
+		 }
+		 advance_runs(remaining_sec);
+	 }
+	 return done_ids;
+ }
+
+ void RunManagerAbstract::advance_runs(double sec)
+ {
+	 run();
+ }
+
+ bool RunManagerAbstract::submitted_run_done(int run_id, bool &success)
+ {
+	 int istatus = file_stor.get_run_status(run_id);
+	 success = istatus > 0;
+	 return success || istatus <= -max_n_failure;
+ }
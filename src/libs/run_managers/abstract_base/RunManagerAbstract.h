@@ -22,6 +22,8 @@
 #include <string>
 #include <vector>
 #include <set>
+#include <map>
+#include <functional>
 #include "RunStorage.h"
 #include <Eigen/Dense>
 #include <chrono>
@@ -37,6 +39,8 @@ class RunManagerAbstract
 {
 public:
 	enum class RUN_UNTIL_COND { NORMAL, NO_OPS, TIME, NO_OPS_OR_TIME };
+	//called once a submitted run has finished: success is false if the run failed more than max_n_failure times
+	typedef std::function<void(int run_id, bool success)> RunCallback;
 	RunManagerAbstract(const std::vector<std::string> _comline_vec,
 		const std::vector<std::string> _tplfile_vec, const std::vector<std::string> _inpfile_vec,
 		const std::vector<std::string> _insfile_vec, const std::vector<std::string> _outfile_vec,
@@ -49,9 +53,32 @@ public:
 	virtual int add_run(const Parameters &model_pars, const std::string &info_txt="", double info_value=RunStorage::no_data);
 	virtual int add_run(const std::vector<double> &model_pars, const std::string &info_txt="", double info_valuee=RunStorage::no_data);
 	virtual int add_run(const Eigen::VectorXd &model_pars, const std::string &info_txt="", double info_valuee=RunStorage::no_data);
+	virtual std::vector<int> add_runs(const Eigen::MatrixXd &model_pars_mat, const std::vector<std::string> &info_txt_vec,
+		const std::vector<double> &info_value_vec);
+	//add n_runs runs from consecutive blocks of get_par_name_vec().size() parameter values
+	virtual std::vector<int> add_runs(const double *model_pars, int n_runs);
 	virtual void update_run(int run_id, const Parameters &pars, const Observations &obs);
+	//hint to managers that schedule runs (ie PANTHER) - higher priority runs are dispatched first
+	virtual void set_run_priority(int run_id, int priority) {}
+	//ship file_name with a run.  Agents place it in their working directory as agent_file_name (default: the
+	//file name without its path) before the run starts.  Run managers sharing the master's file system ignore this
+	virtual void add_run_attachment(int run_id, const std::string &file_name, const std::string &agent_file_name = "") {}
+	//ship these files with every run, as add_run_attachment() does for a single run
+	virtual void set_common_attachments(const std::vector<std::string> &file_names) {}
 	virtual void run() = 0;
 	virtual RunManagerAbstract::RUN_UNTIL_COND run_until(RUN_UNTIL_COND condition, int n_nops = 0, double sec = 0.0);
+	//asynchronous interface.  submit_run() queues a run (like add_run()) and returns its run id as the handle;
+	//wait_any()/wait_n() make runs until submitted runs finish, invoke their callbacks and return the finished
+	//run ids.  A negative sec waits without a time limit
+	virtual int submit_run(const Parameters &model_pars, RunCallback callback = RunCallback(),
+		const std::string &info_txt = "", double info_value = RunStorage::no_data);
+	virtual int submit_run(const Eigen::VectorXd &model_pars, RunCallback callback = RunCallback(),
+		const std::string &info_txt = "", double info_value = RunStorage::no_data);
+	//track a run that was queued with add_run()
+	virtual void track_run(int run_id, RunCallback callback = RunCallback());
+	virtual int wait_any(double sec = -1.0);
+	virtual std::vector<int> wait_n(int n, double sec = -1.0);
+	virtual int get_n_submitted_runs() const { return submitted_runs.size(); }
 	virtual const std::vector<std::string> &get_par_name_vec() const;
 	virtual const std::vector<std::string> &get_obs_name_vec() const;
 	virtual void get_info(int run_id, int &run_status, std::string &info_txt, double &info_value);
@@ -62,6 +89,9 @@ public:
 	virtual bool get_run(int run_id, double *pars, size_t npars, double *obs, size_t nobs);
 	virtual bool get_run(int run_id, std::vector<double> &pars_vec, std::vector<double> &obs_vec, std::string &info_txt, double &info_value);
 	virtual bool get_run(int run_id, std::vector<double> &pars_vec, std::vector<double> &obs_vec);
+	//read n_runs runs into consecutive blocks of pars and obs (either may be NULL) along with their RunStorage status
+	virtual void get_runs(const int *run_ids, int n_runs, double *pars, double *obs, int *status);
+	virtual void get_run_statuses(const int *run_ids, int n_runs, int *status);
 	virtual const std::set<int> get_failed_run_ids();
 	virtual bool get_model_parameters(int run_num, Parameters &pars);
 	virtual bool get_observations_vec(int run_id, std::vector<double> &data_vec);
@@ -76,6 +106,8 @@ public:
 	virtual ~RunManagerAbstract(void) {}
 	virtual std::string get_run_filename() { return file_stor.get_filename(); }
 	virtual const RunStorage& get_runstorage_ref() const;
+	//store run parameters as changes relative to a base vector - takes effect when the run manager is next reset
+	void set_sparse_run_storage(bool flag) { file_stor.set_sparse_pars(flag); }
 	virtual void print_run_summary(std::ostream &fout) { file_stor.print_run_summary(fout); }
 	//virtual Observations get_init_run_obs() { return init_run_obs; }
 	virtual std::vector<double> get_init_sim() { return init_sim;  }
@@ -94,7 +126,13 @@ protected:
 	bool run_requried(int run_id);
 	//Observations init_run_obs;
 	std::vector<double> init_sim;
+	//submitted runs that have not been returned by wait_any()/wait_n() yet
+	std::map<int, RunCallback> submitted_runs;
 	virtual void update_run_failed(int run_id);
+	//make progress on outstanding runs for at most sec seconds (sec < 0: no limit).  The default makes all
+	//outstanding runs; managers that can return early override it so wait_any() comes back sooner
+	virtual void advance_runs(double sec);
+	bool submitted_run_done(int run_id, bool &success);
 };
 
 #endif /*  RUNMANAGERABSTRACT_H */
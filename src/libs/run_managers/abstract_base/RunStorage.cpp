@@ -21,6 +21,7 @@
 #include <sstream>
 #include <cstdio>
 #include <cassert>
+#include <cstring>
 #include <iostream>
 #include <fstream>
 #include <algorithm>
@@ -35,7 +36,8 @@ using namespace std;
 
 const double RunStorage::no_data = -9999.0;
 
-RunStorage::RunStorage(const string &_filename) :filename(_filename), run_byte_size(0)
+RunStorage::RunStorage(const string &_filename) :filename(_filename), sparse_pars(false), par_stream_end(0),
+	base_offset(-1), run_byte_size(0)
 {
 }
 
@@ -69,12 +71,12 @@ void RunStorage::reset(const vector<string> &_par_names, const vector<string> &_
 	vector<int8_t> serial_onames(Serialization::serialize(obs_names));
 	std::int64_t o_name_size_64 = serial_onames.size() * sizeof(char);
 	// calculate the number of bytes required to store a model run
-	run_par_byte_size = par_names.size() * sizeof(double);
+	run_par_byte_size = sparse_pars ? par_ref_size : par_names.size() * sizeof(double);
 	run_data_byte_size = run_par_byte_size + obs_names.size() * sizeof(double);
 	//compute the amount of memeory required to store a single model run
 	// run_byte_size = size of run_status + size of info_txt + size of info_value + size of parameter oand observation data
 	run_byte_size =  sizeof(std::int8_t) + 41*sizeof(char) * sizeof(double) + run_data_byte_size;
-	std::int64_t  run_size_64 = run_byte_size;
+	std::int64_t  run_size_64 = sparse_pars ? -run_byte_size : run_byte_size;
 	beg_run0 = 4 * sizeof(std::int64_t) + serial_pnames.size() + serial_onames.size();
 	std::int64_t n_runs_64=0;
 	// write header to file
@@ -91,6 +93,34 @@ void RunStorage::reset(const vector<string> &_par_names, const vector<string> &_
 	buf_stream.seekp(get_stream_pos(end_of_runs), ios_base::beg);
 	buf_stream.write(reinterpret_cast<char*>(&buf_status), sizeof(buf_status));
 	buf_stream.flush();
+
+	base_offset = -1;
+	base_pars.clear();
+	if (par_stream.is_open())
+	{
+		par_stream.close();
+	}
+	par_filename = filename + ".pdat";
+	if (sparse_pars)
+	{
+		open_par_stream(true);
+	}
+}
+
+void RunStorage::open_par_stream(bool trunc)
+{
+	if (trunc)
+	{
+		par_stream.open(par_filename.c_str(), ios_base::out | ios_base::binary | ios_base::trunc);
+		par_stream.close();
+	}
+	par_stream.open(par_filename.c_str(), ios_base::out | ios_base::in | ios_base::binary);
+	if (!par_stream.good())
+	{
+		throw PestFileError(par_filename);
+	}
+	par_stream.seekg(0, ios_base::end);
+	par_stream_end = par_stream.tellg();
 }
 
 
@@ -119,7 +149,8 @@ void RunStorage::init_restart(const std::string &_filename)
 
 	std::int64_t  run_size_64;
 	buf_stream.read((char*) &run_size_64, sizeof(run_size_64));
-	run_byte_size = run_size_64;
+	sparse_pars = run_size_64 < 0;
+	run_byte_size = sparse_pars ? -run_size_64 : run_size_64;
 
 	std::int64_t p_name_size_64;
 	buf_stream.read((char*) &p_name_size_64, sizeof(p_name_size_64));
@@ -138,9 +169,21 @@ void RunStorage::init_restart(const std::string &_filename)
 	Serialization::unserialize(serial_onames, obs_names);
 
 	beg_run0 = 4 * sizeof(std::int64_t) + serial_pnames.size() + serial_onames.size();
-	run_par_byte_size = par_names.size() * sizeof(double);
+	run_par_byte_size = sparse_pars ? par_ref_size : par_names.size() * sizeof(double);
 	run_data_byte_size = run_par_byte_size + obs_names.size() * sizeof(double);
 
+	base_offset = -1;
+	base_pars.clear();
+	if (par_stream.is_open())
+	{
+		par_stream.close();
+	}
+	par_filename = filename + ".pdat";
+	if (sparse_pars)
+	{
+		open_par_stream(false);
+	}
+
 	//check buffer to see if a write was improperly terminated
 	std::int8_t r_status = 0;
 	std::int8_t buf_status = 0;
@@ -154,12 +197,13 @@ void RunStorage::init_restart(const std::string &_filename)
 		buf_stream.read(reinterpret_cast<char*>(&buf_run_id), sizeof(buf_run_id));
 		buf_stream.read(reinterpret_cast<char*>(&r_status), sizeof(r_status));
 		check_rec_id(buf_run_id);
-		size_t n_par = par_names.size();
 		size_t n_obs = obs_names.size();
-		vector<double> pars_vec(n_par, Parameters::no_data);
+		//the parameter section is copied as is.  With sparse storage it is a reference to entries
+		//that were flushed to par_stream before the buffer was written
+		vector<char> par_sec(run_par_byte_size);
 		vector<double> obs_vec(n_obs, Observations::no_data);
 
-		buf_stream.read(reinterpret_cast<char*>(pars_vec.data()), n_par * sizeof(double));
+		buf_stream.read(par_sec.data(), par_sec.size());
 		buf_stream.read(reinterpret_cast<char*>(obs_vec.data()), n_obs * sizeof(double));
 
 		//write data
@@ -167,7 +211,7 @@ void RunStorage::init_restart(const std::string &_filename)
 		buf_stream.write(reinterpret_cast<char*>(&r_status), sizeof(r_status));
 		//skip over info_txt and info_value fields
 		buf_stream.seekp(sizeof(char)*info_txt_length + sizeof(double), ios_base::cur);
-		buf_stream.write(reinterpret_cast<char*>(pars_vec.data()), pars_vec.size() * sizeof(double));
+		buf_stream.write(par_sec.data(), par_sec.size());
 		buf_stream.write(reinterpret_cast<char*>(obs_vec.data()), obs_vec.size() * sizeof(double));
 		buf_stream.flush();
 		//reset flag for buffer at end of file to 0 to signal it is no longer relavent
@@ -203,12 +247,12 @@ int RunStorage::get_num_good_runs()
 	}
 	return n_ok;
 }
-int RunStorage::increment_nruns()
+int RunStorage::increment_nruns(int n_add)
 {
 	buf_stream.seekg(0, ios_base::beg);
 	std::int64_t n_runs_64;
 	buf_stream.read((char*) &n_runs_64, sizeof(n_runs_64));
-	++n_runs_64;
+	n_runs_64 += n_add;
 	buf_stream.seekp(0, ios_base::beg);
 	buf_stream.write((char*) &n_runs_64, sizeof(n_runs_64));
 	int n_runs = n_runs_64;
@@ -231,6 +275,120 @@ streamoff RunStorage::get_stream_pos(int run_id)
 	return pos;
 }
 
+void RunStorage::encode_pars(const double *par_data, char *dest)
+{
+	if (!sparse_pars)
+	{
+		memcpy(dest, par_data, run_par_byte_size);
+		return;
+	}
+	size_t n_par = par_names.size();
+	//a changed value costs an index and a value, so only store changes when fewer than a third
+	//of the parameters differ from the base.  Otherwise write a full vector and make it the new base
+	size_t max_delta = n_par / 3;
+	vector<std::int32_t> delta_idx;
+	bool use_delta = base_offset >= 0;
+	for (size_t i = 0; use_delta && i < n_par; ++i)
+	{
+		if (memcmp(&par_data[i], &base_pars[i], sizeof(double)) != 0)
+		{
+			if (delta_idx.size() == max_delta)
+				use_delta = false;
+			else
+				delta_idx.push_back(i);
+		}
+	}
+	std::int64_t full_offset = base_offset;
+	std::int64_t delta_offset = -1;
+	std::int32_t n_delta = 0;
+	par_stream.seekp(par_stream_end, ios_base::beg);
+	if (use_delta && !delta_idx.empty())
+	{
+		n_delta = delta_idx.size();
+		vector<double> delta_val;
+		delta_val.reserve(n_delta);
+		for (auto i : delta_idx)
+			delta_val.push_back(par_data[i]);
+		delta_offset = par_stream_end;
+		par_stream.write(reinterpret_cast<const char*>(delta_idx.data()), n_delta * sizeof(std::int32_t));
+		par_stream.write(reinterpret_cast<const char*>(delta_val.data()), n_delta * sizeof(double));
+		par_stream_end += n_delta * (sizeof(std::int32_t) + sizeof(double));
+	}
+	else if (!use_delta)
+	{
+		full_offset = par_stream_end;
+		par_stream.write(reinterpret_cast<const char*>(par_data), n_par * sizeof(double));
+		par_stream_end += n_par * sizeof(double);
+		base_offset = full_offset;
+		base_pars.assign(par_data, par_data + n_par);
+	}
+	par_stream.flush();
+	if (!par_stream.good())
+	{
+		throw PestFileError(par_filename);
+	}
+	memcpy(dest, &full_offset, sizeof(full_offset));
+	memcpy(dest + sizeof(full_offset), &delta_offset, sizeof(delta_offset));
+	memcpy(dest + 2 * sizeof(full_offset), &n_delta, sizeof(n_delta));
+}
+
+void RunStorage::decode_pars(const char *src, double *par_data)
+{
+	if (!sparse_pars)
+	{
+		memcpy(par_data, src, run_par_byte_size);
+		return;
+	}
+	size_t n_par = par_names.size();
+	std::int64_t full_offset;
+	std::int64_t delta_offset;
+	std::int32_t n_delta;
+	memcpy(&full_offset, src, sizeof(full_offset));
+	memcpy(&delta_offset, src + sizeof(full_offset), sizeof(delta_offset));
+	memcpy(&n_delta, src + 2 * sizeof(full_offset), sizeof(n_delta));
+	if (full_offset < 0 || full_offset + std::int64_t(n_par * sizeof(double)) > par_stream_end)
+	{
+		//run was added but the record was never written
+		std::fill(par_data, par_data + n_par, Parameters::no_data);
+		return;
+	}
+	if (full_offset == base_offset)
+	{
+		std::copy(base_pars.begin(), base_pars.end(), par_data);
+	}
+	else
+	{
+		par_stream.seekg(full_offset, ios_base::beg);
+		par_stream.read(reinterpret_cast<char*>(par_data), n_par * sizeof(double));
+	}
+	if (n_delta > 0)
+	{
+		vector<std::int32_t> delta_idx(n_delta);
+		vector<double> delta_val(n_delta);
+		par_stream.seekg(delta_offset, ios_base::beg);
+		par_stream.read(reinterpret_cast<char*>(delta_idx.data()), n_delta * sizeof(std::int32_t));
+		par_stream.read(reinterpret_cast<char*>(delta_val.data()), n_delta * sizeof(double));
+		for (std::int32_t i = 0; i < n_delta; ++i)
+			par_data[delta_idx[i]] = delta_val[i];
+	}
+	if (!par_stream.good())
+	{
+		throw PestError("Error in RunStorage routine.  Unable to read parameters from " + par_filename);
+	}
+}
+
+void RunStorage::read_pars(double *par_data)
+{
+	if (!sparse_pars)
+	{
+		buf_stream.read(reinterpret_cast<char*>(par_data), run_par_byte_size);
+		return;
+	}
+	char par_ref[par_ref_size];
+	buf_stream.read(par_ref, par_ref_size);
+	decode_pars(par_ref, par_data);
+}
+
  int RunStorage::add_run(const vector<double> &model_pars, const string &info_txt, double info_value)
  {
 	std::int8_t r_status = 0;
@@ -242,7 +400,9 @@ streamoff RunStorage::get_stream_pos(int run_id)
 	buf_stream.write(reinterpret_cast<char*>(&r_status), sizeof(r_status));
 	buf_stream.write(reinterpret_cast<char*>(info_txt_buf.data()), sizeof(char)*info_txt_buf.size());
 	buf_stream.write(reinterpret_cast<char*>(&info_value), sizeof(double));
-	buf_stream.write(reinterpret_cast<const char*>(&model_pars[0]), model_pars.size()*sizeof(double));
+	vector<char> par_sec(run_par_byte_size);
+	encode_pars(model_pars.data(), par_sec.data());
+	buf_stream.write(par_sec.data(), par_sec.size());
 	//add flag for double buffering
 	std::int8_t buf_status = 0;
 	int end_of_runs = get_nruns();
@@ -263,7 +423,9 @@ streamoff RunStorage::get_stream_pos(int run_id)
 	buf_stream.write(reinterpret_cast<char*>(&r_status), sizeof(r_status));
 	buf_stream.write(reinterpret_cast<char*>(info_txt_buf.data()), sizeof(char)*info_txt_buf.size());
 	buf_stream.write(reinterpret_cast<char*>(&info_value), sizeof(double));
-	buf_stream.write(reinterpret_cast<const char*>(&model_pars(0)), model_pars.size()*sizeof(model_pars(0)));
+	vector<char> par_sec(run_par_byte_size);
+	encode_pars(model_pars.data(), par_sec.data());
+	buf_stream.write(par_sec.data(), par_sec.size());
 	//add flag for double buffering
 	std::int8_t buf_status = 0;
 	int end_of_runs = get_nruns();
@@ -274,6 +436,54 @@ streamoff RunStorage::get_stream_pos(int run_id)
  }
 
 
+vector<int> RunStorage::add_runs(const Eigen::MatrixXd &model_pars_mat, const vector<string> &info_txt_vec,
+	const vector<double> &info_value_vec)
+{
+	//add one run for each column of model_pars_mat - the columns are contiguous
+	assert((size_t)model_pars_mat.rows() == par_names.size());
+	assert(info_txt_vec.size() == (size_t)model_pars_mat.cols());
+	assert(info_value_vec.size() == (size_t)model_pars_mat.cols());
+	return add_runs(model_pars_mat.data(), model_pars_mat.cols(), info_txt_vec, info_value_vec);
+}
+
+vector<int> RunStorage::add_runs(const double *model_pars, int n_add, const vector<string> &info_txt_vec,
+	const vector<double> &info_value_vec)
+{
+	//all the records are assembled in memory and written with a single write so the run ids are consecutive
+	vector<int> run_ids;
+	if (n_add <= 0)
+		return run_ids;
+	if ((!info_txt_vec.empty() && info_txt_vec.size() != (size_t)n_add) || (!info_value_vec.empty() && info_value_vec.size() != (size_t)n_add))
+		throw PestIndexError("RunStorage::add_runs: info_txt_vec and info_value_vec must be empty or hold one entry per run");
+	size_t n_par = par_names.size();
+	int first_run_id = increment_nruns(n_add) - n_add;
+	vector<char> buf(run_byte_size * n_add, '\0');
+	for (int i = 0; i < n_add; ++i)
+	{
+		char *rec = buf.data() + run_byte_size * i;
+		std::int8_t r_status = 0;
+		memcpy(rec, &r_status, sizeof(r_status));
+		rec += sizeof(r_status);
+		if (!info_txt_vec.empty())
+			copy_n(info_txt_vec[i].begin(), min(info_txt_vec[i].size(), size_t(info_txt_length) - 1), rec);
+		rec += info_txt_length * sizeof(char);
+		double info_value = info_value_vec.empty() ? no_data : info_value_vec[i];
+		memcpy(rec, &info_value, sizeof(double));
+		rec += sizeof(double);
+		encode_pars(model_pars + n_par * i, rec);
+		run_ids.push_back(first_run_id + i);
+	}
+	buf_stream.seekp(get_stream_pos(first_run_id), ios_base::beg);
+	buf_stream.write(buf.data(), buf.size());
+	//add flag for double buffering
+	std::int8_t buf_status = 0;
+	int end_of_runs = get_nruns();
+	buf_stream.seekp(get_stream_pos(end_of_runs), ios_base::beg);
+	buf_stream.write(reinterpret_cast<char*>(&buf_status), sizeof(buf_status));
+	buf_stream.flush();
+	return run_ids;
+}
+
 int RunStorage::add_run(const Parameters &pars, const string &info_txt, double info_value)
 {
 	vector<double> data(pars.get_data_vec(par_names));
@@ -308,18 +518,63 @@ void RunStorage::copy(const RunStorage &rhs_rs)
 	beg_run0 = rhs_rs.beg_run0;
 	run_byte_size = rhs_rs.run_byte_size;
 	run_par_byte_size = rhs_rs.run_par_byte_size;
-	run_data_byte_size = rhs_rs.run_par_byte_size;
+	run_data_byte_size = rhs_rs.run_data_byte_size;
 	par_names = rhs_rs.par_names;
 	obs_names = rhs_rs.obs_names;
+
+	sparse_pars = rhs_rs.sparse_pars;
+	base_offset = rhs_rs.base_offset;
+	base_pars = rhs_rs.base_pars;
+	if (par_stream.is_open())
+	{
+		par_stream.close();
+	}
+	par_filename = filename + ".pdat";
+	if (sparse_pars)
+	{
+		open_par_stream(true);
+		//streaming an empty buffer sets failbit on par_stream, so only copy once rhs has stored some parameters
+		if (rhs_rs.par_stream_end > 0)
+		{
+			std::streampos rhs_par_pos = rhs_rs.par_stream.tellg();
+			rhs_rs.par_stream.seekg(0, ios_base::beg);
+			par_stream << rhs_rs.par_stream.rdbuf();
+			par_stream.flush();
+			par_stream.clear();
+			rhs_rs.par_stream.clear();
+			rhs_rs.par_stream.seekg(rhs_par_pos);
+		}
+		par_stream_end = rhs_rs.par_stream_end;
+	}
 }
 
 void RunStorage::update_run(int run_id, const Parameters &pars, const Observations &obs)
+{
+	update_run(run_id, pars.get_data_vec(par_names), obs.get_data_vec(obs_names));
+}
+
+void RunStorage::update_run(int run_id, const vector<double> &par_data, const vector<double> &obs_data)
 {
 	//set run status flage to complete
 	std::int8_t r_status = 1;
 	check_rec_id(run_id);
-	vector<double> par_data(pars.get_data_vec(par_names));
-	vector<double> obs_data(obs.get_data_vec(obs_names));
+	assert(par_data.size() == par_names.size());
+	assert(obs_data.size() == obs_names.size());
+	vector<char> par_sec(run_par_byte_size);
+	if (sparse_pars)
+	{
+		//keep the stored reference if the parameters came back unchanged
+		vector<double> old_pars(par_names.size());
+		buf_stream.seekg(get_stream_pos(run_id) + sizeof(r_status) + sizeof(char)*info_txt_length + sizeof(double), ios_base::beg);
+		buf_stream.read(par_sec.data(), par_sec.size());
+		decode_pars(par_sec.data(), old_pars.data());
+		if (memcmp(old_pars.data(), par_data.data(), old_pars.size() * sizeof(double)) != 0)
+			encode_pars(par_data.data(), par_sec.data());
+	}
+	else
+	{
+		encode_pars(par_data.data(), par_sec.data());
+	}
 	//write data to buffer at end of file and set buffer flag to 1
 	std::int8_t buf_status = 0;
 	std::int32_t buf_run_id = run_id;
@@ -328,8 +583,8 @@ void RunStorage::update_run(int run_id, const Parameters &pars, const Observatio
 	buf_stream.write(reinterpret_cast<char*>(&buf_status), sizeof(buf_status));
 	buf_stream.write(reinterpret_cast<char*>(&buf_run_id), sizeof(buf_run_id));
 	buf_stream.write(reinterpret_cast<char*>(&r_status), sizeof(r_status));
-	buf_stream.write(reinterpret_cast<char*>(par_data.data()), par_data.size() * sizeof(double));
-	buf_stream.write(reinterpret_cast<char*>(obs_data.data()), obs_data.size() * sizeof(double));
+	buf_stream.write(par_sec.data(), par_sec.size());
+	buf_stream.write(reinterpret_cast<const char*>(obs_data.data()), obs_data.size() * sizeof(double));
 	buf_status = 1;
 	buf_stream.seekp(get_stream_pos(end_of_runs), ios_base::beg);
 	buf_stream.write(reinterpret_cast<char*>(&buf_status), sizeof(buf_status));
@@ -339,8 +594,8 @@ void RunStorage::update_run(int run_id, const Parameters &pars, const Observatio
 	buf_stream.write(reinterpret_cast<char*>(&r_status), sizeof(r_status));
 	//skip over info_txt and info_value fields
 	buf_stream.seekp(sizeof(char)*info_txt_length+sizeof(double), ios_base::cur);
-	buf_stream.write(reinterpret_cast<char*>(par_data.data()), par_data.size() * sizeof(double));
-	buf_stream.write(reinterpret_cast<char*>(obs_data.data()), obs_data.size() * sizeof(double));
+	buf_stream.write(par_sec.data(), par_sec.size());
+	buf_stream.write(reinterpret_cast<const char*>(obs_data.data()), obs_data.size() * sizeof(double));
 	buf_stream.flush();
 	//reset flag for buffer at end of file to 0 to signal it is no longer relavent
 	buf_status = 0;
@@ -356,7 +611,6 @@ void RunStorage::update_run(int run_id, const Observations &obs)
 	std::int8_t r_status = 1;
 	check_rec_id(run_id);
 	vector<double> obs_data(obs.get_data_vec(obs_names));
-	size_t n_pars = par_names.size();
 
 	//write data to buffer at end of file and set buffer flag to 1
 	std::int8_t buf_status = 0;
@@ -367,8 +621,8 @@ void RunStorage::update_run(int run_id, const Observations &obs)
 	buf_stream.write(reinterpret_cast<char*>(&buf_run_id), sizeof(buf_run_id));
 	buf_stream.write(reinterpret_cast<char*>(&r_status), sizeof(r_status));
 	//skip over parameter section
-	buf_stream.seekp(n_pars * sizeof(double), ios_base::cur);
-	buf_stream.write(reinterpret_cast<char*>(obs_data.data()), obs_data.size() * sizeof(double));
+	buf_stream.seekp(run_par_byte_size, ios_base::cur);
+	buf_stream.write(reinterpret_cast<const char*>(obs_data.data()), obs_data.size() * sizeof(double));
 	buf_status = 1;
 	buf_stream.seekp(get_stream_pos(end_of_runs), ios_base::beg);
 	buf_stream.write(reinterpret_cast<char*>(&buf_status), sizeof(buf_status));
@@ -380,8 +634,8 @@ void RunStorage::update_run(int run_id, const Observations &obs)
 	//skip over info_txt and info_value fields
 	buf_stream.seekp(sizeof(char)*info_txt_length + sizeof(double), ios_base::cur);
 	//skip over parameter section
-	buf_stream.seekp(n_pars * sizeof(double), ios_base::cur);
-	buf_stream.write(reinterpret_cast<char*>(obs_data.data()), obs_data.size() * sizeof(double));
+	buf_stream.seekp(run_par_byte_size, ios_base::cur);
+	buf_stream.write(reinterpret_cast<const char*>(obs_data.data()), obs_data.size() * sizeof(double));
 	buf_stream.flush();
 	//reset flag for buffer at end of file to 0 to signal it is no longer relavent
 	buf_status = 0;
@@ -396,6 +650,13 @@ void RunStorage::update_run(int run_id, const vector<char> serial_data)
 	std::int8_t r_status = 1;
 	check_rec_size(serial_data);
 	check_rec_id(run_id);
+	if (sparse_pars)
+	{
+		const double *data = reinterpret_cast<const double*>(serial_data.data());
+		size_t n_par = par_names.size();
+		update_run(run_id, vector<double>(data, data + n_par), vector<double>(data + n_par, data + n_par + obs_names.size()));
+		return;
+	}
 	//write data to buffer at end of file and set buffer flag to 2
 	std::int8_t buf_status = 0;
 	std::int32_t buf_run_id = run_id;
@@ -518,20 +779,18 @@ int RunStorage::get_run(int run_id, double *pars, size_t npars, double *obs, siz
 	assert(npars == p_size);
 	assert(nobs == o_size);
 
-	if (npars != npars) {
+	if (npars != p_size) {
 		throw(PestIndexError("RunStorage::get_run: parameter dimension in incorrect"));
 	}
-	if (nobs != nobs) {
+	if (nobs != o_size) {
 		throw(PestIndexError("RunStorage::get_run: observation dimension in incorrect"));
 	}
 
-	p_size = min(p_size, npars);
-	o_size = min(o_size, nobs);
 	buf_stream.seekg(get_stream_pos(run_id), ios_base::beg);
 	buf_stream.read(reinterpret_cast<char*>(&r_status), sizeof(r_status));
 	buf_stream.read(reinterpret_cast<char*>(&info_txt_buf[0]), sizeof(char)*info_txt_length);
 	buf_stream.read(reinterpret_cast<char*>(&info_value), sizeof(double));
-	buf_stream.read(reinterpret_cast<char*>(pars), p_size * sizeof(double));
+	read_pars(pars);
 	buf_stream.read(reinterpret_cast<char*>(obs), o_size * sizeof(double));
 	int status = r_status;
 	info_txt = info_txt_buf.data();
@@ -556,7 +815,7 @@ int RunStorage::get_run(int run_id, vector<double> &pars_vec, vector<double> &ob
 	buf_stream.read(reinterpret_cast<char*>(&r_status), sizeof(r_status));
 	buf_stream.read(reinterpret_cast<char*>(&info_txt_buf[0]), sizeof(char)*info_txt_length);
 	buf_stream.read(reinterpret_cast<char*>(&info_value), sizeof(double));
-	buf_stream.read(reinterpret_cast<char*>(&pars_vec[0]), n_par * sizeof(double));
+	read_pars(pars_vec.data());
 	buf_stream.read(reinterpret_cast<char*>(&obs_vec[0]), n_obs * sizeof(double));
 	int status = r_status;
 	info_txt = info_txt_buf.data();
@@ -583,13 +842,53 @@ vector<char> RunStorage::get_serial_pars(int run_id)
 	std::int8_t r_status;
 
 	vector<char> serial_data;
-	serial_data.resize(run_par_byte_size);
+	serial_data.resize(par_names.size() * sizeof(double));
 	buf_stream.seekg(get_stream_pos(run_id), ios_base::beg);
 	buf_stream.seekg(sizeof(r_status)+sizeof(char)*info_txt_length+sizeof(double), ios_base::cur);
-	buf_stream.read(serial_data.data(), serial_data.size());
+	read_pars(reinterpret_cast<double*>(serial_data.data()));
 	return serial_data;
 }
 
+void RunStorage::get_runs(const int *run_ids, int n_runs, double *pars, double *obs, int *status)
+{
+	size_t n_par = par_names.size();
+	size_t n_obs = obs_names.size();
+	streamoff data_offset = sizeof(std::int8_t) + info_txt_length * sizeof(char) + sizeof(double);
+	vector<char> buf;
+	int i = 0;
+	while (i < n_runs)
+	{
+		//find the stretch of consecutive run ids starting at i
+		int n_block = 1;
+		while ((i + n_block < n_runs) && (run_ids[i + n_block] == run_ids[i] + n_block))
+			++n_block;
+		if (run_ids[i] < 0)
+			throw PestIndexError("RunStorage::get_runs: negative run id");
+		check_rec_id(run_ids[i] + n_block - 1);
+		buf.resize(run_byte_size * n_block);
+		buf_stream.seekg(get_stream_pos(run_ids[i]), ios_base::beg);
+		buf_stream.read(buf.data(), buf.size());
+		for (int j = 0; j < n_block; ++j, ++i)
+		{
+			const char *rec = buf.data() + run_byte_size * j;
+			std::int8_t r_status;
+			memcpy(&r_status, rec, sizeof(r_status));
+			if (status)
+				status[i] = r_status;
+			if (pars)
+				decode_pars(rec + data_offset, pars + n_par * i);
+			if (obs)
+				memcpy(obs + n_obs * i, rec + data_offset + run_par_byte_size, n_obs * sizeof(double));
+		}
+	}
+}
+
+void RunStorage::get_run_statuses(const int *run_ids, int n_runs, int *status)
+{
+	for (int i = 0; i < n_runs; ++i)
+		status[i] = get_run_status_native(run_ids[i]);
+}
+
 int  RunStorage::get_parameters(int run_id, Parameters &pars)
 {
 	std::int8_t r_status;
@@ -607,7 +906,7 @@ int  RunStorage::get_parameters(int run_id, Parameters &pars)
 	buf_stream.read(reinterpret_cast<char*>(&info_txt_buf[0]), sizeof(char)*info_txt_length);
 	buf_stream.read(reinterpret_cast<char*>(&info_value), sizeof(double));
 
-	buf_stream.read(reinterpret_cast<char*>(par_data.data()), n_par*sizeof(double));
+	read_pars(par_data.data());
 	pars.update(par_names, par_data);
 	int status = r_status;
 	return status;
@@ -623,7 +922,6 @@ int  RunStorage::get_observations(int run_id, Observations &obs)
 
 	check_rec_id(run_id);
 
-	size_t n_par = par_names.size();
 	size_t n_obs = obs_names.size();
 	vector<double> obs_data;
 	obs_data.resize(n_obs);
@@ -631,7 +929,7 @@ int  RunStorage::get_observations(int run_id, Observations &obs)
 	buf_stream.read(reinterpret_cast<char*>(&r_status), sizeof(r_status));
 	buf_stream.read(reinterpret_cast<char*>(&info_txt_buf[0]), sizeof(char)*info_txt_length);
 	buf_stream.read(reinterpret_cast<char*>(&info_value), sizeof(double));
-	buf_stream.seekg(n_par*sizeof(double), ios_base::cur);
+	buf_stream.seekg(run_par_byte_size, ios_base::cur);
 	buf_stream.read(reinterpret_cast<char*>(obs_data.data()), n_obs*sizeof(double));
 	int status = r_status;
 	obs.update(obs_names, obs_data);
@@ -648,14 +946,13 @@ int  RunStorage::get_observations_vec(int run_id, vector<double> &obs_data)
 
 	check_rec_id(run_id);
 
-	size_t n_par = par_names.size();
 	size_t n_obs = obs_names.size();
 	obs_data.resize(n_obs);
 	buf_stream.seekg(get_stream_pos(run_id), ios_base::beg);
 	buf_stream.read(reinterpret_cast<char*>(&r_status), sizeof(r_status));
 	buf_stream.read(reinterpret_cast<char*>(&info_txt_buf[0]), sizeof(char)*info_txt_length);
 	buf_stream.read(reinterpret_cast<char*>(&info_value), sizeof(double));
-	buf_stream.seekg(n_par*sizeof(double), ios_base::cur);
+	buf_stream.seekg(run_par_byte_size, ios_base::cur);
 	buf_stream.read(reinterpret_cast<char*>(obs_data.data()), n_obs*sizeof(double));
 	int status = r_status;
 	return status;
@@ -667,11 +964,15 @@ void RunStorage::free_memory()
 		buf_stream.close();
 		remove(filename.c_str());
 	}
+	if (par_stream.is_open()) {
+		par_stream.close();
+		remove(par_filename.c_str());
+	}
 }
 
 void RunStorage::check_rec_size(const vector<char> &serial_data) const
 {
-	if (serial_data.size() != run_data_byte_size)
+	if (serial_data.size() != (par_names.size() + obs_names.size()) * sizeof(double))
 	{
 		throw PestError("Error in RunStorage routine.  Size of serial data is different from what is expected");
 	}
@@ -34,6 +34,7 @@ class RunStorage {
 	// This class stores a sequence of model runs in a single binary file using the following format:
 	//     nruns (number of model runs stored in file)                       int_64_t
 	//     run_size (number of bytes required to store each model run)       int_64_t
+	//                   a negative run_size flags a file using sparse parameter storage (see set_sparse_pars)
 	//     par_name_vec_size (number of bytes required to store parameter names)  int_64_t
 	//     obes_name_vec_size (number of bytes required to store observation names)  int_64_t
 	//     parameter names (serialized parameter names)                               char*par_name_vec_size
@@ -49,6 +50,12 @@ class RunStorage {
 	//                   depends on the type of model run being stored  )
 	//       parameter_values  (parameters values for model runs)                     double*number of parameters
 	//       observationn_values( observations results produced by the model run)     double*number of observations
+	//
+	// With sparse parameter storage, parameter_values is replaced by a reference into the companion file
+	// <filename>.pdat.  Entries in that file are append only and are never rewritten:
+	//       full_offset (offset of a full parameter vector: double*number of parameters)    int_64_t
+	//       delta_offset (offset of the changed values or -1 if there are none)            int_64_t
+	//       n_delta (number of changed values: int_32_t*n_delta indices then double*n_delta values)  int_32_t
 
 public:
 	static const double no_data;
@@ -58,15 +65,27 @@ public:
 	virtual int add_run(const std::vector<double> &model_pars, const std::string &info_txt="", double info_value=no_data);
 	virtual int add_run(const Parameters &pars, const std::string &info_txt="", double info_value=no_data);
 	virtual int add_run(const Eigen::VectorXd &model_pars, const std::string &info_txt="", double info_value=no_data);
+	virtual std::vector<int> add_runs(const Eigen::MatrixXd &model_pars_mat, const std::vector<std::string> &info_txt_vec,
+		const std::vector<double> &info_value_vec);
+	//add n_add runs from consecutive blocks of par_name_vec.size() values, written with a single write.
+	//info_txt_vec and info_value_vec are either empty or hold one entry per run
+	std::vector<int> add_runs(const double *model_pars, int n_add, const std::vector<std::string> &info_txt_vec = std::vector<std::string>(),
+		const std::vector<double> &info_value_vec = std::vector<double>());
 	void copy(const RunStorage &rhs_rs);
+	//store parameters as changes relative to the last full parameter vector written.  Takes effect
+	//at the next reset(); init_restart() uses whatever the restart file was written with
+	void set_sparse_pars(bool _sparse_pars) { sparse_pars = _sparse_pars; }
+	bool get_sparse_pars() const { return sparse_pars; }
 	void update_run(int run_id, const Parameters &pars, const Observations &obs);
+	//par_data and obs_data must be in storage (par_name_vec/obs_name_vec) order
+	void update_run(int run_id, const std::vector<double> &par_data, const std::vector<double> &obs_data);
 	void update_run(int run_id, const Observations &obs);
 	void update_run(int run_id, const std::vector<char> serial_data);
 	void update_run_failed(int run_id);
 	void set_run_nfailed(int run_id, int nfail);
 	int get_nruns();
 	int get_num_good_runs();
-	int increment_nruns();
+	int increment_nruns(int n_add=1);
 	const std::vector<std::string>& get_par_name_vec()const;
 	const std::vector<std::string>& get_obs_name_vec()const;
 	int get_run_status(int run_id);
@@ -78,6 +97,10 @@ public:
 	int get_run(int run_id, std::vector<double> &pars_vec, std::vector<double> &obs_vec,
 		    std::string &info_txt, double &info_value);
 	int get_run(int run_id, std::vector<double> &pars_vec, std::vector<double> &obs_vec);
+	//read n_runs runs into consecutive blocks of pars and obs (either may be NULL) along with their run status.
+	//Each stretch of consecutive run ids is read with a single read
+	void get_runs(const int *run_ids, int n_runs, double *pars, double *obs, int *status);
+	void get_run_statuses(const int *run_ids, int n_runs, int *status);
 	int get_parameters(int run_id, Parameters &pars);
 	std::vector<char> get_serial_pars(int run_id);
 	int get_observations_vec(int run_id, std::vector<double> &data_vec);
@@ -89,8 +112,16 @@ public:
 	~RunStorage();
 private:
 	static const int info_txt_length = 41;
+	static const int par_ref_size = 2 * sizeof(std::int64_t) + sizeof(std::int32_t);
 	std::string filename;
 	mutable std::fstream buf_stream;
+	bool sparse_pars;
+	std::string par_filename;
+	mutable std::fstream par_stream;
+	std::int64_t par_stream_end;
+	//full parameter vector in par_stream that new runs are stored as changes against
+	std::int64_t base_offset;
+	std::vector<double> base_pars;
 	std::streamoff beg_run0;
 	std::streamoff run_byte_size;
 	std::streamoff run_par_byte_size;
@@ -101,6 +132,12 @@ private:
 	void check_rec_id(int run_id);
 	std::int8_t get_run_status_native(int run_id);
 	std::streamoff get_stream_pos(int run_id);
+	void open_par_stream(bool trunc);
+	//convert between a full parameter vector and the run_par_byte_size bytes stored in a run record
+	void encode_pars(const double *par_data, char *dest);
+	void decode_pars(const char *src, double *par_data);
+	//read the parameter section at the current buf_stream position
+	void read_pars(double *par_data);
 };
 
 #endif //RUN_STORAGE_H_
@@ -27,6 +27,7 @@
 class Transformable;
 class Parameters;
 class Observations;
+namespace pest_utils { struct RunUsage; }
 
 class Serialization
 {
@@ -37,6 +38,8 @@ public:
 	static std::vector<int8_t> serialize(const std::vector<Transformable*> &tr_vec);
 	static std::vector<int8_t> serialize(const Parameters &pars, const Observations &obs);
 	static std::vector<int8_t> serialize(const Parameters &pars, const std::vector<std::string> &par_names_vec, const Observations &obs, const std::vector<std::string> &obs_names_vec, double run_time);
+	//as above with the run's resource usage appended after the run time
+	static std::vector<int8_t> serialize(const Parameters &pars, const std::vector<std::string> &par_names_vec, const Observations &obs, const std::vector<std::string> &obs_names_vec, double run_time, const pest_utils::RunUsage &usage);
 	static std::vector<int8_t> serialize(const std::vector<std::string> &string_vec);
 	static std::vector<int8_t> serialize(const std::vector<std::vector<std::string> const*> &string_vec_vec);
 	static unsigned long unserialize(const std::vector<int8_t> &ser_data, int64_t &data, unsigned long start_loc = 0);
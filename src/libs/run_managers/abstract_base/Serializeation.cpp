@@ -147,6 +147,19 @@ vector<int8_t> Serialization::serialize(const Parameters &pars, const vector<str
 	return serial_data;
 }
 
+vector<int8_t> Serialization::serialize(const Parameters &pars, const vector<string> &par_names_vec, const Observations &obs, const vector<string> &obs_names_vec, double run_time, const pest_utils::RunUsage &usage)
+{
+	vector<int8_t> serial_data = serialize(pars, par_names_vec, obs, obs_names_vec, run_time);
+	if (!usage.collected)
+		return serial_data;
+	//a master that does not know about usage ignores anything past the run time
+	double usage_data[4] = { usage.cpu_sec, usage.max_rss_kb, usage.n_read_ops, usage.n_write_ops };
+	size_t n_bytes = serial_data.size();
+	serial_data.resize(n_bytes + sizeof(usage_data));
+	w_memcpy_s(&serial_data[n_bytes], sizeof(usage_data), usage_data, sizeof(usage_data));
+	return serial_data;
+}
+
 vector<int8_t> Serialization::serialize(const vector<string> &string_vec)
 {
 	vector<int8_t> serial_data;
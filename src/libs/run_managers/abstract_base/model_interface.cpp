@@ -10,7 +10,25 @@
 #include <sstream>
 #include <thread>
 #include <unordered_set>
+#include <cerrno>
+#include <cmath>
+#include <unordered_map>
+#include <algorithm>
+#include <cstdlib>
 #include "model_interface.h"
+#ifdef OS_LINUX
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#ifdef PESTPP_MODEL_PLUGIN
+#include <dlfcn.h>
+#endif
+#endif
+#ifdef OS_WIN
+#include <Windows.h>
+#endif
 
 using namespace std;
 
@@ -39,6 +57,39 @@ void ModelInterface::throw_mio_error(string base_message)
 
 
 
+void ModelInterface::set_work_dir(const string &_work_dir)
+{
+	work_dir = _work_dir;
+	templatefiles.clear();
+	instructionfiles.clear();
+	arrayfiles.clear();
+	if (work_dir.empty())
+		return;
+	for (auto file_vec : { &tplfile_vec, &inpfile_vec, &insfile_vec, &outfile_vec })
+	{
+		for (auto &file : *file_vec)
+		{
+			bool abs_path = (file.size() > 0) && ((file[0] == '/') || (file[0] == '\\') ||
+				((file.size() > 1) && (file[1] == ':')));
+			if (!abs_path)
+				file = work_dir + OperSys::DIR_SEP + file;
+		}
+	}
+}
+
+
+void ModelInterface::set_model_plugin(const string& lib_name)
+{
+	plugin = std::make_shared<ModelPlugin>(lib_name);
+}
+
+void ModelInterface::set_plugin_names(const vector<string>& par_names, const vector<string>& obs_names)
+{
+	if (!plugin)
+		throw_mio_error("set_plugin_names() called without a model plugin");
+	plugin->set_names(par_names, obs_names);
+}
+
 void ModelInterface::check_io_access()
 {
 	
@@ -84,6 +135,13 @@ void ModelInterface::check_tplins(const vector<string> &par_names, const vector<
 	unordered_set<string> ins_obs_names, file_obs_names;
 	for (auto ins_file : insfile_vec)
 	{
+		if (ArrayOutputFile::is_array_file(ins_file))
+		{
+			ArrayOutputFile af(ins_file);
+			file_obs_names = af.parse_and_check();
+			ins_obs_names.insert(file_obs_names.begin(), file_obs_names.end());
+			continue;
+		}
 		InstructionFile isf(ins_file);
 		file_obs_names = isf.parse_and_check();
 		ins_obs_names.insert(file_obs_names.begin(), file_obs_names.end());
@@ -154,6 +212,53 @@ void ModelInterface::check_tplins(const vector<string> &par_names, const vector<
 
 
 
+void ModelInterface::remove_model_files()
+{
+	//delete any existing input and output files
+	// This outer loop is a work around for a bug in windows.  Window can fail to release a file
+	// handle quick enough when the external run executes very quickly
+	bool failed_file_op = true;
+	int n_tries = 0;
+	while (failed_file_op)
+	{
+		vector<string> failed_file_vec;
+		failed_file_op = false;
+		for (auto &out_file : outfile_vec)
+		{
+			if ((pest_utils::check_exist_out(out_file)) && (remove(out_file.c_str()) != 0))
+			{
+				failed_file_vec.push_back(out_file);
+				failed_file_op = true;
+			}
+		}
+		for (auto &in_file : inpfile_vec)
+		{
+			if ((pest_utils::check_exist_out(in_file)) && (remove(in_file.c_str()) != 0))
+			{
+				failed_file_vec.push_back(in_file);
+				failed_file_op = true;
+			}
+		}
+		if (failed_file_op)
+		{
+			++n_tries;
+			w_sleep(1000);
+			if (n_tries > 5)
+			{
+				ostringstream str;
+				str << "model interface error: Cannot delete existing following model files:";
+				for (const string &ifile : failed_file_vec)
+				{
+					str << " " << ifile;
+				}
+				throw PestError(str.str());
+			}
+		}
+
+	}
+}
+
+
 void ModelInterface::run(Parameters* pars, Observations* obs)
 {
 
@@ -171,73 +276,83 @@ void ModelInterface::run(Parameters* pars, Observations* obs)
 }
 
 
+#ifdef OS_LINUX
+//usage of a reaped command and the descendants it waited for
+static pest_utils::RunUsage to_run_usage(const struct rusage &ru)
+{
+	pest_utils::RunUsage usage;
+	usage.collected = true;
+	usage.cpu_sec = ru.ru_utime.tv_sec + ru.ru_utime.tv_usec * 1.0e-6 + ru.ru_stime.tv_sec + ru.ru_stime.tv_usec * 1.0e-6;
+	//ru_maxrss is in kilobytes on linux but in bytes on mac
+#ifdef __APPLE__
+	usage.max_rss_kb = double(ru.ru_maxrss) / 1024.0;
+#else
+	usage.max_rss_kb = double(ru.ru_maxrss);
+#endif
+	usage.n_read_ops = double(ru.ru_inblock);
+	usage.n_write_ops = double(ru.ru_oublock);
+	return usage;
+}
+#endif
+
 void ModelInterface::run(pest_utils::thread_flag* terminate, pest_utils::thread_flag* finished, pest_utils::thread_exceptions *shared_execptions,
 						Parameters* pars, Observations* obs)
 {
+	if (plugin)
+	{
+		//no files or processes - the terminate flag cannot interrupt an in process call
+		run_usage = pest_utils::RunUsage();
+		try
+		{
+			plugin->run(*pars, *obs);
+			finished->set(true);
+		}
+		catch (...)
+		{
+			shared_execptions->add(current_exception());
+		}
+		return;
+	}
 
 	if (templatefiles.size() == 0)
 		for (auto t : tplfile_vec)
 		{
 			TemplateFile tt(t);
 			tt.set_fill_zeros(fill_tpl_zeros);
+			tt.set_cache_lines(cache_tplins);
 			templatefiles.push_back(tt);
 		}
 			
 
 	if (instructionfiles.size() == 0)
-		for (auto i : insfile_vec)
+		for (size_t i = 0; i < insfile_vec.size(); i++)
 		{
-			InstructionFile ii(i);
+			InstructionFile ii(insfile_vec[i]);
 			ii.set_additional_delimiters(additional_ins_delimiters);
+			ii.set_cache_instructions(cache_tplins);
 			instructionfiles.push_back(ii);
+			if (ArrayOutputFile::is_array_file(insfile_vec[i]))
+				arrayfiles.emplace(i, ArrayOutputFile(insfile_vec[i]));
 		}
 
-	Observations pro_obs;
+	run_usage = pest_utils::RunUsage();
+
 	vector<Parameters> pro_par_vec;
 	try
 	{
-		//first delete any existing input and output files
-		// This outer loop is a work around for a bug in windows.  Window can fail to release a file
-		// handle quick enough when the external run executes very quickly
-		bool failed_file_op = true;
-		int n_tries = 0;
-		while (failed_file_op)
+		vector<pest_utils::FileStamp> out_file_stamps;
+		if (atomic_io)
 		{
-			vector<string> failed_file_vec;
-			failed_file_op = false;
+			//backdate the output files and note what they look like now so stale ones can be told from
+			//fresh ones after the run
 			for (auto &out_file : outfile_vec)
 			{
-				if ((pest_utils::check_exist_out(out_file)) && (remove(out_file.c_str()) != 0))
-				{
-					failed_file_vec.push_back(out_file);
-					failed_file_op = true;
-				}
-			}
-			for (auto &in_file : inpfile_vec)
-			{
-				if ((pest_utils::check_exist_out(in_file)) && (remove(in_file.c_str()) != 0))
-				{
-					failed_file_vec.push_back(in_file);
-					failed_file_op = true;
-				}
-			}
-			if (failed_file_op)
-			{
-				++n_tries;
-				w_sleep(1000);
-				if (n_tries > 5)
-				{
-					ostringstream str;
-					str << "model interface error: Cannot delete existing following model files:";
-					for (const string &ifile : failed_file_vec)
-					{
-						str << " " << ifile;
-					}
-					throw PestError(str.str());
-				}
+				pest_utils::backdate_file(out_file);
+				out_file_stamps.push_back(pest_utils::get_file_stamp(out_file));
 			}
-
 		}
+		else
+			remove_model_files();
 		cout << "processing tpl files...";
 		vector<string> notnormal = pars->get_notnormal_keys();
 		if (notnormal.size() > 0)
@@ -248,7 +363,35 @@ void ModelInterface::run(pest_utils::thread_flag* terminate, pest_utils::thread_
 		{
 			string name = templatefiles[i].get_tpl_filename();
 			//cout << name << endl;
-			pro_par_vec.push_back(templatefiles[i].write_input_file(inpfile_vec[i], *pars));
+			if (atomic_io)
+			{
+				//the model never sees a missing or half written input file
+				string temp_file = inpfile_vec[i] + ".pestpp_tmp";
+				try
+				{
+					pro_par_vec.push_back(templatefiles[i].write_input_file(temp_file, *pars));
+				}
+				catch (...)
+				{
+					remove(temp_file.c_str());
+					throw;
+				}
+				int n_tries = 0;
+				while (!pest_utils::replace_file(temp_file, inpfile_vec[i]))
+				{
+					//windows can be slow to release a handle on a quickly run model's files
+					++n_tries;
+					if (n_tries > 5)
+					{
+						remove(temp_file.c_str());
+						throw PestError("model interface error: Cannot replace model input file " + inpfile_vec[i] +
+							" with " + temp_file);
+					}
+					w_sleep(1000);
+				}
+			}
+			else
+				pro_par_vec.push_back(templatefiles[i].write_input_file(inpfile_vec[i], *pars));
 		}
 		//update pars to account for possibly truncated par values...important for jco calcs
 		for (auto pro_pars : pro_par_vec)
@@ -273,7 +416,7 @@ void ModelInterface::run(pest_utils::thread_flag* terminate, pest_utils::thread_
 			PROCESS_INFORMATION pi;
 			try
 			{
-				pi = start(cmd_string);
+				pi = start(cmd_string, work_dir);
 			}
 			catch (...)
 			{
@@ -287,8 +430,8 @@ void ModelInterface::run(pest_utils::thread_flag* terminate, pest_utils::thread_
 			DWORD exitcode;
 			while (true)
 			{
-				//sleep
-				std::this_thread::sleep_for(std::chrono::milliseconds(OperSys::thread_sleep_milli_secs));
+				//returns as soon as the command exits
+				WaitForSingleObject(pi.hProcess, OperSys::thread_sleep_milli_secs);
 				//check if process is still active
 				GetExitCodeProcess(pi.hProcess, &exitcode);
 				//if the process ended, break
@@ -318,6 +461,24 @@ void ModelInterface::run(pest_utils::thread_flag* terminate, pest_utils::thread_
 			//jump out of the for loop if terminated
 			if (term_break) break;
 		}
+		if (!term_break)
+		{
+			//the job has accounted for every process the commands started
+			JOBOBJECT_BASIC_AND_IO_ACCOUNTING_INFORMATION jai = { 0 };
+			JOBOBJECT_EXTENDED_LIMIT_INFORMATION jli = { 0 };
+			if ((QueryInformationJobObject(job, JobObjectBasicAndIoAccountingInformation, &jai, sizeof(jai), NULL) != 0) &&
+				(QueryInformationJobObject(job, JobObjectExtendedLimitInformation, &jli, sizeof(jli), NULL) != 0))
+			{
+				pest_utils::RunUsage usage;
+				usage.collected = true;
+				//process times are in 100 ns ticks
+				usage.cpu_sec = (jai.BasicInfo.TotalUserTime.QuadPart + jai.BasicInfo.TotalKernelTime.QuadPart) * 1.0e-7;
+				usage.max_rss_kb = jli.PeakJobMemoryUsed / 1024.0;
+				usage.n_read_ops = double(jai.IoInfo.ReadOperationCount);
+				usage.n_write_ops = double(jai.IoInfo.WriteOperationCount);
+				run_usage.add(usage);
+			}
+		}
 
 
 #endif
@@ -325,43 +486,64 @@ void ModelInterface::run(pest_utils::thread_flag* terminate, pest_utils::thread_
 #ifdef OS_LINUX
 		//a flag to track if the run was terminated
 		bool term_break = false;
+		//readable once terminate is set, so the wait below can block until the command exits or the run is killed
+		int wake_fd = terminate->get_wake_fd();
 		for (auto &cmd_string : comline_vec)
 		{
 			//start the command
-			int command_pid = start(cmd_string);
+			int command_pid;
+			try
+			{
+				command_pid = start(cmd_string, work_dir);
+			}
+			catch (...)
+			{
+				finished->set(true);
+				throw;
+			}
+			int pid_fd = open_pid_fd(command_pid);
+			//without both descriptors fall back to checking every thread_sleep_milli_secs
+			int timeout = ((pid_fd >= 0) && (wake_fd >= 0)) ? -1 : OperSys::thread_sleep_milli_secs;
 			while (true)
 			{
-				//sleep
-				std::this_thread::sleep_for(std::chrono::milliseconds(OperSys::thread_sleep_milli_secs));
+				wait_pid_fd(pid_fd, wake_fd, timeout);
 				//check if process is still active
 				int status;
-				pid_t exit_code = waitpid(command_pid, &status, WNOHANG);
+				struct rusage usage;
+				pid_t exit_code = wait4(command_pid, &status, WNOHANG, &usage);
 				//if the process ended, break
 				if (exit_code == -1)
 				{
+					if (pid_fd >= 0) close(pid_fd);
 					finished->set(true);
 					throw std::runtime_error("waitpid() returned error status for command: " + cmd_string);
 				}
 				else if (exit_code != 0)
 				{
+					run_usage.add(to_run_usage(usage));
 					break;
 				}
 				//check for termination flag
 				if (terminate->get())
 				{
 					std::cout << "received terminate signal" << std::endl;
-					//try to kill the process
+					//kill the process group so commands started by the model go too
 					errno = 0;
 					int success = kill(-command_pid, SIGKILL);
 					if (success == -1)
 					{
+						if (pid_fd >= 0) close(pid_fd);
 						finished->set(true);
 						throw std::runtime_error("unable to terminate process for command: " + cmd_string);
 					}
+					//reap the command so it does not linger as a zombie
+					if (wait4(command_pid, &status, 0, &usage) == command_pid)
+						run_usage.add(to_run_usage(usage));
 					term_break = true;
 					break;
 				}
 			}
+			if (pid_fd >= 0) close(pid_fd);
 			//jump out of the for loop if terminated
 			if (term_break) break;
 		}
@@ -370,24 +552,27 @@ void ModelInterface::run(pest_utils::thread_flag* terminate, pest_utils::thread_
 		if (term_break) return;
 
 		
+		//a stale output would be read back as the result of this run
+		for (size_t i = 0; i < out_file_stamps.size(); i++)
+		{
+			if ((out_file_stamps[i].exists) && (pest_utils::get_file_stamp(outfile_vec[i]) == out_file_stamps[i]))
+				throw_mio_error("model output file '" + outfile_vec[i] + "' was not rewritten by the model");
+		}
 		cout << "processing ins files...";
 		Observations temp_obs;
 		for (int i = 0; i < instructionfiles.size(); i++)
 		{
-			pro_obs = instructionfiles[i].read_output_file(outfile_vec[i]);
-			temp_obs.update_without_clear(pro_obs.get_keys(), pro_obs.get_data_vec(pro_obs.get_keys()));
+			auto it_array = arrayfiles.find(i);
+			if (it_array != arrayfiles.end())
+				it_array->second.read_output_file(outfile_vec[i], temp_obs);
+			else
+				instructionfiles[i].read_output_file(outfile_vec[i], temp_obs);
 		}
-		unordered_set<string> ins_names, pst_names;
-		vector<string> t, diff;
-		t = obs->get_keys();
-		pst_names.insert(t.begin(), t.end());
-		t = temp_obs.get_keys();
-		ins_names.insert(t.begin(), t.end());
-		unordered_set<string>::iterator end = ins_names.end();
-		for (auto o : pst_names)
+		vector<string> diff;
+		for (auto &o : *obs)
 		{
-			if (ins_names.find(o) == end)
-				diff.push_back(o);
+			if (temp_obs.find(o.first) == temp_obs.end())
+				diff.push_back(o.first);
 		}
 		if (diff.size() > 0)
 		{
@@ -397,11 +582,10 @@ void ModelInterface::run(pest_utils::thread_flag* terminate, pest_utils::thread_
 				ss << d << ",";
 			throw_mio_error(ss.str());
 		}
-		end = pst_names.end();
-		for (auto o : ins_names)
+		for (auto &o : temp_obs)
 		{
-			if (pst_names.find(o) == end)
-				diff.push_back(o);
+			if (obs->find(o.first) == obs->end())
+				diff.push_back(o.first);
 		}
 		if (diff.size() > 0)
 		{
@@ -411,8 +595,8 @@ void ModelInterface::run(pest_utils::thread_flag* terminate, pest_utils::thread_
 				ss << d << ",";
 			throw_mio_error(ss.str());
 		}
-		t = temp_obs.get_keys();
-		obs->update(t, temp_obs.get_data_vec(t));
+		for (auto &o : temp_obs)
+			obs->find(o.first)->second = o.second;
 		cout << "done" << endl;
 
 		
@@ -429,6 +613,31 @@ void ModelInterface::run(pest_utils::thread_flag* terminate, pest_utils::thread_
 
 }
 
+//stod() without building a string: leading whitespace is skipped, trailing characters are ignored
+//and out of range values fail
+static bool parse_double(const char *beg, const char *end, double &value)
+{
+	char buf[64];
+	string long_str;
+	const char *str;
+	size_t len = end - beg;
+	if (len < sizeof(buf))
+	{
+		memcpy(buf, beg, len);
+		buf[len] = '\0';
+		str = buf;
+	}
+	else
+	{
+		long_str.assign(beg, end);
+		str = long_str.c_str();
+	}
+	char *str_end;
+	errno = 0;
+	value = strtod(str, &str_end);
+	return (str_end != str) && (errno != ERANGE);
+}
+
 unordered_set<string> TemplateFile::parse_and_check()
 {
 	ifstream f(tpl_filename);
@@ -439,86 +648,132 @@ unordered_set<string> TemplateFile::parse_and_check()
 
 Parameters TemplateFile::write_input_file(const string& input_filename, Parameters& pars)
 {
-	ifstream f_tpl(tpl_filename);
-	prep_tpl_file_for_reading(f_tpl);
+	if ((!cache_lines) || (compiled_image.size() == 0))
+		compile();
+	Parameters pro_pars;
+	pro_pars.reserve(compiled_names.size());
+	vector<double> name_vals(compiled_names.size());
+	for (size_t i = 0; i < compiled_names.size(); i++)
+	{
+		auto it = pars.find(compiled_names[i]);
+		if (it == pars.end())
+			throw_tpl_error("parameter '" + compiled_names[i] + "' not listed in control file");
+		name_vals[i] = it->second;
+	}
+	vector<bool> name_done(compiled_names.size(), false);
+	string val_str, name;
+	double val;
+	for (auto &slot : compiled_slots)
+	{
+		char *dest = &compiled_image[slot.offset];
+		if (!format_fixed_len(slot.width, name_vals[slot.name_idx], dest))
+		{
+			name = compiled_names[slot.name_idx];
+			val_str = cast_to_fixed_len_string(slot.width, name_vals[slot.name_idx], name);
+			memcpy(dest, val_str.data(), slot.width);
+		}
+		//the model sees the value as written, so that is the one reported back
+		if (!name_done[slot.name_idx])
+		{
+			if (!parse_double(dest, dest + slot.width, val))
+				throw_tpl_error("error casting '" + string(dest, slot.width) + "' back to double for parameter '" + compiled_names[slot.name_idx] + "'");
+			pro_pars.insert(compiled_names[slot.name_idx], val);
+			name_done[slot.name_idx] = true;
+		}
+	}
 	ofstream f_in(input_filename);
-	if (f_in.bad())
+	if (!f_in.good())
 		throw_tpl_error("couldn't open model input file '" + input_filename + "' for writing");
-	string line, val_str, name;
-	double val;
-	vector<pair<string, pair<int, int>>> tpl_line_map;
-	Parameters pro_pars;
-	vector<string> t = pars.get_keys();
-	unordered_set<string> pnames(t.begin(), t.end());
-	unordered_set<string>::iterator end = pnames.end();
-	t.resize(0);
+	//one write for the whole file.  A short write (a full disk say) must not be renamed into place
+	f_in.write(compiled_image.data(), compiled_image.size());
+	f_in.close();
+	if (f_in.fail())
+		throw_tpl_error("error writing model input file '" + input_filename + "'");
+	return pro_pars;
+}
+
+void TemplateFile::compile()
+{
+	line_num = 0;
+	compiled_image.clear();
+	compiled_slots.clear();
+	compiled_names.clear();
+	unordered_map<string, int> name_idx;
+	ifstream f_tpl(tpl_filename);
+	prep_tpl_file_for_reading(f_tpl);
+	string line;
+	TplSlot slot;
 	while (true)
 	{
 		if (f_tpl.eof())
 			break;
 		line = read_line(f_tpl);
-		
-		if (line.size() == 0)
-		{
-			if (f_tpl.eof())
-				break;
-			f_in << endl;
-			continue;
-		}
-		tpl_line_map = parse_tpl_line(line);
-		for (auto t : tpl_line_map)
+		if ((line.size() == 0) && (f_tpl.eof()))
+			break;
+		for (auto &t : parse_tpl_line(line))
 		{
-			name = t.first;
-			if (pnames.find(name) == end)
-				throw_tpl_error("parameter '" + name + "' not listed in control file");
-
-			/*val = 1.23456789123456789123456789E+100;
-			val_str = cast_to_fixed_len_string(200, val, name);
-			pest_utils::convert_ip(val_str, val);
-
-			val = 1.23456789123456789123456789E+100;
-			val_str = cast_to_fixed_len_string(8, val, name);
-			pest_utils::convert_ip(val_str, val);
-
-			val = 1.23456789123456789123456789E-100;
-			val_str = cast_to_fixed_len_string(8, val, name);
-			pest_utils::convert_ip(val_str, val);
-
-			val = -1.23456789123456789123456789E+100;
-			val_str = cast_to_fixed_len_string(9, val, name);
-			pest_utils::convert_ip(val_str, val);
-
-			val = -1.23456789123456789123456789E-100;
-			val_str = cast_to_fixed_len_string(9, val, name);
-			pest_utils::convert_ip(val_str, val);
-
-			val = 1.23456789123456789123456789E+10;
-			val_str = cast_to_fixed_len_string(7, val, name);
-			pest_utils::convert_ip(val_str, val);
-
-			val = 1.23456789123456789123456789E-10;
-			val_str = cast_to_fixed_len_string(7, val, name);
-			pest_utils::convert_ip(val_str, val);
-
-			val = 1.23456789123456789123456789;
-			val_str = cast_to_fixed_len_string(1, val, name);
-			pest_utils::convert_ip(val_str, val);
-
-			val = -1.23456789123456789123456789;
-			val_str = cast_to_fixed_len_string(2, val, name);
-			pest_utils::convert_ip(val_str, val);
-			*/
-
-			val = pars.get_rec(t.first);
-			val_str = cast_to_fixed_len_string(t.second.second, val, name);
-			line.replace(t.second.first, t.second.second, val_str);
-			//pest_utils::convert_ip(val_str, val);
-			val = stod(val_str);
-			pro_pars.insert(name, val);
+			auto it = name_idx.find(t.first);
+			if (it == name_idx.end())
+			{
+				it = name_idx.emplace(t.first, compiled_names.size()).first;
+				compiled_names.push_back(t.first);
+			}
+			slot.offset = compiled_image.size() + t.second.first;
+			slot.width = t.second.second;
+			slot.name_idx = it->second;
+			compiled_slots.push_back(slot);
 		}
-		f_in << line << endl;
+		compiled_image.append(line);
+		compiled_image.push_back('\n');
 	}
-	return pro_pars;
+}
+
+bool TemplateFile::format_fixed_len(int size, double value, char* dest)
+{
+	const int max_len = 256;
+	char buf[max_len];
+	if ((!isfinite(value)) || (size >= max_len - 8))
+		return false;
+	//same choices as cast_to_fixed_len_string
+	double abs_value = abs(value);
+	bool neg = value < 0;
+	bool sci = (abs_value >= 100) || (abs_value < 0.01);
+	int precision = neg ? size - 1 : size;
+	//chars other than the radix and the decimals
+	int other_len = neg ? 1 : 0;
+	if (sci)
+	{
+		//rounding can move the exponent to or from 3 digits, which the prediction below doesn't cover
+		if ((abs_value != 0.0) && ((abs_value >= 1.0e98) || (abs_value < 1.0e-98)))
+			return false;
+		precision = precision - 2;
+		other_len += 5; //the leading digit, "e+" and 2 exponent digits
+	}
+	else
+		other_len += (abs_value < 10) ? 1 : 2;
+	//the trial and error loop settles on the largest precision that fits
+	int p = min(precision, size - other_len - 1);
+	if (p < 1)
+		return false;
+	int len = snprintf(buf, max_len, sci ? "%.*e" : "%.*f", p, value);
+	//rounding added a digit - leave it to the loop
+	if (len != other_len + p + 1)
+		return false;
+	int n_pad = size - len;
+	if (!fill_zeros)
+	{
+		memset(dest, ' ', n_pad);
+		memcpy(dest + n_pad, buf, len);
+	}
+	else
+	{
+		//zeros go between the sign and the digits
+		int n_sign = (buf[0] == '-') ? 1 : 0;
+		memcpy(dest, buf, n_sign);
+		memset(dest + n_sign, '0', n_pad);
+		memcpy(dest + n_sign + n_pad, buf + n_sign, len - n_sign);
+	}
+	return true;
 }
 
 void TemplateFile::prep_tpl_file_for_reading(ifstream& f_tpl)
@@ -745,6 +1000,130 @@ string TemplateFile::read_line( ifstream& f_tpl)
 	return line;
 }
 
+//the model output file held in memory and walked line by line - the instructions move
+//a cursor along the current line instead of copying what is left of it
+class InsOutputFile
+{
+public:
+	InsOutputFile(const string& filename);
+	~InsOutputFile();
+	bool eof() const { return at_eof; }
+	//move to the next line and put the cursor at its start
+	void next_line();
+	string line() const { return string(line_beg, line_end); }
+	string rest() const { return string(cur, line_end); }
+	//the whole file, for binary output
+	const char* data() const { return buf_beg; }
+	int64_t size() const { return buf_end - buf_beg; }
+	const char *line_beg, *line_end, *cur;
+private:
+	const char *buf_beg, *buf_end, *next;
+	bool at_eof;
+#ifdef OS_LINUX
+	void *map_addr;
+	size_t map_len;
+#endif
+#ifdef OS_WIN
+	vector<char> contents;
+#endif
+};
+
+InsOutputFile::InsOutputFile(const string& filename) : line_beg(nullptr), line_end(nullptr), cur(nullptr),
+	buf_beg(nullptr), buf_end(nullptr), next(nullptr), at_eof(false)
+{
+#ifdef OS_LINUX
+	map_addr = nullptr;
+	map_len = 0;
+	int fd = open(filename.c_str(), O_RDONLY);
+	if (fd < 0)
+		throw runtime_error("can't open output file '" + filename + "' for reading");
+	struct stat st;
+	if (fstat(fd, &st) != 0)
+	{
+		close(fd);
+		throw runtime_error("can't stat output file '" + filename + "'");
+	}
+	map_len = st.st_size;
+	if (map_len > 0)
+	{
+		map_addr = mmap(nullptr, map_len, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (map_addr == MAP_FAILED)
+		{
+			close(fd);
+			map_addr = nullptr;
+			throw runtime_error("can't map output file '" + filename + "' into memory");
+		}
+		madvise(map_addr, map_len, MADV_SEQUENTIAL);
+	}
+	close(fd);
+	buf_beg = (const char*)map_addr;
+	next = buf_beg;
+	buf_end = buf_beg + map_len;
+#endif
+#ifdef OS_WIN
+	ifstream f_out(filename, ios::binary);
+	if (!f_out.good())
+		throw runtime_error("can't open output file '" + filename + "' for reading");
+	f_out.seekg(0, ios::end);
+	contents.resize(f_out.tellg());
+	f_out.seekg(0, ios::beg);
+	if (contents.size() > 0)
+		f_out.read(&contents[0], contents.size());
+	buf_beg = contents.data();
+	next = buf_beg;
+	buf_end = buf_beg + contents.size();
+#endif
+}
+
+InsOutputFile::~InsOutputFile()
+{
+#ifdef OS_LINUX
+	if (map_addr != nullptr)
+		munmap(map_addr, map_len);
+#endif
+}
+
+void InsOutputFile::next_line()
+{
+	//same lines getline() gives: a final line without a newline sets eof, as does reading past a trailing newline
+	line_beg = next;
+	const char *nl = (const char*)memchr(next, '\n', buf_end - next);
+	if (nl == nullptr)
+	{
+		line_end = buf_end;
+		next = buf_end;
+		at_eof = true;
+	}
+	else
+	{
+		line_end = nl;
+		next = nl + 1;
+	}
+#ifdef OS_WIN
+	//the file is read in binary mode, text mode would have dropped these
+	if ((line_end > line_beg) && (*(line_end - 1) == '\r'))
+		line_end--;
+#endif
+	cur = line_beg;
+}
+
+//first occurrence of [needle, needle + n) in [beg, end), or nullptr
+static const char* find_in_line(const char *beg, const char *end, const char *needle, size_t n)
+{
+	if (n == 0)
+		return beg;
+	while (end - beg >= (ptrdiff_t)n)
+	{
+		const char *p = (const char*)memchr(beg, needle[0], (end - beg) - n + 1);
+		if (p == nullptr)
+			return nullptr;
+		if (memcmp(p, needle, n) == 0)
+			return p;
+		beg = p + 1;
+	}
+	return nullptr;
+}
+
 string InstructionFile::read_ins_line(ifstream& f_ins)
 {
 	if (f_ins.bad())
@@ -760,22 +1139,18 @@ string InstructionFile::read_ins_line(ifstream& f_ins)
 }
 
 
-string InstructionFile::read_out_line(ifstream& f_out)
+void InstructionFile::read_out_line(InsOutputFile& f_out)
 {
-	if (f_out.bad())
-		throw_ins_error("cant read next output file line", ins_line_num, out_line_num);
-	string line;
 	if (f_out.eof())
 		throw_ins_error("unexpected output file eof ", ins_line_num, out_line_num);
-	getline(f_out, line);
-	last_out_line = line;
+	f_out.next_line();
 	out_line_num++;
-	return line;
 }
 
 
-InstructionFile::InstructionFile(string _ins_filename, string _addtitional_delimiters): ins_filename(_ins_filename), ins_line_num(0),
-out_line_num(0),last_ins_line(""),last_out_line(""), additional_delimiters(_addtitional_delimiters)
+InstructionFile::InstructionFile(string _ins_filename, string _addtitional_delimiters): ins_line_num(0), out_line_num(0),
+ins_filename(_ins_filename), last_ins_line(""), additional_delimiters(_addtitional_delimiters), cache_instructions(false),
+n_compiled_obs(0)
 {
 	obs_tags.push_back(pair<char, char>('(', ')'));
 	obs_tags.push_back(pair<char, char>('[', ']'));	
@@ -845,80 +1220,213 @@ void InstructionFile::prep_ins_file_for_reading(ifstream& f_ins)
 
 
 Observations InstructionFile::read_output_file(const string& output_filename)
+{
+	Observations obs;
+	read_output_file(output_filename, obs);
+	return obs;
+}
+
+void InstructionFile::read_output_file(const string& output_filename, Observations& obs)
 {
 	if (!pest_utils::check_exist_in(output_filename))
 		throw_ins_error("output file'" + output_filename + "' not found");
+	out_line_num = 0;
+	set_delim_tables();
+	if (cache_instructions)
+	{
+		if (compiled_ins.size() == 0)
+			compile();
+		obs.reserve(obs.size() + n_compiled_obs);
+		InsOutputFile f_out(output_filename);
+		for (size_t i = 0; i < compiled_ins.size(); i++)
+		{
+			//line 1 is the pif header
+			ins_line_num = i + 2;
+			last_ins_line = compiled_ins_lines[i];
+			execute_ins_line(compiled_ins[i], f_out, obs);
+		}
+		return;
+	}
+	ins_line_num = 0;
 	ifstream f_ins(ins_filename);
-	ifstream f_out(output_filename);
 	prep_ins_file_for_reading(f_ins);
-	if (f_out.bad())
+	InsOutputFile f_out(output_filename);
+	string ins_line;
+	unordered_set<string> seen_obs;
+	while (true)
 	{
-		throw_ins_error("can't open output file'" + output_filename + "' for reading");
+
+		if (f_ins.eof())
+			break;
+		ins_line = read_ins_line(f_ins);
+		vector<InsInstruction> ins_vec = compile_ins_line(tokenize_ins_line(ins_line));
+		drop_repeated_obs(ins_vec, seen_obs);
+		execute_ins_line(ins_vec, f_out, obs);
 	}
-	string ins_line, out_line;
-	vector<string> tokens;
-	Observations obs;
-	pair<string, double> lhs;
-	while (true)
+}
+
+void InstructionFile::drop_repeated_obs(vector<InsInstruction>& ins_line, unordered_set<string>& seen_obs)
+{
+	//the first reading of an obs named more than once in the file is the one kept, so later ones are read as dummies
+	for (auto& ins : ins_line)
 	{
+		if (((ins.type == InsInstruction::InsType::FIXED_OBS) || (ins.type == InsInstruction::InsType::SEMI_OBS) ||
+			(ins.type == InsInstruction::InsType::FREE_OBS)) && (ins.text != "DUM") && (!seen_obs.insert(ins.text).second))
+			ins.text = "DUM";
+	}
+}
 
+void InstructionFile::compile()
+{
+	ins_line_num = 0;
+	compiled_ins_lines.clear();
+	compiled_ins.clear();
+	n_compiled_obs = 0;
+	ifstream f_ins(ins_filename);
+	prep_ins_file_for_reading(f_ins);
+	string ins_line;
+	unordered_set<string> seen_obs;
+	while (true)
+	{
 		if (f_ins.eof())
 			break;
-		tokens.clear();
 		ins_line = read_ins_line(f_ins);
-		tokens = tokenize_ins_line(ins_line);
-		for (auto token : tokens)
+		compiled_ins.push_back(compile_ins_line(tokenize_ins_line(ins_line)));
+		drop_repeated_obs(compiled_ins.back(), seen_obs);
+		compiled_ins_lines.push_back(ins_line);
+		for (auto& ins : compiled_ins.back())
 		{
+			if (((ins.type == InsInstruction::InsType::FIXED_OBS) || (ins.type == InsInstruction::InsType::SEMI_OBS) ||
+				(ins.type == InsInstruction::InsType::FREE_OBS)) && (ins.text != "DUM"))
+				n_compiled_obs++;
+		}
+	}
+}
 
-			if (token[0] == 'L')
-			{
-				execute_line_advance(token, out_line, f_out);
-			}
-			else if (token[0] == 'W')
-			{
-				execute_whitespace(token, out_line, f_out);
-			}
-			else if (token[0] == '[')
-			{
-				lhs = execute_fixed(token, out_line, f_out);
-				if (lhs.first != "DUM")
-					obs.insert(lhs.first,lhs.second);
-			}
-			else if (token[0] == '!')
-			{
-				lhs = execute_free(token, out_line, f_out);
-				if (lhs.first != "DUM")
-					obs.insert(lhs.first, lhs.second);
-			}
-			else if (token[0] == '(')
+void InstructionFile::set_delim_tables()
+{
+	memset(free_delims, 0, sizeof(free_delims));
+	memset(ws_delims, 0, sizeof(ws_delims));
+	memset(default_delims, 0, sizeof(default_delims));
+	//include the comma for csv files
+	for (unsigned char c : ", \t\n\r" + additional_delimiters)
+		free_delims[c] = true;
+	for (unsigned char c : " \t" + additional_delimiters)
+		ws_delims[c] = true;
+	for (unsigned char c : string(" \t\n\r"))
+		default_delims[c] = true;
+}
+
+vector<InsInstruction> InstructionFile::compile_ins_line(const vector<string>& tokens)
+{
+	vector<InsInstruction> ins_line;
+	pair<string, pair<int, int>> info;
+	for (auto& token : tokens)
+	{
+		InsInstruction ins;
+		ins.token = token;
+		ins.num = 0;
+		ins.s = 0;
+		ins.e = 0;
+		if (token[0] == 'L')
+		{
+			ins.type = InsInstruction::InsType::LINE_ADVANCE;
+			//pest_utils::convert_ip(token.substr(1), num);
+			ins.num = stoi(token.substr(1));
+		}
+		else if (token[0] == 'W')
+		{
+			ins.type = InsInstruction::InsType::WHITESPACE;
+		}
+		else if (token[0] == '[')
+		{
+			ins.type = InsInstruction::InsType::FIXED_OBS;
+			info = parse_obs_instruction(token, "]");
+			ins.text = info.first;
+			ins.s = info.second.first;
+			ins.e = info.second.second;
+		}
+		else if (token[0] == '!')
+		{
+			ins.type = InsInstruction::InsType::FREE_OBS;
+			ins.text = token.substr(1, token.size() - 2);
+		}
+		else if (token[0] == '(')
+		{
+			ins.type = InsInstruction::InsType::SEMI_OBS;
+			info = parse_obs_instruction(token, ")");
+			ins.text = info.first;
+			ins.s = info.second.first;
+			ins.e = info.second.second;
+		}
+		else if (token[0] == marker)
+		{
+			if (token.size() == 1)
 			{
-				lhs = execute_semi(token, out_line, f_out);
-				if (lhs.first != "DUM")
-					obs.insert(lhs.first, lhs.second);
+				throw_ins_error("markers with spaces not supported...", ins_line_num);
 			}
-			else if (token[0] == marker)
+			//if this is the first instruction, its a primary search
+			if (token == tokens[0])
 			{
-				if (token.size() == 1)
-				{
-					throw_ins_error("markers with spaces not supported...", ins_line_num);
-				}
-				//if this is the first instruction, its a primary search
-				if (token == tokens[0])
-				{
-					execute_primary(token, out_line, f_out);
-				}
-				else
-				{
-					execute_secondary(token, out_line, f_out);
-				}
+				//check that a closing marker is found
+				//this shouldnt be a prob,but good to check
+				if (token.substr(token.size() - 1, 1) != string(1, marker))
+					throw_ins_error("primary marker token '" + token + "' doesn't have a closing marker char", ins_line_num);
+				ins.type = InsInstruction::InsType::PRIMARY_MARKER;
 			}
 			else
 			{
-				throw_ins_error("unrecognized instruction '" + token + "'", ins_line_num);
+				if (token.substr(token.size() - 1, 1) != string(1, marker))
+					throw_ins_error("secondary marker token '" + token + "' doesnt have a closing marker char");
+				ins.type = InsInstruction::InsType::SECONDARY_MARKER;
 			}
+			ins.text = token.substr(1, token.size() - 2);
+		}
+		else
+		{
+			throw_ins_error("unrecognized instruction '" + token + "'", ins_line_num);
+		}
+		ins_line.push_back(ins);
+	}
+	return ins_line;
+}
+
+void InstructionFile::execute_ins_line(const vector<InsInstruction>& ins_line, InsOutputFile& f_out, Observations& obs)
+{
+	double value;
+	for (auto& ins : ins_line)
+	{
+		switch (ins.type)
+		{
+		case InsInstruction::InsType::LINE_ADVANCE:
+			execute_line_advance(ins, f_out);
+			break;
+		case InsInstruction::InsType::WHITESPACE:
+			execute_whitespace(ins, f_out);
+			break;
+		case InsInstruction::InsType::FIXED_OBS:
+			value = execute_fixed(ins, f_out);
+			if (ins.text != "DUM")
+				obs[ins.text] = value;
+			break;
+		case InsInstruction::InsType::FREE_OBS:
+			value = execute_free(ins, f_out);
+			if (ins.text != "DUM")
+				obs[ins.text] = value;
+			break;
+		case InsInstruction::InsType::SEMI_OBS:
+			value = execute_semi(ins, f_out);
+			if (ins.text != "DUM")
+				obs[ins.text] = value;
+			break;
+		case InsInstruction::InsType::PRIMARY_MARKER:
+			execute_primary(ins, f_out);
+			break;
+		case InsInstruction::InsType::SECONDARY_MARKER:
+			execute_secondary(ins, f_out);
+			break;
 		}
 	}
-	return obs;	
 }
 
 
@@ -1052,189 +1560,408 @@ pair<string, pair<int, int>> InstructionFile::parse_obs_instruction(const string
 	return pair<string, pair<int, int>>(name,se);
 }
 
-pair<string, double> InstructionFile::execute_fixed(const string& token, string& line, ifstream& f_out)
+double InstructionFile::execute_fixed(const InsInstruction& ins, InsOutputFile& f_out)
 {
-	string temp;
 	double value;
-	pair<string, pair<int, int>> info = parse_obs_instruction(token, "]");
-	//use the raw last_out_line since "line" has been getting progressively truncated
-	if (last_out_line.size() < info.second.second)
+	int s = ins.s, e = ins.e;
+	//use the whole output line since the cursor has been moving along it
+	int line_len = f_out.line_end - f_out.line_beg;
+	if (line_len < e)
 	{
 		//throw_ins_error("output line not long enough for fixed obs instruction '" + token + "',");
-		info.second.second = last_out_line.size();
-	}
-	int len = (info.second.second - info.second.first) + 1;
-	temp = last_out_line.substr(info.second.first, len);
-	try
-	{
-		//pest_utils::convert_ip(temp, value);
-		value = stod(temp);
+		e = line_len;
 	}
-	catch (...)
+	if (s > line_len)
+		throw_ins_error("output line '" + f_out.line() + "' not long enough for fixed obs instruction '" + ins.token + "'", ins_line_num, out_line_num);
+	int len = (e - s) + 1;
+	if ((len < 0) || (len > line_len - s))
+		len = line_len - s;
+	const char *t_beg = f_out.line_beg + s;
+	const char *t_end = t_beg + len;
+	if (!parse_double(t_beg, t_end, value))
 	{
-		throw_ins_error("error casting fixed observation '" + token + "' from output string '" + temp + "'");
+		throw_ins_error("error casting fixed observation '" + ins.token + "' from output string '" + string(t_beg, t_end) + "'");
 	}
-	int pos = line.find(temp);
-	if (pos == string::npos)
-		throw_ins_error("internal error: string t: '"+temp+"' not found in line: '"+line+"'",ins_line_num,out_line_num);
-	line = line.substr(pos + temp.size());
-	return pair<string, double>(info.first,value);
+	const char *pos = find_in_line(f_out.cur, f_out.line_end, t_beg, len);
+	if (pos == nullptr)
+		throw_ins_error("internal error: string t: '" + string(t_beg, t_end) + "' not found in line: '" + f_out.rest() + "'", ins_line_num, out_line_num);
+	f_out.cur = pos + len;
+	return value;
 }
 
-pair<string, double> InstructionFile::execute_semi(const string& token, string& line, ifstream& f_out)
+double InstructionFile::execute_semi(const InsInstruction& ins, InsOutputFile& f_out)
 {
-	string temp;
-	vector<string> tokens;
 	double value;
-	pair<string, pair<int, int>> info = parse_obs_instruction(token, ")");
-	//use the raw last_out_line since "line" has been getting progressively truncated
-	if (last_out_line.size() < info.second.second)
+	int e = ins.e;
+	//use the whole output line since the cursor has been moving along it
+	int line_len = f_out.line_end - f_out.line_beg;
+	if (line_len < e)
 	{
 		//throw_ins_error("output line not long enough for semi-fixed obs instruction '" + token + "',");
-		info.second.second = last_out_line.size();
-	}
-
-	int len = (info.second.second - info.second.first) + 1;
-	int pos = last_out_line.find_first_not_of(", \t\n\r"+additional_delimiters, info.second.first); //include the comma here for csv files
-	if (pos == string::npos)
-		throw_ins_error("EOL encountered when looking for non-whitespace char in semi-fixed instruction '" + token + "'",ins_line_num,out_line_num);
-	if (pos > info.second.second)
-		throw_ins_error("no non-whitespace char found before end index in semi-fixed instruction '" + token + "'", ins_line_num,out_line_num);
-	pest_utils::tokenize(last_out_line.substr(pos), tokens);
-	temp = tokens[0];
-	try
-	{
-		//pest_utils::convert_ip(temp, value);
-		value = stod(temp);
+		e = line_len;
 	}
-	catch (...)
+	const char *t_beg = f_out.line_beg + ins.s;
+	if (ins.s >= line_len)
+		t_beg = f_out.line_end;
+	while ((t_beg < f_out.line_end) && (free_delims[(unsigned char)*t_beg]))
+		t_beg++;
+	if (t_beg == f_out.line_end)
+		throw_ins_error("EOL encountered when looking for non-whitespace char in semi-fixed instruction '" + ins.token + "'",ins_line_num,out_line_num);
+	if (t_beg - f_out.line_beg > e)
+		throw_ins_error("no non-whitespace char found before end index in semi-fixed instruction '" + ins.token + "'", ins_line_num,out_line_num);
+	const char *t_end = t_beg;
+	while ((t_end < f_out.line_end) && (!default_delims[(unsigned char)*t_end]))
+		t_end++;
+	if (!parse_double(t_beg, t_end, value))
 	{
-		throw_ins_error("error casting string '" + temp + "' to double for semi-fixed instruction", ins_line_num, out_line_num);
+		throw_ins_error("error casting string '" + string(t_beg, t_end) + "' to double for semi-fixed instruction", ins_line_num, out_line_num);
 	}
-	pos = line.find(temp);
-	if (pos == string::npos)
-		throw_ins_error("internal error: temp '" + temp + "' not found in line: '" + line + "'", ins_line_num, out_line_num);
-	line = line.substr(pos + temp.size());
-	return pair<string, double>(info.first,value);
+	const char *pos = find_in_line(f_out.cur, f_out.line_end, t_beg, t_end - t_beg);
+	if (pos == nullptr)
+		throw_ins_error("internal error: temp '" + string(t_beg, t_end) + "' not found in line: '" + f_out.rest() + "'", ins_line_num, out_line_num);
+	f_out.cur = pos + (t_end - t_beg);
+	return value;
 }
 
-pair<string, double> InstructionFile::execute_free(const string& token, string& line, ifstream& f_out)
+double InstructionFile::execute_free(const InsInstruction& ins, InsOutputFile& f_out)
 {
-	vector<string> tokens;
-	pest_utils::tokenize(line, tokens,", \t\n\r" + additional_delimiters) ; //include the comma in the delimiters here
-	if (tokens.size() == 0)
-		throw_ins_error("error tokenizing output line ('"+last_out_line+"') for instruction '"+token+"' on line: " +last_ins_line, ins_line_num, out_line_num);
+	const char *t_beg = f_out.cur;
+	while ((t_beg < f_out.line_end) && (free_delims[(unsigned char)*t_beg]))
+		t_beg++;
+	if (t_beg == f_out.line_end)
+		throw_ins_error("error tokenizing output line ('"+f_out.line()+"') for instruction '"+ins.token+"' on line: " +last_ins_line, ins_line_num, out_line_num);
+	const char *t_end = t_beg;
+	while ((t_end < f_out.line_end) && (!free_delims[(unsigned char)*t_end]))
+		t_end++;
 	double value;
-	try
-	{
-		//pest_utils::convert_ip(tokens[0], value);
-		value = stod(tokens[0]);
-	}
-	catch (...)
-	{
-		throw_ins_error("error converting '" + tokens[0] + "' to double on output line '" + last_out_line + "' for instruciton '"+token+"'", ins_line_num, out_line_num);
-	}
-	string name = token.substr(1, token.size() - 2);
-	int pos = line.find(tokens[0]);
-	if (pos == string::npos)
+	if (!parse_double(t_beg, t_end, value))
 	{
-		throw_ins_error("internal error: could not find free obs token '"+tokens[0]+"'", ins_line_num, out_line_num);
+		throw_ins_error("error converting '" + string(t_beg, t_end) + "' to double on output line '" + f_out.line() + "' for instruciton '"+ins.token+"'", ins_line_num, out_line_num);
 	}
-	line = line.substr(pos + tokens[0].size());
-
-	return pair<string, double>(name,value);
+	f_out.cur = t_end;
+	return value;
 }
 
-void InstructionFile::execute_primary(const string& token, string& line, ifstream& f_out)
+void InstructionFile::execute_primary(const InsInstruction& ins, InsOutputFile& f_out)
 {
-	//check that a closing marker is found
-	//this shouldnt be a prob,but good to check
-	if (token.substr(token.size()-1,1) != string(1,marker))
-		throw_ins_error("primary marker token '" + token + "' doesn't have a closing marker char", ins_line_num);
-	int pos;
-	string primary_tag = token.substr(1, token.size() - 2);
+	const char *pos;
 	while (true)
 	{
 		if (f_out.eof())
-			throw_ins_error("EOF encountered while executing marker search ('" + token + "')", ins_line_num, out_line_num);
-		line = read_out_line(f_out);
-		pos = line.find(primary_tag);
-		if (pos != string::npos)
+			throw_ins_error("EOF encountered while executing marker search ('" + ins.token + "')", ins_line_num, out_line_num);
+		read_out_line(f_out);
+		pos = find_in_line(f_out.line_beg, f_out.line_end, ins.text.c_str(), ins.text.size());
+		if (pos != nullptr)
 		{
 			break;
 		}
 	}
-	pos = pos + primary_tag.size();
-	line = line.substr(pos);
+	f_out.cur = pos + ins.text.size();
 	return;
 }
 
 
-void InstructionFile::execute_secondary(const string& token, string& line, ifstream& f_out)
+void InstructionFile::execute_secondary(const InsInstruction& ins, InsOutputFile& f_out)
 {
-	//check that a closing marker is found
-	int pos;
-	if (token.substr(token.size()-1,1) != string(1,marker))
-		throw_ins_error("secondary marker token '" + token + "' doesnt have a closing marker char");
-	string secondary_tag = token.substr(1, token.size()-2);
-	pos = line.find(secondary_tag);
-	if (pos == string::npos)
+	const char *pos = find_in_line(f_out.cur, f_out.line_end, ins.text.c_str(), ins.text.size());
+	if (pos == nullptr)
 	{
-		throw_ins_error("EOL encountered while executing secondary marker ('" + secondary_tag + "') search on output line", ins_line_num,out_line_num);
+		throw_ins_error("EOL encountered while executing secondary marker ('" + ins.text + "') search on output line", ins_line_num,out_line_num);
 	}
-	line = line.substr(pos + secondary_tag.size());
+	f_out.cur = pos + ins.text.size();
 	return;
 }
 
 
-void InstructionFile::execute_whitespace(const string& token, string& line, ifstream& f_out)
+void InstructionFile::execute_whitespace(const InsInstruction& ins, InsOutputFile& f_out)
 {
-	string delims = " \t" + additional_delimiters;
-
-	int pos = line.find_first_not_of(delims);
-	if (pos == string::npos)
+	const char *pos = f_out.cur;
+	while ((pos < f_out.line_end) && (ws_delims[(unsigned char)*pos]))
+		pos++;
+	if (pos == f_out.line_end)
 	{
 		throw_ins_error("EOL encountered while executing whitespace instruction on output line", ins_line_num, out_line_num);
 	}
 	//if the cursor is already on a non-delim char, we need to read past that and then apply
 	//the search
-	if (pos == 0)
+	if (pos == f_out.cur)
 	{
-		vector<string> tokens;
-		pest_utils::tokenize(line, tokens, delims);
-		pos = line.find(tokens[0]);
-		if (pos == string::npos)
-		{
-			throw_ins_error("internal error in execute_whitespace: couldnt find first token");
-		}
-		line = line.substr(pos + tokens[0].size());
-		pos = line.find_first_not_of(delims);
-		if (pos == string::npos)
+		while ((pos < f_out.line_end) && (!ws_delims[(unsigned char)*pos]))
+			pos++;
+		while ((pos < f_out.line_end) && (ws_delims[(unsigned char)*pos]))
+			pos++;
+		if (pos == f_out.line_end)
 		{
 			throw_ins_error("EOL encountered while executing whitespace instruction on output line", ins_line_num, out_line_num);
 		}
 	}
 	//place the "cursor" on the first char not in delims
-	line = line.substr(pos);
+	f_out.cur = pos;
+}
+
+
+void InstructionFile::execute_line_advance(const InsInstruction& ins, InsOutputFile& f_out)
+{
+	for (int i = 0; i < ins.num; i++)
+	{
+		if (f_out.eof())
+		{
+			throw_ins_error("EOF encountered when executing line advance instruction", ins_line_num, out_line_num);
+		}
+		read_out_line(f_out);
+	}
+}
+
+
+bool ArrayOutputFile::is_array_file(const string& filename)
+{
+	ifstream f(filename);
+	string tag;
+	f >> tag;
+	return pest_utils::upper_cp(tag) == "PAF";
+}
+
+ModelPlugin::ModelPlugin(const string& _lib_name) : lib_name(_lib_name), handle(NULL), init_func(NULL), run_func(NULL)
+{
+#ifdef OS_WIN
+	handle = (void*)LoadLibraryA(lib_name.c_str());
+	if (handle == NULL)
+	{
+		stringstream ss;
+		ss << "unable to load library, error code " << GetLastError();
+		throw_plugin_error(ss.str());
+	}
+#endif
+#ifdef OS_LINUX
+#ifdef PESTPP_MODEL_PLUGIN
+	//a name without a path is searched for on the library path, so make it relative to the run directory
+	string path = lib_name;
+	if (path.find('/') == string::npos)
+		path = "./" + path;
+	handle = dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL);
+	if (handle == NULL)
+		throw_plugin_error(string("unable to load library: ") + dlerror());
+#else
+	throw_plugin_error("this build does not support model plugins - rebuild with STATIC=no to use ++model_plugin");
+#endif
+#endif
+	init_func = (InitFunc)get_symbol("pestpp_model_init");
+	run_func = (RunFunc)get_symbol("pestpp_model_run");
+}
+
+ModelPlugin::~ModelPlugin()
+{
+	if (handle == NULL)
+		return;
+#ifdef OS_WIN
+	FreeLibrary((HMODULE)handle);
+#endif
+#if defined(OS_LINUX) && defined(PESTPP_MODEL_PLUGIN)
+	dlclose(handle);
+#endif
+}
+
+void* ModelPlugin::get_symbol(const string& name)
+{
+	void* sym = NULL;
+#ifdef OS_WIN
+	sym = (void*)GetProcAddress((HMODULE)handle, name.c_str());
+#endif
+#if defined(OS_LINUX) && defined(PESTPP_MODEL_PLUGIN)
+	sym = dlsym(handle, name.c_str());
+#endif
+	if (sym == NULL)
+		throw_plugin_error("library does not export '" + name + "'");
+	return sym;
+}
+
+void ModelPlugin::set_names(const vector<string>& _par_names, const vector<string>& _obs_names)
+{
+	if ((_par_names == par_names) && (_obs_names == obs_names))
+		return;
+	vector<const char*> par_ptrs, obs_ptrs;
+	par_ptrs.reserve(_par_names.size());
+	for (auto& name : _par_names)
+		par_ptrs.push_back(name.c_str());
+	obs_ptrs.reserve(_obs_names.size());
+	for (auto& name : _obs_names)
+		obs_ptrs.push_back(name.c_str());
+	int err = init_func(par_ptrs.size(), par_ptrs.data(), obs_ptrs.size(), obs_ptrs.data());
+	if (err != 0)
+		throw_plugin_error("pestpp_model_init() returned " + to_string(err));
+	par_names = _par_names;
+	obs_names = _obs_names;
+}
+
+void ModelPlugin::run(const double* pars, double* obs)
+{
+	int err = run_func(pars, par_names.size(), obs, obs_names.size());
+	if (err != 0)
+		throw_plugin_error("pestpp_model_run() returned " + to_string(err));
+}
+
+void ModelPlugin::run(const Parameters& pars, Observations& obs)
+{
+	if (par_names.empty() && obs_names.empty())
+		throw_plugin_error("par and obs names have not been set");
+	vector<double> par_vec = pars.get_data_vec(par_names);
+	vector<double> obs_vec(obs_names.size(), Observations::no_data);
+	run(par_vec.data(), obs_vec.data());
+	obs.update_without_clear(obs_names, obs_vec);
 }
 
+void ModelPlugin::throw_plugin_error(const string& message)
+{
+	throw runtime_error("ModelPlugin error in library " + lib_name + " : " + message);
+}
 
-void InstructionFile::execute_line_advance(const string& token, string& line, ifstream& f_out)
+void ArrayOutputFile::throw_array_error(const string& message, int lnum)
 {
 	stringstream ss;
-	int num;
-	//pest_utils::convert_ip(token.substr(1), num);
-	num = stoi(token.substr(1));
-	for (int i = 0; i < num; i++)
-	{
-		if (f_out.bad())
-		{	
-			throw_ins_error("'bad' stream when executing line advance instruction", ins_line_num, out_line_num);
+	ss << "ArrayOutputFile error in file " << array_filename;
+	if (lnum != 0)
+		ss << " on line: " << lnum;
+	ss << " : " << message;
+	throw runtime_error(ss.str());
+}
+
+unordered_set<string> ArrayOutputFile::parse_and_check()
+{
+	compile();
+	unordered_set<string> names;
+	for (auto& loc : obs_locs)
+	{
+		if (names.find(loc.name) != names.end())
+			throw_array_error("observation '" + loc.name + "' listed multiple times");
+		names.emplace(loc.name);
+	}
+	return names;
+}
+
+void ArrayOutputFile::compile()
+{
+	obs_locs.clear();
+	ifstream f_array(array_filename);
+	if (!f_array.good())
+		throw_array_error("couldn't open array file for reading");
+	string line;
+	vector<string> tokens;
+	int lnum = 1;
+	getline(f_array, line);
+	pest_utils::tokenize(pest_utils::upper_cp(line), tokens);
+	if ((tokens.size() < 2) || (tokens.size() > 3) || (tokens[0] != "PAF"))
+		throw_array_error("incorrect first line - expecting 'paf <binary|csv> [header size]'", lnum);
+	if (tokens[1] == "BINARY")
+		format = ArrayFormat::BINARY;
+	else if (tokens[1] == "CSV")
+		format = ArrayFormat::CSV;
+	else
+		throw_array_error("unrecognized array format '" + tokens[1] + "', expecting 'binary' or 'csv'", lnum);
+	n_header = 0;
+	if (tokens.size() == 3)
+	{
+		try
+		{
+			pest_utils::convert_ip(tokens[2], n_header);
+		}
+		catch (...)
+		{
+			throw_array_error("error casting header size '" + tokens[2] + "'", lnum);
+		}
+		if (n_header < 0)
+			throw_array_error("header size can't be negative", lnum);
+	}
+	ArrayObsLoc loc;
+	int64_t position;
+	while (getline(f_array, line))
+	{
+		lnum++;
+		tokens.clear();
+		pest_utils::tokenize(pest_utils::upper_cp(line), tokens);
+		if (tokens.size() == 0)
+			continue;
+		loc.name = tokens[0];
+		loc.col = 0;
+		if (tokens.size() != ((format == ArrayFormat::BINARY) ? 2 : 3))
+			throw_array_error("wrong number of entries - expecting 'obsname position' for binary or 'obsname row column' for csv", lnum);
+		try
+		{
+			pest_utils::convert_ip(tokens[1], position);
+			if (format == ArrayFormat::BINARY)
+				loc.pos = n_header + (position - 1) * sizeof(double);
+			else
+			{
+				loc.pos = position - 1;
+				pest_utils::convert_ip(tokens[2], loc.col);
+				loc.col--;
+			}
+		}
+		catch (...)
+		{
+			throw_array_error("error casting location of observation '" + loc.name + "'", lnum);
+		}
+		if ((position < 1) || (loc.col < 0))
+			throw_array_error("locations of observation '" + loc.name + "' should start at 1", lnum);
+		obs_locs.push_back(loc);
+	}
+	//read the output file front to back
+	sort(obs_locs.begin(), obs_locs.end(), [](const ArrayObsLoc& a, const ArrayObsLoc& b)
+		{ return (a.pos < b.pos) || ((a.pos == b.pos) && (a.col < b.col)); });
+}
+
+void ArrayOutputFile::read_output_file(const string& output_filename, Observations& obs)
+{
+	if (!pest_utils::check_exist_in(output_filename))
+		throw_array_error("output file'" + output_filename + "' not found");
+	if (obs_locs.size() == 0)
+		compile();
+	obs.reserve(obs.size() + obs_locs.size());
+	InsOutputFile f_out(output_filename);
+	double value;
+	if (format == ArrayFormat::BINARY)
+	{
+		for (auto& loc : obs_locs)
+		{
+			if (loc.pos + (int64_t)sizeof(double) > f_out.size())
+				throw_array_error("output file '" + output_filename + "' too short for observation '" + loc.name + "'");
+			memcpy(&value, f_out.data() + loc.pos, sizeof(double));
+			obs[loc.name] = value;
 		}
+		return;
+	}
+	for (int i = 0; i < n_header; i++)
+	{
 		if (f_out.eof())
+			throw_array_error("EOF encountered while skipping header lines of output file '" + output_filename + "'");
+		f_out.next_line();
+	}
+	int64_t row = -1;
+	int col = 0;
+	for (auto& loc : obs_locs)
+	{
+		while (row < loc.pos)
 		{
-			throw_ins_error("EOF encountered when executing line advance instruction", ins_line_num, out_line_num);
+			if (f_out.eof())
+				throw_array_error("EOF encountered in output file '" + output_filename + "' looking for observation '" + loc.name + "'");
+			f_out.next_line();
+			row++;
+			col = 0;
+		}
+		while (col < loc.col)
+		{
+			const char *comma = (const char*)memchr(f_out.cur, ',', f_out.line_end - f_out.cur);
+			if (comma == nullptr)
+				throw_array_error("output file '" + output_filename + "' row " + to_string(row + 1) +
+					" doesn't have enough columns for observation '" + loc.name + "'");
+			f_out.cur = comma + 1;
+			col++;
 		}
-		line = read_out_line(f_out);
+		const char *field_end = (const char*)memchr(f_out.cur, ',', f_out.line_end - f_out.cur);
+		if (field_end == nullptr)
+			field_end = f_out.line_end;
+		if (!parse_double(f_out.cur, field_end, value))
+			throw_array_error("error converting '" + string(f_out.cur, field_end) + "' to double for observation '" +
+				loc.name + "' in output file '" + output_filename + "'");
+		obs[loc.name] = value;
 	}
 }
@@ -4,6 +4,8 @@
 #include <vector>
 #include <string>
 #include <unordered_set>
+#include <map>
+#include <memory>
 #include "Transformable.h"
 #include "utilities.h"
 #include "Pest.h"
@@ -14,11 +16,13 @@ class TemplateFile {
 public:
 	static vector<int> find_all_marker_indices(const string& line, const string& marker);
 	TemplateFile(string _tpl_filename, bool _fill_zeros=false): tpl_filename(_tpl_filename),line_num(0),
-	fill_zeros(_fill_zeros){ ; }
+	fill_zeros(_fill_zeros), cache_lines(false){ ; }
 	unordered_set<string> parse_and_check();
 	Parameters write_input_file(const string& input_filename, Parameters& pars);
 	void throw_tpl_error(const string& message, int lnum=0, bool warn=false);
 	void set_fill_zeros(bool _flag) { fill_zeros = _flag; }
+	//keep the parsed template in memory so it is only read from disk once
+	void set_cache_lines(bool _flag) { cache_lines = _flag; }
 	string get_tpl_filename() { return tpl_filename; }
 private:
 	int line_num;
@@ -29,7 +33,22 @@ private:
 	string read_line(ifstream& f_tpl);
 	void prep_tpl_file_for_reading(ifstream& f_tpl);
 	unordered_set<string> get_names(ifstream& f);
+	void compile();
+	//format value into exactly size chars at dest the way cast_to_fixed_len_string would, with a single
+	//snprintf. Returns false when that can't be done without cast_to_fixed_len_string's trial and error
+	bool format_fixed_len(int size, double value, char* dest);
 	bool fill_zeros;
+	bool cache_lines;
+	//a parameter's place in the input file
+	struct TplSlot {
+		size_t offset;
+		int width;
+		int name_idx;
+	};
+	//the input file as last written - only the slots change from one run to the next
+	string compiled_image;
+	vector<TplSlot> compiled_slots;
+	vector<string> compiled_names;
 	
 	
 
@@ -37,44 +56,133 @@ private:
 };
 
 
+class InsOutputFile;
+
+//one instruction file token, parsed once and executed against each output file
+class InsInstruction {
+public:
+	enum class InsType { LINE_ADVANCE, WHITESPACE, FIXED_OBS, SEMI_OBS, FREE_OBS, PRIMARY_MARKER, SECONDARY_MARKER };
+	InsType type;
+	string token;
+	//obs name or marker search string
+	string text;
+	//number of lines to advance or the 0-based column range of a (semi-)fixed obs
+	int num, s, e;
+};
+
 class InstructionFile {
 	
 public:
 	InstructionFile(string _ins_filename, string _additional_delimiters="");
 	unordered_set<string> parse_and_check();
 	Observations read_output_file(const string& output_filename);
+	//add the output file's obs to obs, replacing values already there.  An obs read more than once from the
+	//file keeps its first value
+	void read_output_file(const string& output_filename, Observations& obs);
 	void set_additional_delimiters(string delims) { additional_delimiters = delims; }
+	//keep the tokenized instructions in memory so they are only read from disk once
+	void set_cache_instructions(bool _flag) { cache_instructions = _flag; }
 private:
 	int ins_line_num, out_line_num;
 	char marker;
-	string ins_filename, last_out_line, last_ins_line;
+	string ins_filename, last_ins_line;
 	vector<pair<char, char>> obs_tags;
-	pair<string, double> execute_fixed(const string& token, string& line, ifstream& f_out);
-	pair<string, double> execute_semi(const string& token, string& line, ifstream& f_out);
-	pair<string, double> execute_free(const string& token, string& line, ifstream& f_out);
-	void execute_primary(const string& token, string& line, ifstream& f_out);
-	void execute_secondary(const string& token, string& line, ifstream& f_out);
-	void execute_whitespace(const string& token, string& line, ifstream& f_out);
-	void execute_line_advance(const string& token, string& line, ifstream& f_out);
+	//lookup tables for the delimiters used by free, whitespace and semi-fixed instructions
+	bool free_delims[256], ws_delims[256], default_delims[256];
+	void set_delim_tables();
+	double execute_fixed(const InsInstruction& ins, InsOutputFile& f_out);
+	double execute_semi(const InsInstruction& ins, InsOutputFile& f_out);
+	double execute_free(const InsInstruction& ins, InsOutputFile& f_out);
+	void execute_primary(const InsInstruction& ins, InsOutputFile& f_out);
+	void execute_secondary(const InsInstruction& ins, InsOutputFile& f_out);
+	void execute_whitespace(const InsInstruction& ins, InsOutputFile& f_out);
+	void execute_line_advance(const InsInstruction& ins, InsOutputFile& f_out);
 	void prep_ins_file_for_reading(ifstream& f_ins);
 	string read_ins_line(ifstream& f_ins);
-	string read_out_line(ifstream& f_out);
+	void read_out_line(InsOutputFile& f_out);
 	void throw_ins_error(const string& message, int ins_lnum = 0, int out_lnum=0, bool warn = false);
 	string parse_obs_name_from_token(const string& token);
 	vector<string> tokenize_ins_line(const string& line);
 	pair<string, pair<int, int>> parse_obs_instruction(const string& token, const string& close_tag);
 	string additional_delimiters;
+	bool cache_instructions;
+	vector<string> compiled_ins_lines;
+	vector<vector<InsInstruction>> compiled_ins;
+	int n_compiled_obs;
+	void compile();
+	vector<InsInstruction> compile_ins_line(const vector<string>& tokens);
+	void execute_ins_line(const vector<InsInstruction>& ins_line, InsOutputFile& f_out, Observations& obs);
+	void drop_repeated_obs(vector<InsInstruction>& ins_line, unordered_set<string>& seen_obs);
+};
+
+//reads observations straight from a binary array or csv model output file, in place of an instruction file.
+//The file given in the instruction file slot starts with "paf binary [header bytes]" or "paf csv [header lines]",
+//followed by one "obsname position" (binary, 1-based double index after the header) or "obsname row column"
+//(csv, 1-based, rows counted after the header) line per observation
+class ArrayOutputFile {
+public:
+	enum class ArrayFormat { BINARY, CSV };
+	static bool is_array_file(const string& filename);
+	ArrayOutputFile(string _array_filename) : array_filename(_array_filename), format(ArrayFormat::BINARY), n_header(0) { ; }
+	unordered_set<string> parse_and_check();
+	//add the output file's obs to obs, replacing values already there
+	void read_output_file(const string& output_filename, Observations& obs);
+private:
+	struct ArrayObsLoc {
+		//byte offset in a binary file or 0-based row in a csv file
+		int64_t pos;
+		int col;
+		string name;
+	};
+	string array_filename;
+	ArrayFormat format;
+	int64_t n_header;
+	//sorted into file order so the output file is read front to back
+	vector<ArrayObsLoc> obs_locs;
+	void compile();
+	void throw_array_error(const string& message, int lnum = 0);
 };
 
+//a model built as a shared library and called in process, in place of the template files, model commands and
+//instruction files.  The library exports, with C linkage:
+//  int pestpp_model_init(int npar, const char* const* par_names, int nobs, const char* const* obs_names);
+//  int pestpp_model_run(const double* pars, int npar, double* obs, int nobs);
+//init gives the order of the par and obs arrays and is called before the first run and whenever the order changes.
+//Both return 0 on success.  With several local workers or agent slots, run is called from several threads at once
+//On linux and mac, plugins need a dynamically linked build (STATIC=no), which defines PESTPP_MODEL_PLUGIN
+class ModelPlugin {
+public:
+	ModelPlugin(const string& _lib_name);
+	~ModelPlugin();
+	ModelPlugin(const ModelPlugin&) = delete;
+	ModelPlugin& operator=(const ModelPlugin&) = delete;
+	const string& get_lib_name() const { return lib_name; }
+	void set_names(const vector<string>& _par_names, const vector<string>& _obs_names);
+	//pars and obs are in the order given to set_names()
+	void run(const double* pars, double* obs);
+	void run(const Parameters& pars, Observations& obs);
+private:
+	typedef int(*InitFunc)(int, const char* const*, int, const char* const*);
+	typedef int(*RunFunc)(const double*, int, double*, int);
+	string lib_name;
+	void* handle;
+	InitFunc init_func;
+	RunFunc run_func;
+	vector<string> par_names;
+	vector<string> obs_names;
+	void* get_symbol(const string& name);
+	void throw_plugin_error(const string& message);
+};
 
 class ModelInterface{
 public:
-	ModelInterface() { ; }
+	ModelInterface() : fill_tpl_zeros(false), cache_tplins(false), atomic_io(true) { ; }
 	//ModelInterface(Pest* _pest_scenario_ptr) { pest_scenario_ptr = _pest_scenario_ptr; }
 	ModelInterface(vector<string> _tplfile_vec, vector<string> _inpfile_vec, vector<string>
 		_insfile_vec, vector<string> _outfile_vec, vector<string> _comline_vec) :
 		insfile_vec(_insfile_vec), outfile_vec(_outfile_vec), tplfile_vec(_tplfile_vec),
-		inpfile_vec(_inpfile_vec), comline_vec(_comline_vec), fill_tpl_zeros(false), additional_ins_delimiters("") {;}
+		inpfile_vec(_inpfile_vec), comline_vec(_comline_vec), fill_tpl_zeros(false), additional_ins_delimiters(""),
+		cache_tplins(false), atomic_io(true) {;}
 	void throw_mio_error(string base_message);
 	void run(Parameters* pars, Observations* obs);
 	void run(pest_utils::thread_flag* terminate, pest_utils::thread_flag* finished,
@@ -84,11 +192,31 @@ public:
 	void check_tplins(const vector<string> &par_names, const vector<string> &obs_names);
 	void set_additional_ins_delimiters(string delims) { additional_ins_delimiters = delims; }
 	void set_fill_tpl_zeros(bool _flag) { fill_tpl_zeros = _flag; }
+	//parse tpl and ins files once and reuse them for every run
+	void set_cache_tplins(bool _flag) { cache_tplins = _flag; }
+	//write input files to a temp file and rename them into place, and check that the model rewrote its output
+	//files, instead of deleting all model files before each run
+	void set_atomic_io(bool _flag) { atomic_io = _flag; }
+	//run the model in another directory - relative model file names are taken relative to it
+	void set_work_dir(const string &_work_dir);
+	string get_work_dir() const { return work_dir; }
+	//cpu time, memory and i/o of the model commands of the last run
+	const pest_utils::RunUsage& get_run_usage() const { return run_usage; }
+	//call the model in a shared library instead of going through files and model commands.  Copies of this
+	//model interface share the loaded library
+	void set_model_plugin(const string& lib_name);
+	bool has_model_plugin() const { return bool(plugin); }
+	//the par and obs order passed to the plugin - required before the first run in plugin mode
+	void set_plugin_names(const vector<string>& par_names, const vector<string>& obs_names);
+	//plugin mode run straight from and to arrays in set_plugin_names() order
+	void run_plugin(const double* pars, double* obs) { plugin->run(pars, obs); }
 
 private:
 	//Pest* pest_scenario_ptr;
 	vector<TemplateFile> templatefiles;
 	vector<InstructionFile> instructionfiles;
+	//output files read with an array file instead of instructions, keyed by position in insfile_vec
+	map<int, ArrayOutputFile> arrayfiles;
 	vector<string> insfile_vec; 
 	vector<string> inpfile_vec; 
 	vector<string> outfile_vec; 
@@ -96,6 +224,12 @@ private:
 	vector<string> comline_vec; 
 	bool fill_tpl_zeros;
 	string additional_ins_delimiters;
+	bool cache_tplins;
+	bool atomic_io;
+	string work_dir;
+	pest_utils::RunUsage run_usage;
+	std::shared_ptr<ModelPlugin> plugin;
+	void remove_model_files();
 };
 
 #endif /* MODEL_INTERFACE_H_ */
@@ -0,0 +1,473 @@
+/*
+
+
+	This file is part of PEST++.
+
+	PEST++ is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	PEST++ is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with PEST++.  If not, see<http://www.gnu.org/licenses/>.
+*/
+#include "RunManagerLocal.h"
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <unordered_set>
+#include <cctype>
+#include <cerrno>
+#include "system_variables.h"
+#include "Transformable.h"
+#include "utilities.h"
+#include "model_interface.h"
+#ifdef OS_LINUX
+#include <sys/stat.h>
+#endif
+#ifdef OS_WIN
+#include <direct.h>
+#endif
+
+using namespace std;
+using namespace pest_utils;
+
+const string RunManagerLocal::WORKER_DIR_PREFIX = "local_worker_";
+const set<string> RunManagerLocal::MASTER_FILE_EXTS = { "rns", "rnj", "rnu", "rnr", "rmr", "rec", "rei", "res", "par",
+	"parb", "jco", "jcb", "jcs", "log", "rst", "svd", "sen", "isen", "ipar", "iobj", "fpr", "upg", "prev", "rtj", "rid",
+	"dbg", "mio", "msn", "mos", "bpa", "post", "phi", "pdat", "fosm_reweight" };
+
+RunManagerLocal::RunManagerLocal(const vector<string> _comline_vec,
+	const vector<string> _tplfile_vec, const vector<string> _inpfile_vec,
+	const vector<string> _insfile_vec, const vector<string> _outfile_vec,
+	const string &stor_filename, const string &_run_dir, int _n_workers, int _max_run_fail,
+	double _overdue_reched_fac, double _overdue_giveup_fac, double _overdue_giveup_minutes,
+	bool fill_tpl_zeros, string additional_ins_delimiters, bool atomic_model_io,
+	const string &model_plugin)
+	: RunManagerAbstract(_comline_vec, _tplfile_vec, _inpfile_vec,
+	_insfile_vec, _outfile_vec, stor_filename, _max_run_fail),
+	run_dir(_run_dir), n_workers(max(_n_workers, 1)), overdue_reched_fac(_overdue_reched_fac),
+	overdue_giveup_fac(_overdue_giveup_fac), overdue_giveup_minutes(_overdue_giveup_minutes),
+	mi(_tplfile_vec, _inpfile_vec, _insfile_vec, _outfile_vec, _comline_vec),
+	model_runs_done(0), model_runs_failed(0), model_runs_timed_out(0), n_timed_runs(0),
+	total_run_sec(0.0), n_done_signals(0)
+{
+	max_concurrent_runs = max(1, _max_run_fail);
+	mi.set_additional_ins_delimiters(additional_ins_delimiters);
+	mi.set_fill_tpl_zeros(fill_tpl_zeros);
+	mi.set_atomic_io(atomic_model_io);
+	if (!model_plugin.empty())
+		mi.set_model_plugin(model_plugin);
+
+	string stor_name = get_filename(stor_filename);
+	case_name = stor_name.substr(0, stor_name.find_last_of('.'));
+	cout << "              starting local run manager (" << n_workers << " workers) ..." << endl << endl;
+}
+
+bool RunManagerLocal::is_master_file(const string &name) const
+{
+	if (name.compare(0, WORKER_DIR_PREFIX.size(), WORKER_DIR_PREFIX) == 0)
+		return true;
+	if ((name.size() <= case_name.size() + 1) || (name.compare(0, case_name.size() + 1, case_name + ".") != 0))
+		return false;
+	string ext = lower_cp(name.substr(case_name.size() + 1));
+	//iteration numbered outputs, ie <case>.3.par or <case>.0.obs.csv
+	if (isdigit(ext[0]))
+		return true;
+	//the first part of the extension less any iteration number, so <case>.rei2 and <case>.rns.pdat count too
+	ext = ext.substr(0, ext.find('.'));
+	size_t n_alpha = ext.find_last_not_of("0123456789");
+	ext = ext.substr(0, n_alpha + 1);
+	return MASTER_FILE_EXTS.find(ext) != MASTER_FILE_EXTS.end();
+}
+
+void RunManagerLocal::init_workers()
+{
+	if (!workers.empty())
+		return;
+	for (int i = 0; i < n_workers; i++)
+	{
+		string worker_dir = run_dir + OperSys::DIR_SEP + WORKER_DIR_PREFIX + to_string(i);
+#ifdef OS_LINUX
+		bool created = (mkdir(worker_dir.c_str(), 0755) == 0);
+#endif
+#ifdef OS_WIN
+		bool created = (_mkdir(worker_dir.c_str()) == 0);
+#endif
+		if (created)
+			cout << "creating local worker directory " << worker_dir << endl;
+		else if (errno == EEXIST)
+			cout << "refreshing existing local worker directory " << worker_dir << endl;
+		else
+			throw PestError("unable to create local worker directory '" + worker_dir + "'");
+		//the model files, but not the master's run storage and outputs or other workers' directories.
+		//An existing directory is recopied too, so model files edited since the last run are picked up
+		copy_dir_contents(run_dir, worker_dir, [this](const string &name) { return is_master_file(name); });
+		workers.push_back(unique_ptr<LocalWorker>(new LocalWorker(mi)));
+		workers.back()->mi.set_work_dir(worker_dir);
+	}
+	cout << endl;
+}
+
+void RunManagerLocal::reinitialize(const std::string &_filename)
+{
+	free_memory();
+	RunManagerAbstract::reinitialize(_filename);
+}
+
+void RunManagerLocal::free_memory()
+{
+	kill_all_runs();
+	waiting_runs.clear();
+	submitted_runs.clear();
+	model_runs_done = 0;
+}
+
+int RunManagerLocal::add_run(const Parameters &model_pars, const string &info_txt, double info_value)
+{
+	int run_id = file_stor.add_run(model_pars, info_txt, info_value);
+	waiting_runs.push_back(run_id);
+	return run_id;
+}
+
+int RunManagerLocal::add_run(const std::vector<double> &model_pars, const string &info_txt, double info_value)
+{
+	int run_id = file_stor.add_run(model_pars, info_txt, info_value);
+	waiting_runs.push_back(run_id);
+	return run_id;
+}
+
+int RunManagerLocal::add_run(const Eigen::VectorXd &model_pars, const string &info_txt, double info_value)
+{
+	int run_id = file_stor.add_run(model_pars, info_txt, info_value);
+	waiting_runs.push_back(run_id);
+	return run_id;
+}
+
+vector<int> RunManagerLocal::add_runs(const Eigen::MatrixXd &model_pars_mat, const vector<string> &info_txt_vec,
+	const vector<double> &info_value_vec)
+{
+	vector<int> run_ids = file_stor.add_runs(model_pars_mat, info_txt_vec, info_value_vec);
+	waiting_runs.insert(waiting_runs.end(), run_ids.begin(), run_ids.end());
+	return run_ids;
+}
+
+vector<int> RunManagerLocal::add_runs(const double *model_pars, int n_runs)
+{
+	vector<int> run_ids = file_stor.add_runs(model_pars, n_runs);
+	waiting_runs.insert(waiting_runs.end(), run_ids.begin(), run_ids.end());
+	return run_ids;
+}
+
+void RunManagerLocal::update_run(int run_id, const Parameters &pars, const Observations &obs)
+{
+	file_stor.update_run(run_id, pars, obs);
+	waiting_runs.erase(remove(waiting_runs.begin(), waiting_runs.end(), run_id), waiting_runs.end());
+	kill_runs(run_id);
+}
+
+void RunManagerLocal::queue_outstanding_runs()
+{
+	//picks up runs from a restart file as well as failed runs that can be retried
+	unordered_set<int> queued(waiting_runs.begin(), waiting_runs.end());
+	for (auto &worker : workers)
+	{
+		if (worker->run)
+			queued.insert(worker->run->run_id);
+	}
+	for (int run_id : get_outstanding_run_ids())
+	{
+		if (queued.find(run_id) == queued.end())
+			waiting_runs.push_back(run_id);
+	}
+}
+
+void RunManagerLocal::run()
+{
+	run_until(RUN_UNTIL_COND::NORMAL);
+}
+
+RunManagerAbstract::RUN_UNTIL_COND RunManagerLocal::run_until(RUN_UNTIL_COND condition, int max_no_ops, double max_time_sec)
+{
+	RUN_UNTIL_COND terminate_reason = RUN_UNTIL_COND::NORMAL;
+	init_workers();
+	queue_outstanding_runs();
+	model_runs_done = 0;
+	model_runs_failed = 0;
+	model_runs_timed_out = 0;
+	int nruns = waiting_runs.size() + get_n_active();
+	cout << "    running model " << nruns << " times on " << n_workers << " local workers" << endl << endl;
+
+	stringstream message;
+	int n_no_ops = 0;
+	std::chrono::system_clock::time_point start_time = std::chrono::system_clock::now();
+	while ((!waiting_runs.empty()) || (get_n_active() > 0))
+	{
+		if (service(1.0) > 0)
+		{
+			n_no_ops = 0;
+			std::cout << string(message.str().size(), '\b');
+			message.str("");
+			message << "(" << model_runs_done << "/" << nruns << " runs complete";
+			if (model_runs_failed > 0)
+				message << ", " << model_runs_failed << " failed";
+			message << ")";
+			std::cout << message.str() << flush;
+		}
+		else
+		{
+			++n_no_ops;
+		}
+		if ((condition == RUN_UNTIL_COND::NO_OPS || condition == RUN_UNTIL_COND::NO_OPS_OR_TIME) && n_no_ops >= max_no_ops)
+		{
+			terminate_reason = RUN_UNTIL_COND::NO_OPS;
+			break;
+		}
+		if ((condition == RUN_UNTIL_COND::TIME || condition == RUN_UNTIL_COND::NO_OPS_OR_TIME) && get_duration_sec(start_time) >= max_time_sec)
+		{
+			terminate_reason = RUN_UNTIL_COND::TIME;
+			break;
+		}
+	}
+	if (terminate_reason == RUN_UNTIL_COND::NORMAL)
+	{
+		total_runs += model_runs_done;
+		std::cout << endl << endl;
+		if (model_runs_done < nruns)
+		{
+			cout << "WARNING: " << nruns - model_runs_done << " out of " << nruns << " runs failed";
+			if (model_runs_timed_out > 0)
+				cout << " (" << model_runs_timed_out << " overdue runs killed)";
+			cout << endl << endl;
+		}
+		if (init_sim.size() == 0)
+		{
+			vector<double> pars;
+			file_stor.get_run(0, pars, init_sim);
+		}
+	}
+	return terminate_reason;
+}
+
+void RunManagerLocal::advance_runs(double sec)
+{
+	init_workers();
+	if ((waiting_runs.empty()) && (get_n_active() == 0))
+		queue_outstanding_runs();
+	int n_done = model_runs_done;
+	service(((sec < 0.0) || (sec > 1.0)) ? 1.0 : sec);
+	total_runs += model_runs_done - n_done;
+}
+
+int RunManagerLocal::service(double sec)
+{
+	start_runs();
+	{
+		unique_lock<mutex> lock(done_mutex);
+		if ((n_done_signals == 0) && (get_n_active() > 0))
+			done_cv.wait_for(lock, std::chrono::duration<double>(sec), [this]() { return n_done_signals > 0; });
+		n_done_signals = 0;
+	}
+	int n_finished = collect_runs();
+	check_overdue();
+	start_runs();
+	return n_finished;
+}
+
+void RunManagerLocal::start_runs()
+{
+	for (auto &worker : workers)
+	{
+		if (worker->run)
+			continue;
+		while ((!waiting_runs.empty()) && (!worker->run))
+		{
+			int run_id = waiting_runs.front();
+			waiting_runs.pop_front();
+			if (run_requried(run_id))
+				start_run(*worker, run_id);
+		}
+		if (waiting_runs.empty())
+			break;
+	}
+}
+
+void RunManagerLocal::start_run(LocalWorker &worker, int run_id)
+{
+	const vector<string> &obs_name_vec = file_stor.get_obs_name_vec();
+	//the workers share one plugin, so this only calls into it when the names change
+	if (worker.mi.has_model_plugin())
+		worker.mi.set_plugin_names(file_stor.get_par_name_vec(), obs_name_vec);
+	worker.run.reset(new LocalRun(run_id));
+	file_stor.get_parameters(run_id, worker.run->pars);
+	worker.run->obs.insert(obs_name_vec, vector<double>(obs_name_vec.size(), RunStorage::no_data));
+	worker.run->run_thread = thread(&RunManagerLocal::run_async, this, worker.run.get(), &worker.mi);
+}
+
+void RunManagerLocal::run_async(LocalRun *run, ModelInterface *worker_mi)
+{
+	try
+	{
+		worker_mi->run(&run->f_terminate, &run->f_finished, &run->shared_execptions, &run->pars, &run->obs);
+	}
+	catch (...)
+	{
+		run->shared_execptions.add(current_exception());
+	}
+	run->f_done.set(true);
+	lock_guard<mutex> lock(done_mutex);
+	++n_done_signals;
+	done_cv.notify_one();
+}
+
+int RunManagerLocal::collect_runs()
+{
+	int n_finished = 0;
+	for (auto &worker : workers)
+	{
+		if ((!worker->run) || (!worker->run->f_done.get()))
+			continue;
+		unique_ptr<LocalRun> run(std::move(worker->run));
+		run->run_thread.join();
+		int run_id = run->run_id;
+		if (run->f_terminate.get())
+		{
+			//either killed as overdue or another copy of the run finished first
+			if ((run->gave_up) && (run_requried(run_id)) && (get_n_active(run_id) == 0))
+				waiting_runs.push_back(run_id);
+			continue;
+		}
+		if ((run->shared_execptions.size() > 0) || (!run->f_finished.get()))
+		{
+			try
+			{
+				run->shared_execptions.rethrow();
+			}
+			catch (const std::exception& ex)
+			{
+				cerr << endl;
+				cerr << "  " << ex.what() << endl;
+				cerr << "  Aborting model run " << run_id << endl << endl;
+			}
+			catch (...)
+			{
+				cerr << endl;
+				cerr << "  Error running model" << endl;
+				cerr << "  Aborting model run " << run_id << endl << endl;
+			}
+			if (!run_finished(run_id))
+			{
+				update_run_failed(run_id);
+				++model_runs_failed;
+				++n_finished;
+				if ((run_requried(run_id)) && (get_n_active(run_id) == 0))
+					waiting_runs.push_back(run_id);
+			}
+			continue;
+		}
+		if (!run_finished(run_id))
+		{
+			file_stor.update_run(run_id, run->pars, run->obs);
+			++model_runs_done;
+			++n_finished;
+			total_run_sec += get_duration_sec(run->start_time);
+			++n_timed_runs;
+		}
+		//the first copy to finish wins
+		kill_runs(run_id);
+	}
+	return n_finished;
+}
+
+void RunManagerLocal::check_overdue()
+{
+	double avg_run_sec = (n_timed_runs > 0) ? total_run_sec / n_timed_runs : -1.0;
+	for (auto &worker : workers)
+	{
+		if ((!worker->run) || (worker->run->f_terminate.get()) || (worker->run->f_done.get()))
+			continue;
+		LocalRun &run = *worker->run;
+		double duration = get_duration_sec(run.start_time);
+		if ((duration > overdue_giveup_minutes * 60.0) ||
+			((avg_run_sec > 0.0) && (duration > avg_run_sec * overdue_giveup_fac)))
+		{
+			cerr << endl << "  killing overdue run " << run.run_id << " (" << duration << " sec, avg: " <<
+				avg_run_sec << " sec)" << endl;
+			run.gave_up = true;
+			run.f_terminate.set(true);
+			update_run_failed(run.run_id);
+			++model_runs_timed_out;
+			++model_runs_failed;
+		}
+		else if ((avg_run_sec > 0.0) && (duration > avg_run_sec * overdue_reched_fac) && (waiting_runs.empty())
+			&& (get_n_active(run.run_id) < max_concurrent_runs) && (has_free_worker()))
+		{
+			//start another copy on an idle worker, whichever finishes first is used
+			for (auto &free_worker : workers)
+			{
+				if (!free_worker->run)
+				{
+					start_run(*free_worker, run.run_id);
+					break;
+				}
+			}
+		}
+	}
+}
+
+void RunManagerLocal::kill_runs(int run_id)
+{
+	for (auto &worker : workers)
+	{
+		if ((worker->run) && (worker->run->run_id == run_id))
+			worker->run->f_terminate.set(true);
+	}
+}
+
+void RunManagerLocal::kill_all_runs()
+{
+	for (auto &worker : workers)
+	{
+		if (!worker->run)
+			continue;
+		worker->run->f_terminate.set(true);
+		if (worker->run->run_thread.joinable())
+			worker->run->run_thread.join();
+		worker->run.reset();
+	}
+	lock_guard<mutex> lock(done_mutex);
+	n_done_signals = 0;
+}
+
+int RunManagerLocal::get_n_active(int run_id) const
+{
+	int n_active = 0;
+	for (auto &worker : workers)
+	{
+		if ((worker->run) && ((run_id < 0) || (worker->run->run_id == run_id)))
+			++n_active;
+	}
+	return n_active;
+}
+
+bool RunManagerLocal::has_free_worker() const
+{
+	for (auto &worker : workers)
+	{
+		if (!worker->run)
+			return true;
+	}
+	return false;
+}
+
+RunManagerLocal::~RunManagerLocal(void)
+{
+	kill_all_runs();
+}
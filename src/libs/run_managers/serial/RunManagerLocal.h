@@ -0,0 +1,133 @@
+/*
+
+
+	This file is part of PEST++.
+
+	PEST++ is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	PEST++ is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with PEST++.  If not, see<http://www.gnu.org/licenses/>.
+*/
+#ifndef RUNMANAGERLOCAL_H
+#define RUNMANAGERLOCAL_H
+
+#include "RunManagerAbstract.h"
+#include <string>
+#include <vector>
+#include <set>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include "model_interface.h"
+#include "utilities.h"
+
+//a model run in progress on a local worker
+class LocalRun
+{
+public:
+	LocalRun(int _run_id) : run_id(_run_id), f_terminate(false), f_finished(false), f_done(false),
+		gave_up(false), start_time(std::chrono::system_clock::now()) {}
+	int run_id;
+	Parameters pars;
+	Observations obs;
+	pest_utils::thread_flag f_terminate;
+	pest_utils::thread_flag f_finished;
+	pest_utils::thread_flag f_done;
+	pest_utils::thread_exceptions shared_execptions;
+	//killed as overdue - the failure has already been recorded
+	bool gave_up;
+	std::chrono::system_clock::time_point start_time;
+	std::thread run_thread;
+};
+
+//one working directory of the local run manager
+class LocalWorker
+{
+public:
+	LocalWorker(const ModelInterface &_mi) : mi(_mi) {}
+	ModelInterface mi;
+	std::unique_ptr<LocalRun> run;
+};
+
+//runs the model concurrently in local_worker_<i> copies of the run directory, one thread per active run.
+//Results go straight to the run storage; overdue and failed runs are handled like PANTHER does
+class RunManagerLocal : public RunManagerAbstract
+{
+public:
+	RunManagerLocal(const std::vector<std::string> _comline_vec,
+		const std::vector<std::string> _tplfile_vec, const std::vector<std::string> _inpfile_vec,
+		const std::vector<std::string> _insfile_vec, const std::vector<std::string> _outfile_vec,
+		const std::string &stor_filename, const std::string &run_dir, int _n_workers, int _max_run_fail=1,
+		double _overdue_reched_fac=1.15, double _overdue_giveup_fac=100.0, double _overdue_giveup_minutes=1.0e+30,
+		bool fill_tpl_zeros=false, string additional_ins_delimiters="", bool atomic_model_io=true,
+		const std::string &model_plugin="");
+	virtual void reinitialize(const std::string &_filename = std::string(""));
+	virtual void free_memory();
+	virtual int add_run(const Parameters &model_pars, const std::string &info_txt="", double info_value=RunStorage::no_data);
+	virtual int add_run(const std::vector<double> &model_pars, const std::string &info_txt="", double info_value=RunStorage::no_data);
+	virtual int add_run(const Eigen::VectorXd &model_pars, const std::string &info_txt="", double info_value=RunStorage::no_data);
+	virtual std::vector<int> add_runs(const Eigen::MatrixXd &model_pars_mat, const std::vector<std::string> &info_txt_vec,
+		const std::vector<double> &info_value_vec);
+	virtual std::vector<int> add_runs(const double *model_pars, int n_runs);
+	virtual void update_run(int run_id, const Parameters &pars, const Observations &obs);
+	virtual void run();
+	virtual RunManagerAbstract::RUN_UNTIL_COND run_until(RUN_UNTIL_COND condition, int n_nops = 0, double sec = 0.0);
+	~RunManagerLocal(void);
+
+protected:
+	virtual void advance_runs(double sec);
+
+private:
+	static const std::string WORKER_DIR_PREFIX;
+	//extensions of the master's own <case>.<ext> files (run storage, records, jacobians...) that workers don't need
+	static const std::set<std::string> MASTER_FILE_EXTS;
+	std::string run_dir;
+	//the case name the master's files start with
+	std::string case_name;
+	bool is_master_file(const std::string &name) const;
+	int n_workers;
+	int max_concurrent_runs;
+	double overdue_reched_fac;
+	double overdue_giveup_fac;
+	double overdue_giveup_minutes;
+	ModelInterface mi;
+	std::vector<std::unique_ptr<LocalWorker>> workers;
+	std::deque<int> waiting_runs;
+	int model_runs_done;
+	int model_runs_failed;
+	int model_runs_timed_out;
+	int n_timed_runs;
+	double total_run_sec;
+	//set by the run threads so the manager can sleep until a run is done
+	std::mutex done_mutex;
+	std::condition_variable done_cv;
+	int n_done_signals;
+
+	void init_workers();
+	void queue_outstanding_runs();
+	void start_runs();
+	void start_run(LocalWorker &worker, int run_id);
+	void run_async(LocalRun *run, ModelInterface *worker_mi);
+	//wait up to sec seconds for a run thread to finish, then process finished and overdue runs.
+	//Returns the number of runs that finished
+	int service(double sec);
+	int collect_runs();
+	void check_overdue();
+	void kill_runs(int run_id);
+	void kill_all_runs();
+	int get_n_active(int run_id = -1) const;
+	bool has_free_worker() const;
+};
+
+#endif /* RUNMANAGERLOCAL_H */
@@ -39,65 +39,64 @@ RunManagerSerial::RunManagerSerial(const vector<string> _comline_vec,
 	const vector<string> _tplfile_vec, const vector<string> _inpfile_vec,
 	const vector<string> _insfile_vec, const vector<string> _outfile_vec,
 	const string &stor_filename, const string &_run_dir, int _max_run_fail,
-	bool fill_tpl_zeros, string additional_ins_delimiters)
+	bool fill_tpl_zeros, string additional_ins_delimiters, bool atomic_model_io,
+	const string &model_plugin)
 	: RunManagerAbstract(_comline_vec, _tplfile_vec, _inpfile_vec,
 	_insfile_vec, _outfile_vec, stor_filename, _max_run_fail),
-	run_dir(_run_dir), mi(_tplfile_vec,_inpfile_vec,_insfile_vec,_outfile_vec, _comline_vec)
+	mi(_tplfile_vec,_inpfile_vec,_insfile_vec,_outfile_vec, _comline_vec), run_dir(_run_dir)
 {
 	mi.set_additional_ins_delimiters(additional_ins_delimiters);
 	mi.set_fill_tpl_zeros(fill_tpl_zeros);
+	mi.set_atomic_io(atomic_model_io);
+	if (!model_plugin.empty())
+		mi.set_model_plugin(model_plugin);
 
 	cout << "              starting serial run manager ..." << endl << endl;
 }
 
+void RunManagerSerial::initialize(const vector<string> &model_par_names, vector<string> &obs_names, const string &_filename)
+{
+	RunManagerAbstract::initialize(model_par_names, obs_names, _filename);
+	set_plugin_names();
+}
+
+void RunManagerSerial::initialize(const Parameters &model_pars, const Observations &obs, const string &_filename)
+{
+	RunManagerAbstract::initialize(model_pars, obs, _filename);
+	set_plugin_names();
+}
+
+void RunManagerSerial::initialize_restart(const string &_filename)
+{
+	RunManagerAbstract::initialize_restart(_filename);
+	set_plugin_names();
+}
+
+void RunManagerSerial::set_plugin_names()
+{
+	if (mi.has_model_plugin())
+		mi.set_plugin_names(file_stor.get_par_name_vec(), file_stor.get_obs_name_vec());
+}
+
 void RunManagerSerial::run()
 {
 	int success_runs = 0;
 	int prev_sucess_runs = 0;
-	const vector<string> &par_name_vec = file_stor.get_par_name_vec();
-	const vector<string> &obs_name_vec = file_stor.get_obs_name_vec();
 
 	stringstream message;
-	std::vector<double> obs_vec;
 	vector<int> run_id_vec;
 	int nruns = get_outstanding_run_ids().size();
 	while (!(run_id_vec = get_outstanding_run_ids()).empty())
 	{
 		for (int i_run : run_id_vec)
 		{
-			try
+			if (run_model(i_run))
 			{
-				Observations obs;
-				vector<double> par_values;
-				Parameters pars;
-				file_stor.get_parameters(i_run, pars);
-				obs_vec.resize(obs_name_vec.size(), RunStorage::no_data);
-				obs.clear();
-				obs.insert(obs_name_vec, obs_vec);
-				mi.run(&pars, &obs);
-				
-				OperSys::chdir(run_dir.c_str());
 				success_runs += 1;
 				std::cout << string(message.str().size(), '\b');
 				message.str("");
 				message << "(" << success_runs << "/" << nruns << " runs complete)";
 				std::cout << message.str();
-				file_stor.update_run(i_run, pars, obs);
-
-			}
-			catch (const std::exception& ex)
-			{
-				update_run_failed(i_run);
-				cerr << endl;
-				cerr << "  " << ex.what() << endl;
-				cerr << "  Aborting model run" << endl << endl;
-			}
-			catch (...)
-			{
-				update_run_failed(i_run);
-				cerr << endl;
-				cerr << "  Error running model" << endl;
-				cerr << "  Aborting model run" << endl << endl;
 			}
 		}
 	}
@@ -123,6 +122,71 @@ void RunManagerSerial::run()
 	}
 }
 
+void RunManagerSerial::advance_runs(double sec)
+{
+	//submitted runs go first, then anything else that was queued with add_run()
+	int run_id = -1;
+	for (auto &s : submitted_runs)
+	{
+		if (run_requried(s.first))
+		{
+			run_id = s.first;
+			break;
+		}
+	}
+	if (run_id < 0)
+	{
+		vector<int> run_id_vec = get_outstanding_run_ids();
+		if (run_id_vec.empty())
+			return;
+		run_id = run_id_vec[0];
+	}
+	if (run_model(run_id))
+		total_runs += 1;
+}
+
+bool RunManagerSerial::run_model(int run_id)
+{
+	const vector<string> &obs_name_vec = file_stor.get_obs_name_vec();
+	try
+	{
+		if (mi.has_model_plugin())
+		{
+			//straight from and to the run storage arrays
+			vector<double> par_vec, obs_vec;
+			file_stor.get_run(run_id, par_vec, obs_vec);
+			mi.run_plugin(par_vec.data(), obs_vec.data());
+			file_stor.update_run(run_id, par_vec, obs_vec);
+			return true;
+		}
+		Observations obs;
+		Parameters pars;
+		std::vector<double> obs_vec(obs_name_vec.size(), RunStorage::no_data);
+		file_stor.get_parameters(run_id, pars);
+		obs.insert(obs_name_vec, obs_vec);
+		mi.run(&pars, &obs);
+
+		OperSys::chdir(run_dir.c_str());
+		file_stor.update_run(run_id, pars, obs);
+		return true;
+	}
+	catch (const std::exception& ex)
+	{
+		update_run_failed(run_id);
+		cerr << endl;
+		cerr << "  " << ex.what() << endl;
+		cerr << "  Aborting model run" << endl << endl;
+	}
+	catch (...)
+	{
+		update_run_failed(run_id);
+		cerr << endl;
+		cerr << "  Error running model" << endl;
+		cerr << "  Aborting model run" << endl << endl;
+	}
+	return false;
+}
+
 
 RunManagerSerial::~RunManagerSerial(void)
 {
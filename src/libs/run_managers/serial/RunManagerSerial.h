@@ -30,12 +30,22 @@ public:
 		const std::vector<std::string> _tplfile_vec, const std::vector<std::string> _inpfile_vec,
 		const std::vector<std::string> _insfile_vec, const std::vector<std::string> _outfile_vec,
 		const std::string &stor_filename, const std::string &run_dir, int _max_run_fail=1,
-		bool fill_tpl_zeros=false, string additional_ins_delimiters="");
+		bool fill_tpl_zeros=false, string additional_ins_delimiters="", bool atomic_model_io=true,
+		const std::string &model_plugin="");
+	virtual void initialize(const std::vector<std::string> &model_par_names, std::vector<std::string> &obs_names, const std::string &_filename = std::string(""));
+	virtual void initialize(const Parameters &model_pars, const Observations &obs, const std::string &_filename = std::string(""));
+	virtual void initialize_restart(const std::string &_filename);
 	virtual void run();
 	~RunManagerSerial(void);
+protected:
+	//one run per call so wait_any() returns after each completed run
+	virtual void advance_runs(double sec);
 private:
 	ModelInterface mi;
 	std::string run_dir;
+	bool run_model(int run_id);
+	//hand the storage's par and obs order to the model plugin - only needed when the storage names change
+	void set_plugin_names();
 };
 
 #endif /* RUNMANAGERSERIAL_H */
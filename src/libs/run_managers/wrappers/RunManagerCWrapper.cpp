@@ -100,6 +100,25 @@ int rmic_add_run(RunManager *run_manager_ptr, double *parameter_data, int npar,
 }
 
 
+int rmic_add_runs(RunManager *run_manager_ptr, double *parameter_data, int nrun, int npar, int *id_array)
+{
+	int err = 0;
+	try {
+		if ((size_t)npar != run_manager_ptr->get_par_name_vec().size())
+			throw PestIndexError("rmic_add_runs: npar does not match the number of parameters");
+		vector<int> run_ids = run_manager_ptr->add_runs(parameter_data, nrun);
+		std::copy(run_ids.begin(), run_ids.end(), id_array);
+	}
+	catch(exception &ex) {
+		cerr << ex.what() << endl;
+		err = 1;
+	}
+	catch(...)
+	{
+		err = 1;
+	}
+	return err;
+}
 
 int rmic_run(RunManager *run_manager_ptr)
 {
@@ -118,7 +137,7 @@ int rmic_run_until_(RunManager *run_manager_ptr, int *condition, int no_ops, dou
 {
 	int err = 0;
 	RunManagerAbstract::RUN_UNTIL_COND enum_input_cond;
-	RunManagerAbstract::RUN_UNTIL_COND enum_return_cond;
+	RunManagerAbstract::RUN_UNTIL_COND enum_return_cond = RunManagerAbstract::RUN_UNTIL_COND::NORMAL;
 	enum_input_cond = static_cast<RunManagerAbstract::RUN_UNTIL_COND>(*condition);
 	try {
 		enum_return_cond = run_manager_ptr->run_until(enum_input_cond, no_ops, time_sec);
@@ -131,6 +150,11 @@ int rmic_run_until_(RunManager *run_manager_ptr, int *condition, int no_ops, dou
 	return err;
 }
 
+int rmic_run_until(RunManager *run_manager_ptr, int condition, int n_nops, double sec, int *return_cond)
+{
+	return rmic_run_until_(run_manager_ptr, &condition, n_nops, sec, return_cond);
+}
+
 
 int rmic_get_run(RunManager *run_manager_ptr, int run_id, double *parameter_data, int npar, double *obs_data, int nobs)
 {
@@ -148,6 +172,38 @@ int rmic_get_run(RunManager *run_manager_ptr, int run_id, double *parameter_data
 	return err;
 }
 
+int rmic_get_runs(RunManager *run_manager_ptr, int *run_id_array, int nrun, double *parameter_data, int npar,
+	double *obs_data, int nobs, int *status_array)
+{
+	int err = 0;
+	try
+	{
+		if (((size_t)npar != run_manager_ptr->get_par_name_vec().size()) ||
+			((size_t)nobs != run_manager_ptr->get_obs_name_vec().size()))
+			throw PestIndexError("rmic_get_runs: npar or nobs does not match the run manager");
+		run_manager_ptr->get_runs(run_id_array, nrun, parameter_data, obs_data, status_array);
+	}
+	catch(exception &ex) {
+		cerr << ex.what() << endl;
+		err = 1;
+	}
+	return err;
+}
+
+int rmic_get_run_status(RunManager *run_manager_ptr, int *run_id_array, int nrun, int *status_array)
+{
+	int err = 0;
+	try
+	{
+		run_manager_ptr->get_run_statuses(run_id_array, nrun, status_array);
+	}
+	catch(exception &ex) {
+		cerr << ex.what() << endl;
+		err = 1;
+	}
+	return err;
+}
+
 int rmic_get_num_failed_runs(RunManager *run_manager_ptr, int *nfail)
 {
 	int err = 0;
@@ -45,6 +45,13 @@ extern __declspec(dllexport)
 #endif
 int rmic_add_run(RunManager *run_manager_ptr, double *parameter_data, int npar, int *id);
 
+//add nrun runs at once.  parameter_data is row major (nrun x npar) and the ids of the
+//runs are returned in id_array, which must hold nrun entries
+#ifdef OS_WIN
+extern __declspec(dllexport)
+#endif
+int rmic_add_runs(RunManager *run_manager_ptr, double *parameter_data, int nrun, int npar, int *id_array);
+
 #ifdef OS_WIN
 extern __declspec(dllexport)
 #endif
@@ -62,6 +69,22 @@ extern __declspec(dllexport)
 #endif
 int rmic_get_run(RunManager *run_manager_ptr, int run_id, double *parameter_data, int npar, double *obs_data, int nobs);
 
+//get the nrun runs in run_id_array.  parameter_data (nrun x npar) and obs_data (nrun x nobs)
+//are row major and either may be NULL.  status_array receives the status of each run:
+//1 = complete, 0 = not yet complete, -100 = canceled, other negative values = number of failures
+#ifdef OS_WIN
+extern __declspec(dllexport)
+#endif
+int rmic_get_runs(RunManager *run_manager_ptr, int *run_id_array, int nrun, double *parameter_data, int npar,
+	double *obs_data, int nobs, int *status_array);
+
+//status of the nrun runs in run_id_array, coded as for rmic_get_runs().  Poll this between calls to
+//rmic_run_until() to collect runs as they complete
+#ifdef OS_WIN
+extern __declspec(dllexport)
+#endif
+int rmic_get_run_status(RunManager *run_manager_ptr, int *run_id_array, int nrun, int *status_array);
+
 
 #ifdef OS_WIN
 extern __declspec(dllexport)
@@ -10,14 +10,26 @@
 #include "utilities.h"
 #include <regex>
 #include "Pest.h"
+#ifdef OS_LINUX
+#include <dirent.h>
+#include <sys/stat.h>
+#endif
+#ifdef OS_WIN
+#include <direct.h>
+#include <io.h>
+#endif
 
 using namespace pest_utils;
 
 int  linpack_wrap(void);
 
-PANTHERAgent::PANTHERAgent(ofstream &_frec) :mi(), frec(_frec)
-{
+const std::string PANTHERAgent::cache_dir = "panther_cache";
 
+PANTHERAgent::PANTHERAgent(ofstream &_frec) :frec(_frec), persistent(false), mi(), n_slots(1), relay_group_id(-1),
+	cache_max_mb(1024.0)
+{
+	wake_fd[0] = -1;
+	wake_fd[1] = -1;
 }
 
 void PANTHERAgent::init_network(const string &host, const string &port)
@@ -57,16 +69,38 @@ void PANTHERAgent::init_network(const string &host, const string &port)
 	}
 	cout << "connection to master succeeded on socket: " << w_get_addrinfo_string(connect_addr) << endl << endl;
 	freeaddrinfo(servinfo);
+	const PestppOptions &ppo = pest_scenario.get_pestpp_options();
+	if (ppo.get_panther_keepalive_idle() > 0)
+		w_set_keepalive(sockfd, ppo.get_panther_keepalive_idle(), ppo.get_panther_keepalive_interval());
 
 	fdmax = sockfd;
 	FD_ZERO(&master);
 	FD_SET(sockfd, &master);
+#ifdef OS_LINUX
+	if (pipe(wake_fd) == 0)
+	{
+		FD_SET(wake_fd[0], &master);
+		fdmax = max(fdmax, wake_fd[0]);
+	}
+	else
+	{
+		wake_fd[0] = -1;
+		wake_fd[1] = -1;
+	}
+#endif
 	// send run directory to master
 }
 
 
 PANTHERAgent::~PANTHERAgent()
 {
+#ifdef OS_LINUX
+	if (wake_fd[0] >= 0)
+	{
+		close(wake_fd[0]);
+		close(wake_fd[1]);
+	}
+#endif
 	w_close(sockfd);
 	w_cleanup();
 }
@@ -101,11 +135,22 @@ void PANTHERAgent::process_ctl_file(const string &ctl_filename)
 		pest_scenario.get_model_exec_info().insfile_vec,
 		pest_scenario.get_model_exec_info().outfile_vec,
 		pest_scenario.get_model_exec_info().comline_vec);
-	mi.check_io_access();
-	if (pest_scenario.get_pestpp_options().get_check_tplins())
-		mi.check_tplins(pest_scenario.get_ctl_ordered_par_names(), pest_scenario.get_ctl_ordered_obs_names());
+	string model_plugin = pest_scenario.get_pestpp_options().get_model_plugin();
+	if (!model_plugin.empty())
+		mi.set_model_plugin(model_plugin);
+	else
+	{
+		mi.check_io_access();
+		if (pest_scenario.get_pestpp_options().get_check_tplins())
+			mi.check_tplins(pest_scenario.get_ctl_ordered_par_names(), pest_scenario.get_ctl_ordered_obs_names());
+	}
 	mi.set_additional_ins_delimiters(pest_scenario.get_pestpp_options().get_additional_ins_delimiters());
 	mi.set_fill_tpl_zeros(pest_scenario.get_pestpp_options().get_fill_tpl_zeros());
+	mi.set_atomic_io(pest_scenario.get_pestpp_options().get_atomic_model_io());
+	persistent = pest_scenario.get_pestpp_options().get_panther_agent_persistent();
+	mi.set_cache_tplins(persistent);
+	n_slots = max(1, pest_scenario.get_pestpp_options().get_panther_agent_slots());
+	cache_max_mb = pest_scenario.get_pestpp_options().get_panther_agent_cache_mb();
 }
 
 int PANTHERAgent::recv_message(NetPackage &net_pack, struct timeval *tv)
@@ -136,6 +181,14 @@ int PANTHERAgent::recv_message(NetPackage &net_pack, struct timeval *tv)
 			}
 		}
 		for (int i = 0; i <= fdmax; i++) {
+			if ((i == wake_fd[0]) && (FD_ISSET(i, &read_fds)))
+			{
+				//the run thread finished - let the caller check on it
+				drain_wake_fd();
+				if (tv != NULL)
+					return 2;
+				continue;
+			}
 			if (FD_ISSET(i, &read_fds)) { // got message to read
 				err = net_pack.recv(i); // error or lost connection
 				if (err == -2) {
@@ -178,6 +231,26 @@ int PANTHERAgent::recv_message(NetPackage &net_pack, struct timeval *tv)
 	//          2  no message recieved
 }
 
+void PANTHERAgent::drain_wake_fd()
+{
+#ifdef OS_LINUX
+	if (wake_fd[0] < 0)
+		return;
+	char buf[16];
+	fd_set fds;
+	struct timeval tv;
+	while (true)
+	{
+		FD_ZERO(&fds);
+		FD_SET(wake_fd[0], &fds);
+		tv.tv_sec = 0;
+		tv.tv_usec = 0;
+		if ((select(wake_fd[0] + 1, &fds, NULL, NULL, &tv) <= 0) || (read(wake_fd[0], buf, sizeof(buf)) <= 0))
+			break;
+	}
+#endif
+}
+
 int PANTHERAgent::recv_message(NetPackage &net_pack, long  timeout_seconds, long  timeout_microsecs)
 {
 	int err = -1;
@@ -254,8 +327,8 @@ NetPackage::PackType PANTHERAgent::run_model(Parameters &pars, Observations &obs
 				//don't break here, need to check one last time for incoming messages
 				done = true;
 			}
-			//this call includes a "sleep" for the timeout
-			err = recv_message(net_pack, 0, 100000);
+			//this call includes a "sleep" for the timeout - no need to wait once the run is done
+			err = recv_message(net_pack, 0, done ? 0 : 100000);
 			if (err < 0)
 			{
 				f_terminate.set(true);
@@ -327,8 +400,10 @@ NetPackage::PackType PANTHERAgent::run_model(Parameters &pars, Observations &obs
 		NetPackage::PackType::RUN_FAILED;
 	}
 
+	drain_wake_fd();
 	//sleep here just to give the os a chance to cleanup any remaining file handles
-	w_sleep(poll_interval_seconds * 1000);
+	if (!persistent)
+		w_sleep(poll_interval_seconds * 1000);
 	return final_run_status;
 }
 
@@ -337,6 +412,7 @@ void PANTHERAgent::run_async(pest_utils::thread_flag* terminate, pest_utils::thr
 	Parameters* pars, Observations* obs)
 {
 	mi.run(terminate,finished,shared_execptions, pars, obs);
+	signal_wake();
 }
 
 void PANTHERAgent::start(const string &host, const string &port)
@@ -344,17 +420,34 @@ void PANTHERAgent::start(const string &host, const string &port)
 	NetPackage net_pack;
 	Observations obs = pest_scenario.get_ctl_observations();
 	Parameters pars;
-	vector<int8_t> serialized_data;
 	int err;
 	vector<string> par_name_vec, obs_name_vec;
 
 	//class attribute - can be modified in run_model()
 	terminate = false;
+	if (!relay_port.empty())
+		cout << "PANTHER relay accepting " << n_slots << " concurrent runs, local agents connect on port " << relay_port << endl;
+	else if (n_slots > 1)
+		init_slots();
+	evict_cached_blobs();
 	init_network(host, port);
 	while (!terminate)
 	{
 		//get message from master
-		err = recv_message(net_pack);
+		if (n_slots > 1)
+		{
+			//a relay paces the loop with its local listen() so only polls the master
+			if (relay_rm)
+				check_relay(par_name_vec, obs_name_vec);
+			else
+				check_slots(par_name_vec, obs_name_vec);
+			err = recv_message(net_pack, relay_rm ? 0 : recv_timeout_secs, 0);
+			//timed out or woken by a finished slot
+			if (err == 2)
+				continue;
+		}
+		else
+			err = recv_message(net_pack);
 		if (err == -999)
 		{
 			cout << "error receiving message from master, terminating" << endl;
@@ -385,6 +478,29 @@ void PANTHERAgent::start(const string &host, const string &port)
 			{
 				exit(-1);
 			}
+			if (n_slots > 1)
+			{
+				//advertise the number of run slots (carried in the run id field)
+				net_pack.reset(NetPackage::PackType::SLOTS, 0, n_slots, "");
+				char data;
+				err = send_message(net_pack, &data, 0);
+				if (err != 1)
+				{
+					exit(-1);
+				}
+			}
+			//tell the master which attachments are already cached here
+			vector<string> hash_vec = get_cached_blobs();
+			if (!hash_vec.empty())
+			{
+				vector<int8_t> hash_data = Serialization::serialize(hash_vec);
+				net_pack.reset(NetPackage::PackType::BLOB_LIST, 0, 0, "");
+				err = send_message(net_pack, hash_data.data(), hash_data.size());
+				if (err != 1)
+				{
+					exit(-1);
+				}
+			}
 		}
 		else if (net_pack.get_type() == NetPackage::PackType::PAR_NAMES)
 		{
@@ -415,6 +531,9 @@ void PANTHERAgent::start(const string &host, const string &port)
 				exit(-1);
 			}
 			Serialization::unserialize(net_pack.get_data(), obs_name_vec);
+			//the master sends the par names first.  Slots share the plugin of mi
+			if (mi.has_model_plugin())
+				mi.set_plugin_names(par_name_vec, obs_name_vec);
 		}
 		else if(net_pack.get_type() == NetPackage::PackType::REQ_LINPACK)
 		{
@@ -427,6 +546,33 @@ void PANTHERAgent::start(const string &host, const string &port)
 				exit(-1);
 			}
 		}
+		else if (net_pack.get_type() == NetPackage::PackType::BLOB)
+		{
+			store_blob(net_pack);
+		}
+		else if (net_pack.get_type() == NetPackage::PackType::ATTACH)
+		{
+			string file_name;
+			if (NetPackage::check_string(net_pack.get_data(), 0, net_pack.get_data().size()))
+				file_name = NetPackage::extract_string(net_pack.get_data(), 0, net_pack.get_data().size());
+			pending_attachments[net_pack.get_run_id()].push_back(make_pair(net_pack.get_desc(), file_name));
+		}
+		else if ((net_pack.get_type() == NetPackage::PackType::START_RUN) && (n_slots > 1))
+		{
+			bool started = relay_port.empty() ? start_slot_run(net_pack, par_name_vec, obs) :
+				start_relay_run(net_pack, par_name_vec, obs_name_vec);
+			if (!started)
+			{
+				cerr << "received run " << net_pack.get_run_id() << " but all " << n_slots << " slots are busy" << endl;
+				net_pack.reset(NetPackage::PackType::RUN_FAILED, net_pack.get_group_id(), net_pack.get_run_id(), "");
+				char data;
+				err = send_message(net_pack, &data, 0);
+				if (err != 1)
+				{
+					exit(-1);
+				}
+			}
+		}
 		else if(net_pack.get_type() == NetPackage::PackType::START_RUN)
 		{
 			Serialization::unserialize(net_pack.get_data(), pars, par_name_vec);
@@ -435,64 +581,25 @@ void PANTHERAgent::start(const string &host, const string &port)
 			int run_id = net_pack.get_run_id();
 			
 			cout << "received parameters (group id = " << group_id << ", run id = " << run_id << ")" << endl;
+			if (!apply_attachments(run_id, OperSys::getcwd()))
+			{
+				send_run_result(NetPackage::PackType::RUN_FAILED, group_id, run_id, pars, obs, 0.0, par_name_vec, obs_name_vec);
+				continue;
+			}
 			cout << "starting model run..." << endl;
 
 			std::chrono::system_clock::time_point start_time = chrono::system_clock::now();
 			NetPackage::PackType final_run_status = run_model(pars, obs, net_pack);
-			if (final_run_status == NetPackage::PackType::RUN_FINISHED)
-			{
-				double run_time = pest_utils::get_duration_sec(start_time);
-				//send model results back
-				cout << "run complete" << endl;
-				cout << "sending results to master (group id = " << group_id << ", run id = " << run_id << ")..." << endl;
-				cout << "results sent" << endl << endl;
-				serialized_data = Serialization::serialize(pars, par_name_vec, obs, obs_name_vec, run_time);
-				net_pack.reset(NetPackage::PackType::RUN_FINISHED, group_id, run_id, "");
-				err = send_message(net_pack, serialized_data.data(), serialized_data.size());
-				if (err != 1)
-				{
-					exit(-1);
-				}
-			}
-			else if (final_run_status == NetPackage::PackType::RUN_FAILED)
-			{
-				cout << "run failed" << endl;
-				net_pack.reset(NetPackage::PackType::RUN_FAILED, group_id, run_id, "");
-				char data;
-				err = send_message(net_pack, &data, 0);
-				if (err != 1)
-				{
-					exit(-1);
-				}
-			}
-			else if (final_run_status == NetPackage::PackType::RUN_KILLED)
-			{
-				cout << "run killed" << endl;
-				net_pack.reset(NetPackage::PackType::RUN_KILLED, group_id, run_id, "");
-				char data;
-				err = send_message(net_pack, &data, 0);
-				if (err != 1)
-				{
-					exit(-1);
-				}
-			}
-			else if (final_run_status == NetPackage::PackType::TERMINATE)
+			if (final_run_status == NetPackage::PackType::TERMINATE)
 			{
 				cout << "run preempted by termination requested" << endl;
 				terminate = true;
 			}
-
-			if (!terminate)
+			else
 			{
-				// Send READY Message to master
-				cout << "sending ready signal to master" << endl;
-				net_pack.reset(NetPackage::PackType::READY, 0, 0, "");
-				char data;
-				err = send_message(net_pack, &data, 0);
-				if (err != 1)
-				{
-					exit(-1);
-				}
+				double run_time = pest_utils::get_duration_sec(start_time);
+				send_run_result(final_run_status, group_id, run_id, pars, obs, run_time, par_name_vec, obs_name_vec,
+					mi.get_run_usage());
 			}
 		}
 		else if (net_pack.get_type() == NetPackage::PackType::TERMINATE)
@@ -500,6 +607,13 @@ void PANTHERAgent::start(const string &host, const string &port)
 			cout << "terminated requested" << endl;
 			terminate = true;
 		}
+		else if ((net_pack.get_type() == NetPackage::PackType::REQ_KILL) && (n_slots > 1))
+		{
+			if (relay_port.empty())
+				kill_slot_run(net_pack.get_run_id());
+			else
+				kill_relay_run(net_pack.get_run_id());
+		}
 		else if (net_pack.get_type() == NetPackage::PackType::REQ_KILL)
 		{
 			cout << "received kill request from master. run already finished" << endl;
@@ -521,7 +635,510 @@ void PANTHERAgent::start(const string &host, const string &port)
 			cout << "received unsupported messaged type: " << int(net_pack.get_type()) << endl;
 		}
 		//w_sleep(100);
-		this_thread::sleep_for(chrono::milliseconds(100));
+		if (n_slots == 1)
+			this_thread::sleep_for(chrono::milliseconds(100));
+	}
+	stop_slots();
+	//terminates the local agents of a relay
+	relay_rm.reset();
+}
+
+void PANTHERAgent::send_run_result(NetPackage::PackType run_status, int group_id, int run_id, Parameters &pars, Observations &obs,
+	double run_time, const vector<string> &par_name_vec, const vector<string> &obs_name_vec, const pest_utils::RunUsage &usage)
+{
+	NetPackage net_pack;
+	int err;
+	if (run_status == NetPackage::PackType::RUN_FINISHED)
+	{
+		//send model results back
+		cout << "run complete" << endl;
+		cout << "sending results to master (group id = " << group_id << ", run id = " << run_id << ")..." << endl;
+		cout << "results sent" << endl << endl;
+		vector<int8_t> serialized_data = Serialization::serialize(pars, par_name_vec, obs, obs_name_vec, run_time, usage);
+		net_pack.reset(NetPackage::PackType::RUN_FINISHED, group_id, run_id, "");
+		err = send_message(net_pack, serialized_data.data(), serialized_data.size());
+		if (err != 1)
+		{
+			exit(-1);
+		}
+	}
+	else if (run_status == NetPackage::PackType::RUN_FAILED)
+	{
+		cout << "run failed" << endl;
+		net_pack.reset(NetPackage::PackType::RUN_FAILED, group_id, run_id, "");
+		char data;
+		err = send_message(net_pack, &data, 0);
+		if (err != 1)
+		{
+			exit(-1);
+		}
+	}
+	else if (run_status == NetPackage::PackType::RUN_KILLED)
+	{
+		cout << "run killed" << endl;
+		net_pack.reset(NetPackage::PackType::RUN_KILLED, group_id, run_id, "");
+		char data;
+		err = send_message(net_pack, &data, 0);
+		if (err != 1)
+		{
+			exit(-1);
+		}
+	}
+
+	// Send READY Message to master - the run id tells a multi-slot master which slot is free
+	cout << "sending ready signal to master" << endl;
+	net_pack.reset(NetPackage::PackType::READY, 0, run_id, "");
+	char data;
+	err = send_message(net_pack, &data, 0);
+	if (err != 1)
+	{
+		exit(-1);
+	}
+}
+
+void PANTHERAgent::init_slots()
+{
+	string cwd = OperSys::getcwd();
+	slots.clear();
+	for (int i = 0; i < n_slots; i++)
+	{
+		slots.push_back(std::unique_ptr<PANTHERAgentSlot>(new PANTHERAgentSlot(mi)));
+		if (i == 0)
+			continue;
+		string slot_dir = cwd + OperSys::DIR_SEP + "slot_" + to_string(i);
+#ifdef OS_LINUX
+		struct stat st;
+		if (stat(slot_dir.c_str(), &st) != 0)
+		{
+			cout << "creating slot directory " << slot_dir << endl;
+			if (mkdir(slot_dir.c_str(), 0755) != 0)
+				throw PestError("unable to create slot directory '" + slot_dir + "'");
+			pest_utils::copy_dir_contents(cwd, slot_dir, "slot_");
+		}
+		else
+			cout << "using existing slot directory " << slot_dir << endl;
+#endif
+#ifdef OS_WIN
+		if (!pest_utils::check_exist_in(slot_dir + OperSys::DIR_SEP + pest_scenario.get_model_exec_info().tplfile_vec[0]))
+			throw PestError("slot directory '" + slot_dir + "' not found - multi-slot agents need a copy of the model in each slot_<i> directory");
+#endif
+		slots[i]->mi.set_work_dir(slot_dir);
+	}
+	cout << "PANTHER agent running " << n_slots << " concurrent slots" << endl;
+}
+
+bool PANTHERAgent::start_slot_run(NetPackage &net_pack, const vector<string> &par_name_vec, const Observations &obs_template)
+{
+	for (auto &slot : slots)
+	{
+		if (slot->run)
+			continue;
+		int group_id = net_pack.get_group_id();
+		int run_id = net_pack.get_run_id();
+		string work_dir = slot->mi.get_work_dir().empty() ? OperSys::getcwd() : slot->mi.get_work_dir();
+		if (!apply_attachments(run_id, work_dir))
+		{
+			Parameters pars;
+			Observations obs;
+			send_run_result(NetPackage::PackType::RUN_FAILED, group_id, run_id, pars, obs, 0.0, vector<string>(), vector<string>());
+			return true;
+		}
+		slot->run.reset(new PANTHERAgentRun(group_id, run_id));
+		Serialization::unserialize(net_pack.get_data(), slot->run->pars, par_name_vec);
+		slot->run->obs = obs_template;
+		cout << "received parameters (group id = " << group_id << ", run id = " << run_id << ")" << endl;
+		cout << "starting model run in " << work_dir << endl;
+		slot->run->run_thread = thread(&PANTHERAgent::run_slot_async, this, slot->run.get(), &slot->mi);
+		return true;
+	}
+	return false;
+}
+
+void PANTHERAgent::run_slot_async(PANTHERAgentRun *run, ModelInterface *slot_mi)
+{
+	slot_mi->run(&run->f_terminate, &run->f_finished, &run->shared_execptions, &run->pars, &run->obs);
+	run->f_done.set(true);
+	signal_wake();
+}
+
+void PANTHERAgent::check_slots(const vector<string> &par_name_vec, const vector<string> &obs_name_vec)
+{
+	for (auto &slot : slots)
+	{
+		if ((!slot->run) || (!slot->run->f_done.get()))
+			continue;
+		PANTHERAgentRun &run = *slot->run;
+		run.run_thread.join();
+		NetPackage::PackType run_status = NetPackage::PackType::RUN_FAILED;
+		if (run.f_terminate.get())
+			run_status = NetPackage::PackType::RUN_KILLED;
+		else if (run.shared_execptions.size() > 0)
+		{
+			try
+			{
+				run.shared_execptions.rethrow();
+			}
+			catch (const std::exception& ex)
+			{
+				cerr << endl << "   " << ex.what() << endl;
+				cerr << "   Aborting model run" << endl << endl;
+			}
+			catch (...)
+			{
+				cerr << "   Error running model" << endl;
+				cerr << "   Aborting model run" << endl;
+			}
+		}
+		else if (run.f_finished.get())
+			run_status = NetPackage::PackType::RUN_FINISHED;
+		double run_time = pest_utils::get_duration_sec(run.start_time);
+		send_run_result(run_status, run.group_id, run.run_id, run.pars, run.obs, run_time, par_name_vec, obs_name_vec,
+			slot->mi.get_run_usage());
+		slot->run.reset();
+	}
+}
+
+void PANTHERAgent::kill_slot_run(int run_id)
+{
+	for (auto &slot : slots)
+	{
+		if ((slot->run) && (slot->run->run_id == run_id))
+		{
+			cout << "received kill request for run " << run_id << endl;
+			slot->run->f_terminate.set(true);
+			return;
+		}
+	}
+	cout << "received kill request from master. run " << run_id << " already finished" << endl;
+}
+
+void PANTHERAgent::stop_slots()
+{
+	for (auto &slot : slots)
+	{
+		if (!slot->run)
+			continue;
+		slot->run->f_terminate.set(true);
+		if (slot->run->run_thread.joinable())
+			slot->run->run_thread.join();
+		slot->run.reset();
+	}
+}
+
+void PANTHERAgent::signal_wake()
+{
+#ifdef OS_LINUX
+	if (wake_fd[1] >= 0)
+	{
+		char c = 1;
+		if (write(wake_fd[1], &c, 1) < 0)
+			cerr << "unable to signal run completion" << endl;
+	}
+#endif
+}
+
+void PANTHERAgent::set_relay(const string &_relay_port, int n_runs)
+{
+	if (_relay_port.empty())
+		throw PestError("PANTHER relay requires a port for local agents to connect on");
+	if (n_runs < 2)
+		throw PestError("PANTHER relay requires the number of runs it accepts from the master to be greater than 1");
+	relay_port = _relay_port;
+	//the relay's capacity comes from its own command line, not the control file its local agents also read
+	n_slots = n_runs;
+}
+
+void PANTHERAgent::set_relay(const vector<string> &cmd_arg_vec)
+{
+	auto it_relay = find(cmd_arg_vec.begin(), cmd_arg_vec.end(), "/relay");
+	if (it_relay == cmd_arg_vec.end())
+		return;
+	if ((cmd_arg_vec.end() - it_relay) < 3)
+		throw PestError("PANTHER relay must be specified as /relay :relay_port n_runs");
+	string relay_item = *(it_relay + 1);
+	strip_ip(relay_item);
+	int n_runs = 0;
+	try
+	{
+		n_runs = stoi(*(it_relay + 2));
+	}
+	catch (...)
+	{
+		throw PestError("PANTHER relay must be specified as /relay :relay_port n_runs, not '" + *(it_relay + 2) + "'");
+	}
+	set_relay(relay_item.substr(relay_item.find(':') + 1), n_runs);
+}
+
+void PANTHERAgent::init_relay(const vector<string> &par_name_vec, const vector<string> &obs_name_vec)
+{
+	if (relay_rm)
+	{
+		relay_rm->reinitialize();
+		return;
+	}
+	const PestppOptions &ppo = pest_scenario.get_pestpp_options();
+	f_relay_rmr.open("panther_relay.rmr");
+	if (!f_relay_rmr.good())
+		throw PestError("error opening 'panther_relay.rmr'");
+	relay_rm.reset(new RunManagerPanther("panther_relay.rns", relay_port, f_relay_rmr,
+		ppo.get_max_run_fail(), ppo.get_overdue_reched_fac(), ppo.get_overdue_giveup_fac(),
+		ppo.get_overdue_giveup_minutes(), ppo.get_panther_schedule(), ppo.get_panther_tail_speculation(),
+		ppo.get_panther_keepalive_idle(), ppo.get_panther_keepalive_interval()));
+	Parameters pars;
+	pars.insert(par_name_vec, vector<double>(par_name_vec.size(), 0.0));
+	Observations obs;
+	obs.insert(obs_name_vec, vector<double>(obs_name_vec.size(), 0.0));
+	relay_rm->initialize(pars, obs);
+}
+
+bool PANTHERAgent::start_relay_run(NetPackage &net_pack, const vector<string> &par_name_vec, const vector<string> &obs_name_vec)
+{
+	if (relay_runs.size() >= (size_t)n_slots)
+		return false;
+	int group_id = net_pack.get_group_id();
+	int run_id = net_pack.get_run_id();
+	if (group_id != relay_group_id)
+	{
+		//the master has moved on - anything still queued locally is stale
+		release_relay_runs();
+		init_relay(par_name_vec, obs_name_vec);
+		relay_group_id = group_id;
+	}
+	Parameters pars;
+	Serialization::unserialize(net_pack.get_data(), pars, par_name_vec);
+	int local_run_id = relay_rm->add_run(pars);
+	relay_runs.emplace(local_run_id, PANTHERRelayRun(group_id, run_id));
+	//pass attachments on to the local agents from this relay's cache
+	auto it_attach = pending_attachments.find(run_id);
+	if (it_attach != pending_attachments.end())
+	{
+		for (auto &a : it_attach->second)
+		{
+			relay_rm->add_run_attachment(local_run_id, get_cache_path(a.first), a.second);
+			pest_utils::touch_file(get_cache_path(a.first));
+		}
+		pending_attachments.erase(it_attach);
 	}
+	return true;
 }
 
+void PANTHERAgent::check_relay(const vector<string> &par_name_vec, const vector<string> &obs_name_vec)
+{
+	//nothing can have changed locally if no agent talked to us
+	if (!relay_rm->service(relay_listen_usecs))
+		return;
+	unordered_set<int> in_flight = relay_rm->get_in_flight_run_ids();
+	Parameters pars;
+	Observations obs;
+	//all results resolved in this pass go back to the master together
+	vector<int8_t> batch;
+	for (auto it = relay_runs.begin(); it != relay_runs.end();)
+	{
+		if (in_flight.find(it->first) != in_flight.end())
+		{
+			++it;
+			continue;
+		}
+		double run_time = pest_utils::get_duration_sec(it->second.start_time);
+		//local agents have exhausted their retries if the run is neither in flight nor complete
+		if (relay_rm->get_run(it->first, pars, obs))
+			batch_run_result(batch, NetPackage::PackType::RUN_FINISHED, it->second.group_id, it->second.run_id, pars, obs,
+				run_time, par_name_vec, obs_name_vec);
+		else
+			batch_run_result(batch, NetPackage::PackType::RUN_FAILED, it->second.group_id, it->second.run_id, pars, obs,
+				run_time, par_name_vec, obs_name_vec);
+		it = relay_runs.erase(it);
+	}
+	send_batch(batch);
+}
+
+void PANTHERAgent::kill_relay_run(int run_id)
+{
+	for (auto it = relay_runs.begin(); it != relay_runs.end(); ++it)
+	{
+		if (it->second.run_id != run_id)
+			continue;
+		relay_rm->cancel_run(it->first);
+		Parameters pars;
+		Observations obs;
+		send_run_result(NetPackage::PackType::RUN_KILLED, it->second.group_id, run_id, pars, obs, 0.0,
+			vector<string>(), vector<string>());
+		relay_runs.erase(it);
+		return;
+	}
+	cout << "received kill request from master for run " << run_id << " which is not running" << endl;
+}
+
+void PANTHERAgent::release_relay_runs()
+{
+	//report the stale runs as killed so the master frees their slots
+	vector<int8_t> batch;
+	for (auto &rr : relay_runs)
+	{
+		relay_rm->cancel_run(rr.first);
+		Parameters pars;
+		Observations obs;
+		batch_run_result(batch, NetPackage::PackType::RUN_KILLED, rr.second.group_id, rr.second.run_id, pars, obs, 0.0,
+			vector<string>(), vector<string>());
+	}
+	relay_runs.clear();
+	send_batch(batch);
+}
+
+void PANTHERAgent::batch_run_result(vector<int8_t> &batch, NetPackage::PackType run_status, int group_id, int run_id,
+	Parameters &pars, Observations &obs, double run_time, const vector<string> &par_name_vec, const vector<string> &obs_name_vec)
+{
+	NetPackage net_pack(run_status, group_id, run_id, "");
+	if (run_status == NetPackage::PackType::RUN_FINISHED)
+	{
+		vector<int8_t> serialized_data = Serialization::serialize(pars, par_name_vec, obs, obs_name_vec, run_time, pest_utils::RunUsage());
+		net_pack.append_to_batch(batch, serialized_data.data(), serialized_data.size());
+	}
+	else
+		net_pack.append_to_batch(batch, NULL, 0);
+	//the run id tells the master which slot is free
+	net_pack.reset(NetPackage::PackType::READY, 0, run_id, "");
+	net_pack.append_to_batch(batch, NULL, 0);
+}
+
+void PANTHERAgent::send_batch(const vector<int8_t> &batch)
+{
+	if (batch.empty())
+		return;
+	NetPackage net_pack(NetPackage::PackType::BATCH, 0, 0, "");
+	cout << "sending a batch of results to master (" << batch.size() << " bytes)" << endl;
+	int err = send_message(net_pack, batch.data(), batch.size());
+	if (err != 1)
+	{
+		exit(-1);
+	}
+}
+
+string PANTHERAgent::get_cache_path(const string &hash) const
+{
+	return cache_dir + OperSys::DIR_SEP + hash;
+}
+
+vector<string> PANTHERAgent::get_cached_blobs(bool partial) const
+{
+	vector<string> hash_vec;
+#ifdef OS_LINUX
+	DIR *dir = opendir(cache_dir.c_str());
+	if (dir == NULL)
+		return hash_vec;
+	struct dirent *entry;
+	while ((entry = readdir(dir)) != NULL)
+	{
+		string name(entry->d_name);
+		if ((name[0] != '.') && ((name.find(".tmp") != string::npos) == partial))
+			hash_vec.push_back(name);
+	}
+	closedir(dir);
+#endif
+#ifdef OS_WIN
+	struct _finddata_t f_data;
+	intptr_t handle = _findfirst((cache_dir + "\\*").c_str(), &f_data);
+	if (handle == -1)
+		return hash_vec;
+	do
+	{
+		string name(f_data.name);
+		if ((name[0] != '.') && ((name.find(".tmp") != string::npos) == partial))
+			hash_vec.push_back(name);
+	} while (_findnext(handle, &f_data) == 0);
+	_findclose(handle);
+#endif
+	return hash_vec;
+}
+
+void PANTHERAgent::evict_cached_blobs()
+{
+	for (auto &name : get_cached_blobs(true))
+		remove(get_cache_path(name).c_str());
+	//oldest use first - blobs are touched whenever a run uses them
+	vector<pair<int64_t, pair<int64_t, string>>> blobs;
+	int64_t cache_bytes = 0;
+	for (auto &hash : get_cached_blobs())
+	{
+		pest_utils::FileStamp stamp = pest_utils::get_file_stamp(get_cache_path(hash));
+		if (!stamp.exists)
+			continue;
+		blobs.push_back(make_pair(stamp.mtime_ns, make_pair(stamp.size, hash)));
+		cache_bytes += stamp.size;
+	}
+	sort(blobs.begin(), blobs.end());
+	int64_t max_bytes = int64_t(cache_max_mb * 1024.0 * 1024.0);
+	int n_evicted = 0;
+	for (auto &b : blobs)
+	{
+		if (cache_bytes <= max_bytes)
+			break;
+		if (remove(get_cache_path(b.second.second).c_str()) != 0)
+			continue;
+		cache_bytes -= b.second.first;
+		++n_evicted;
+	}
+	if (n_evicted > 0)
+		cout << "evicted " << n_evicted << " attachments from " << cache_dir << " to keep it under " << cache_max_mb << " MB" << endl;
+}
+
+void PANTHERAgent::store_blob(NetPackage &net_pack)
+{
+	string hash = net_pack.get_desc();
+	if (hash.empty())
+	{
+		cerr << "received attachment without a content hash - ignoring" << endl;
+		return;
+	}
+#ifdef OS_LINUX
+	mkdir(cache_dir.c_str(), 0755);
+#endif
+#ifdef OS_WIN
+	_mkdir(cache_dir.c_str());
+#endif
+	//write to a temporary name first so an interrupted transfer never looks like a cached blob
+	string path = get_cache_path(hash);
+	string tmp_path = path + ".tmp";
+	ofstream f_out(tmp_path, ios::binary);
+	f_out.write((const char*)net_pack.get_data().data(), net_pack.get_data().size());
+	f_out.close();
+	if (!f_out.good())
+	{
+		cerr << "error writing attachment " << hash << " to " << tmp_path << endl;
+		remove(tmp_path.c_str());
+		return;
+	}
+	remove(path.c_str());
+	if (rename(tmp_path.c_str(), path.c_str()) != 0)
+	{
+		//runs using it will fail to find it rather than read part of it
+		cerr << "error moving attachment " << hash << " from " << tmp_path << " into the cache" << endl;
+		remove(tmp_path.c_str());
+		return;
+	}
+	cout << "cached attachment " << hash << " (" << net_pack.get_data().size() << " bytes)" << endl;
+}
+
+bool PANTHERAgent::apply_attachments(int run_id, const string &work_dir)
+{
+	auto it_attach = pending_attachments.find(run_id);
+	if (it_attach == pending_attachments.end())
+		return true;
+	bool success = true;
+	for (auto &a : it_attach->second)
+	{
+		string dest = work_dir + OperSys::DIR_SEP + a.second;
+		ifstream f_src(get_cache_path(a.first), ios::binary);
+		ofstream f_dst(dest, ios::binary);
+		if ((!f_src.good()) || (!f_dst.good()))
+		{
+			cerr << "unable to place attachment " << a.first << " at " << dest << endl;
+			success = false;
+			break;
+		}
+		f_dst << f_src.rdbuf();
+		pest_utils::touch_file(get_cache_path(a.first));
+	}
+	pending_attachments.erase(it_attach);
+	return success;
+}
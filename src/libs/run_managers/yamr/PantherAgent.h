@@ -26,11 +26,54 @@
 #include <iostream>
 #include <fstream>
 #include <memory>
+#include <thread>
+#include <chrono>
+#include <vector>
+#include <map>
 #include "utilities.h"
 #include "pest_error.h"
 #include "network_package.h"
 #include "Transformable.h"
 #include "model_interface.h"
+#include "RunManagerPanther.h"
+
+//a model run in progress on one slot of a multi-slot agent
+class PANTHERAgentRun
+{
+public:
+	PANTHERAgentRun(int _group_id, int _run_id) : group_id(_group_id), run_id(_run_id), f_terminate(false),
+		f_finished(false), f_done(false), start_time(std::chrono::system_clock::now()) {}
+	int group_id;
+	int run_id;
+	Parameters pars;
+	Observations obs;
+	pest_utils::thread_flag f_terminate;
+	pest_utils::thread_flag f_finished;
+	pest_utils::thread_flag f_done;
+	pest_utils::thread_exceptions shared_execptions;
+	std::chrono::system_clock::time_point start_time;
+	std::thread run_thread;
+};
+
+//one of the working directories of a multi-slot agent
+class PANTHERAgentSlot
+{
+public:
+	PANTHERAgentSlot(const ModelInterface &_mi) : mi(_mi) {}
+	ModelInterface mi;
+	std::unique_ptr<PANTHERAgentRun> run;
+};
+
+//a run a relay agent has accepted from its master and handed to its own agents
+class PANTHERRelayRun
+{
+public:
+	PANTHERRelayRun(int _group_id, int _run_id) : group_id(_group_id), run_id(_run_id),
+		start_time(std::chrono::system_clock::now()) {}
+	int group_id;
+	int run_id;
+	std::chrono::system_clock::time_point start_time;
+};
 
 class PANTHERAgent{
 public:
@@ -43,6 +86,10 @@ public:
 	int send_message(NetPackage &net_pack, const void *data=NULL, unsigned long data_len=0);
 	NetPackage::PackType run_model(Parameters &pars, Observations &obs, NetPackage &net_pack);
 	void process_ctl_file(const string &ctl_filename);
+	//act as a relay: accept up to n_runs runs from the master and serve them to local agents connecting on relay_port
+	void set_relay(const std::string &_relay_port, int n_runs);
+	//set up relay mode from "/relay :relay_port n_runs" if it is on the (lower cased) command line
+	void set_relay(const std::vector<std::string> &cmd_arg_vec);
 private:
 	ofstream& frec;
 	int sockfd;
@@ -58,6 +105,10 @@ private:
 #endif
 	static const int recv_timeout_secs = 1;
 	bool terminate;
+	//keep tpl/ins files parsed in memory and skip the post-run cleanup sleep
+	bool persistent;
+	//the run thread writes to this pipe when it is done so the run loop wakes immediately
+	int wake_fd[2];
 	fd_set master;
 	/*std::vector<std::string> comline_vec;
 	std::vector<std::string> tplfile_vec;
@@ -68,6 +119,52 @@ private:
 	std::vector<std::string> par_name_vec;*/
 
 	ModelInterface mi;
+	//concurrent run slots - slot 0 runs in the agent directory, the others in slot_<i> sub directories
+	int n_slots;
+	std::vector<std::unique_ptr<PANTHERAgentSlot>> slots;
+	void init_slots();
+	bool start_slot_run(NetPackage &net_pack, const vector<string> &par_name_vec, const Observations &obs_template);
+	void check_slots(const vector<string> &par_name_vec, const vector<string> &obs_name_vec);
+	void kill_slot_run(int run_id);
+	void stop_slots();
+	void run_slot_async(PANTHERAgentRun *run, ModelInterface *slot_mi);
+	void send_run_result(NetPackage::PackType run_status, int group_id, int run_id, Parameters &pars, Observations &obs,
+		double run_time, const vector<string> &par_name_vec, const vector<string> &obs_name_vec,
+		const pest_utils::RunUsage &usage = pest_utils::RunUsage());
+	//frame a run result and the ready message that follows it onto batch, for sending as one BATCH message
+	void batch_run_result(std::vector<int8_t> &batch, NetPackage::PackType run_status, int group_id, int run_id,
+		Parameters &pars, Observations &obs, double run_time, const vector<string> &par_name_vec,
+		const vector<string> &obs_name_vec);
+	void send_batch(const std::vector<int8_t> &batch);
+	void signal_wake();
+	//relay mode - the slots advertised to the master are filled by a local PANTHER master
+	std::string relay_port;
+	int relay_group_id;
+	std::ofstream f_relay_rmr;
+	std::unique_ptr<RunManagerPanther> relay_rm;
+	//local run id to the master's group and run id
+	std::map<int, PANTHERRelayRun> relay_runs;
+	static const long relay_listen_usecs = 10000;
+	void init_relay(const vector<string> &par_name_vec, const vector<string> &obs_name_vec);
+	bool start_relay_run(NetPackage &net_pack, const vector<string> &par_name_vec, const vector<string> &obs_name_vec);
+	void check_relay(const vector<string> &par_name_vec, const vector<string> &obs_name_vec);
+	void kill_relay_run(int run_id);
+	void release_relay_runs();
+	//run attachments - blobs are kept in a content addressed cache directory and copied into the
+	//working directory of the run they are attached to
+	static const std::string cache_dir;
+	//run id -> (content hash, file name) received ahead of START_RUN
+	std::map<int, std::vector<std::pair<std::string, std::string>>> pending_attachments;
+	std::string get_cache_path(const std::string &hash) const;
+	//the cached blobs, or with partial=true the leftovers of interrupted transfers
+	std::vector<std::string> get_cached_blobs(bool partial=false) const;
+	//trim the cache to cache_max_mb, least recently used blobs first.  Only done at startup, before the
+	//master is told what is cached here
+	double cache_max_mb;
+	void evict_cached_blobs();
+	void store_blob(NetPackage &net_pack);
+	bool apply_attachments(int run_id, const std::string &work_dir);
+	void drain_wake_fd();
 	void run_async(pest_utils::thread_flag* terminate, pest_utils::thread_flag* finished,
 		pest_utils::thread_exceptions *shared_execptions,
 		Parameters* pars, Observations* obs);
@@ -28,12 +28,15 @@
 #include <string>
 #include <list>
 #include <iterator>
+#include <fstream>
 #include <cassert>
 #include <cstring>
 #include <map>
 #include <deque>
 #include <utility>
 #include <algorithm>
+#include <cmath>
+#include <cstdlib>
 #include "network_wrapper.h"
 #include "network_package.h"
 #include "Transformable.h"
@@ -48,7 +51,12 @@ const int RunManagerPanther::BACKLOG = 10;
 const int RunManagerPanther::MAX_FAILED_PINGS = 60;
 const int RunManagerPanther::N_PINGS_UNRESPONSIVE = 3;
 const int RunManagerPanther::PING_INTERVAL_SECS = 60;
+const int RunManagerPanther::MIN_PINGS_PER_PASS = 10;
 const int RunManagerPanther::MAX_CONCURRENT_RUNS_LOWER_LIMIT = 1;
+const int RunManagerPanther::MAX_RESULT_THREADS = 4;
+const int RunManagerPanther::MAX_QUEUED_RESULTS = 256;
+const int RunManagerPanther::MAX_SPARE_PAYLOADS = 8;
+const int64_t RunManagerPanther::MAX_SEND_BYTES_PER_PASS = 4 << 20;
 
 
 AgentInfoRec::AgentInfoRec(int _socket_fd)
@@ -63,9 +71,16 @@ AgentInfoRec::AgentInfoRec(int _socket_fd)
 	run_time = std::chrono::hours(-500);
 	start_time = std::chrono::system_clock::now();
 	last_ping_time = std::chrono::system_clock::now();
+	last_contact_time = last_ping_time;
 	ping = false;
+	ping_rtt_pending = false;
+	n_ping_replies = 0;
+	sum_ping_rtt_ms = 0.0;
+	max_ping_rtt_ms = 0.0;
+	ping_jitter = 0.25 * (double(rand()) / RAND_MAX);
 	failed_pings = 0;
 	failed_runs = 0;
+	n_slots = 1;
 }
 
 bool AgentInfoRec::CompareTimes::operator() (const AgentInfoRec &a, const AgentInfoRec &b)
@@ -239,7 +254,11 @@ void AgentInfoRec::set_ping(bool val)
 	//a success response
 	if (!val) reset_failed_pings();
 	//sending a request
-	else reset_last_ping_time();
+	else
+	{
+		reset_last_ping_time();
+		ping_rtt_pending = true;
+	}
 }
 
 bool AgentInfoRec::get_ping() const
@@ -263,15 +282,193 @@ int AgentInfoRec::seconds_since_last_ping_time() const
 		(chrono::system_clock::now() - last_ping_time).count();
 }
 
+void AgentInfoRec::record_contact()
+{
+	last_contact_time = chrono::system_clock::now();
+	set_ping(false);
+}
+
+double AgentInfoRec::seconds_since_last_contact() const
+{
+	return chrono::duration_cast<chrono::duration<double>>(chrono::system_clock::now() - last_contact_time).count();
+}
+
+void AgentInfoRec::record_ping_reply()
+{
+	if (!ping_rtt_pending)
+		return;
+	ping_rtt_pending = false;
+	double rtt_ms = chrono::duration_cast<chrono::duration<double, milli>>(chrono::system_clock::now() - last_ping_time).count();
+	++n_ping_replies;
+	sum_ping_rtt_ms += rtt_ms;
+	max_ping_rtt_ms = max(max_ping_rtt_ms, rtt_ms);
+}
+
+
+PantherSchedulePolicy* PantherSchedulePolicy::create(const string &name)
+{
+	string upper_name = upper_cp(name);
+	if (upper_name == "FIFO")
+		return new PantherFifoPolicy();
+	else if (upper_name == "PRIORITY")
+		return new PantherPriorityPolicy();
+	throw PestError("unrecognized PANTHER schedule policy: " + name);
+}
+
+void PantherPriorityPolicy::order(std::deque<int> &waiting_runs, bool waiting_changed, std::list<std::list<AgentInfoRec>::iterator> &free_agent_list,
+	int n_responsive_agents, RunManagerPanther &run_mgr)
+{
+	double global_runtime = run_mgr.get_global_runtime_minute();
+	run_mgr.sort_agents_by_speed(free_agent_list);
+
+	if ((global_runtime > 0) && ((int)waiting_runs.size() <= n_responsive_agents))
+	{
+		//tail of the batch: send the longest expected runs first so they land on the fastest agents
+		unordered_map<int, double> run_minutes;
+		for (int run_id : waiting_runs)
+			run_minutes[run_id] = run_mgr.get_expected_run_minute(run_id, global_runtime);
+		stable_sort(waiting_runs.begin(), waiting_runs.end(), [&run_minutes, &run_mgr](int a, int b)
+			{
+				int pa = run_mgr.get_run_priority(a);
+				int pb = run_mgr.get_run_priority(b);
+				if (pa != pb)
+					return pa > pb;
+				return run_minutes[a] > run_minutes[b];
+			});
+	}
+	else if ((waiting_changed) && (run_mgr.has_run_priorities()))
+	{
+		stable_sort(waiting_runs.begin(), waiting_runs.end(), [&run_mgr](int a, int b)
+			{ return run_mgr.get_run_priority(a) > run_mgr.get_run_priority(b); });
+	}
+}
+
+PantherResultQueue::PantherResultQueue(size_t _max_queued, int n_threads) : max_queued(_max_queued), n_busy(0), stop(false)
+{
+	for (int i = 0; i < n_threads; ++i)
+		workers.push_back(thread(&PantherResultQueue::work, this));
+}
+
+PantherResultQueue::~PantherResultQueue()
+{
+	{
+		lock_guard<mutex> lock(queue_mutex);
+		stop = true;
+	}
+	work_cv.notify_all();
+	for (auto &w : workers)
+		w.join();
+}
+
+void PantherResultQueue::push(int run_id, int socket_fd, size_t n_par, size_t n_obs, vector<int8_t> &data)
+{
+	unique_lock<mutex> lock(queue_mutex);
+	space_cv.wait(lock, [this]() { return todo.size() < max_queued; });
+	todo.emplace_back();
+	Result &result = todo.back();
+	result.run_id = run_id;
+	result.socket_fd = socket_fd;
+	result.n_par = n_par;
+	result.n_obs = n_obs;
+	result.run_time = 0.0;
+	result.data.swap(data);
+	lock.unlock();
+	work_cv.notify_one();
+}
+
+void PantherResultQueue::collect(vector<Result> &done_vec, bool wait)
+{
+	unique_lock<mutex> lock(queue_mutex);
+	if (wait)
+		done_cv.wait(lock, [this]() { return todo.empty() && n_busy == 0; });
+	for (auto &result : done)
+		done_vec.push_back(std::move(result));
+	done.clear();
+}
+
+void PantherResultQueue::work()
+{
+	unique_lock<mutex> lock(queue_mutex);
+	while (true)
+	{
+		work_cv.wait(lock, [this]() { return stop || !todo.empty(); });
+		if (stop)
+			return;
+		Result result = std::move(todo.front());
+		todo.pop_front();
+		++n_busy;
+		lock.unlock();
+		space_cv.notify_one();
+		decode(result);
+		lock.lock();
+		--n_busy;
+		done.push_back(std::move(result));
+		done_cv.notify_all();
+	}
+}
+
+void PantherResultQueue::decode(Result &result)
+{
+	//agents serialize in the order of the names the master sent them, which is the storage order
+	size_t n_expected = (result.n_par + result.n_obs + 1) * sizeof(double);
+	if (result.data.size() < n_expected)
+	{
+		stringstream ss;
+		ss << "payload holds " << result.data.size() << " bytes, expected " << n_expected;
+		result.error = ss.str();
+		return;
+	}
+	const int8_t *buf = result.data.data();
+	result.par_data.resize(result.n_par);
+	memcpy(result.par_data.data(), buf, result.n_par * sizeof(double));
+	buf += result.n_par * sizeof(double);
+	result.obs_data.resize(result.n_obs);
+	memcpy(result.obs_data.data(), buf, result.n_obs * sizeof(double));
+	buf += result.n_obs * sizeof(double);
+	memcpy(&result.run_time, buf, sizeof(double));
+	buf += sizeof(double);
+	//agents that collect resource usage append it after the run time
+	double usage_data[4];
+	if (result.data.size() >= n_expected + sizeof(usage_data))
+	{
+		memcpy(usage_data, buf, sizeof(usage_data));
+		result.usage.collected = true;
+		result.usage.cpu_sec = usage_data[0];
+		result.usage.max_rss_kb = usage_data[1];
+		result.usage.n_read_ops = usage_data[2];
+		result.usage.n_write_ops = usage_data[3];
+	}
+	for (size_t i = 0; i < result.n_obs; ++i)
+	{
+		double &val = result.obs_data[i];
+		if (!std::isfinite(val))
+		{
+			stringstream ss;
+			ss << "non-finite simulated value for observation " << i + 1;
+			result.error = ss.str();
+			return;
+		}
+		//denormals are noise and are very slow in the downstream linear algebra
+		if (std::fpclassify(val) == FP_SUBNORMAL)
+			val = 0.0;
+	}
+}
 
 RunManagerPanther::RunManagerPanther(const string &stor_filename, const string &_port, ofstream &_f_rmr, int _max_n_failure,
-	double _overdue_reched_fac, double _overdue_giveup_fac, double _overdue_giveup_minutes)
+	double _overdue_reched_fac, double _overdue_giveup_fac, double _overdue_giveup_minutes, const string &_schedule_policy,
+	bool _tail_speculation, int _keepalive_idle_secs, int _keepalive_interval_secs)
 	: RunManagerAbstract(vector<string>(), vector<string>(), vector<string>(),
 	vector<string>(), vector<string>(), stor_filename, _max_n_failure),
 	overdue_reched_fac(_overdue_reched_fac), overdue_giveup_fac(_overdue_giveup_fac),
-	port(_port), f_rmr(_f_rmr), n_no_ops(0), overdue_giveup_minutes(_overdue_giveup_minutes)
+	port(_port), f_rmr(_f_rmr), n_no_ops(0), overdue_giveup_minutes(_overdue_giveup_minutes),
+	model_runs_done(0), model_runs_failed(0), model_runs_timed_out(0),
+	waiting_runs_changed(false), tail_speculation(_tail_speculation), keepalive_idle_secs(_keepalive_idle_secs),
+	keepalive_interval_secs(_keepalive_interval_secs), ping_cursor(0), n_usage_runs(0)
 {
 	max_concurrent_runs = max(MAX_CONCURRENT_RUNS_LOWER_LIMIT, _max_n_failure);
+	set_schedule_policy(_schedule_policy);
+	int n_result_threads = max(1, min(MAX_RESULT_THREADS, int(std::thread::hardware_concurrency()) - 1));
+	result_queue.reset(new PantherResultQueue(MAX_QUEUED_RESULTS, n_result_threads));
 	w_init();
 	int status;
 	struct addrinfo hints;
@@ -301,6 +498,11 @@ RunManagerPanther::RunManagerPanther(const string &stor_filename, const string &
 		cout << "PANTHER master listening on socket: " << w_get_addrinfo_string(connect_addr) << endl;
 		f_rmr << "PANTHER master listening on socket:" << w_get_addrinfo_string(connect_addr) << endl;
 	}
+	f_rmr << "PANTHER run schedule policy: " << schedule_policy->get_name() << endl;
+	if (keepalive_idle_secs > 0)
+		f_rmr << "PANTHER TCP keepalive: idle " << keepalive_idle_secs << " sec, probe interval " << keepalive_interval_secs << " sec" << endl;
+	if (tail_speculation)
+		f_rmr << "PANTHER speculative tail runs: enabled" << endl;
 	w_listen(listener, BACKLOG);
 	//free servinfo
 	freeaddrinfo(servinfo);
@@ -324,13 +526,24 @@ int RunManagerPanther::get_n_concurrent(int run_id)
 	return n;
 }
 
-list<AgentInfoRec>::iterator RunManagerPanther::get_active_run_iter(int socket)
+list<AgentInfoRec>::iterator RunManagerPanther::get_active_run_iter(int socket, int run_id)
 {
 	auto iter = socket_to_iter_map.find(socket);
 
 	if (iter != socket_to_iter_map.end())
 	{
-		return socket_to_iter_map.find(socket)->second;
+		//multi-slot agents - find the slot that was given this run
+		auto it_slots = socket_to_slots_map.find(socket);
+		if ((it_slots != socket_to_slots_map.end()) &&
+			((iter->second->get_run_id() != run_id) || (iter->second->get_state() == AgentInfoRec::State::WAITING)))
+		{
+			for (auto &slot_iter : it_slots->second)
+			{
+				if ((slot_iter->get_run_id() == run_id) && (slot_iter->get_state() != AgentInfoRec::State::WAITING))
+					return slot_iter;
+			}
+		}
+		return iter->second;
 	}
 	else
 	{
@@ -338,6 +551,38 @@ list<AgentInfoRec>::iterator RunManagerPanther::get_active_run_iter(int socket)
 	}
 }
 
+bool RunManagerPanther::is_running_on_socket(int run_id, int socket_fd)
+{
+	auto range_pair = active_runid_to_iterset_map.equal_range(run_id);
+	for (auto i = range_pair.first; i != range_pair.second; ++i)
+	{
+		if (i->second->get_socket_fd() == socket_fd)
+			return true;
+	}
+	return false;
+}
+
+void RunManagerPanther::add_agent_slots(list<AgentInfoRec>::iterator agent_info_iter)
+{
+	int i_sock = agent_info_iter->get_socket_fd();
+	int n_slots = agent_info_iter->get_n_slots();
+	if ((n_slots < 2) || (socket_to_slots_map.find(i_sock) != socket_to_slots_map.end()))
+		return;
+	vector<list<AgentInfoRec>::iterator> &slots = socket_to_slots_map[i_sock];
+	for (int i = 1; i < n_slots; i++)
+	{
+		agent_info_set.push_back(*agent_info_iter);
+		list<AgentInfoRec>::iterator iter = std::prev(agent_info_set.end());
+		iter->set_n_slots(1);
+		iter->set_state(AgentInfoRec::State::WAITING, AgentInfoRec::UNKNOWN_ID, AgentInfoRec::UNKNOWN_ID);
+		iter->set_work_dir(agent_info_iter->get_work_dir() + ":slot_" + to_string(i));
+		slots.push_back(iter);
+	}
+	stringstream ss;
+	ss << "agent " << agent_info_iter->get_socket_name() << " running " << n_slots << " concurrent slots";
+	report(ss.str(), false);
+}
+
 
 void RunManagerPanther::initialize(const Parameters &model_pars, const Observations &obs, const string &_filename)
 {
@@ -354,6 +599,7 @@ void RunManagerPanther::initialize_restart(const std::string &_filename)
 	{
 		waiting_runs.push_back(id);
 	}
+	waiting_runs_changed = true;
 }
 
 void RunManagerPanther::reinitialize(const std::string &_filename)
@@ -365,7 +611,16 @@ void RunManagerPanther::reinitialize(const std::string &_filename)
 
 void  RunManagerPanther::free_memory()
 {
+	//results still being decoded belong to the current storage
+	apply_ingested_results(true);
 	waiting_runs.clear();
+	waiting_runs_changed = false;
+	run_priority.clear();
+	run_info_txt.clear();
+	submitted_runs.clear();
+	run_attachments.clear();
+	attachment_files.clear();
+	common_attachment_hashes.clear();
 	model_runs_done = 0;
 	failure_map.clear();
 	active_runid_to_iterset_map.clear();
@@ -375,6 +630,7 @@ int RunManagerPanther::add_run(const Parameters &model_pars, const string &info_
 {
 	int run_id = file_stor.add_run(model_pars, info_txt, info_value);
 	waiting_runs.push_back(run_id);
+	waiting_runs_changed = true;
 	return run_id;
 }
 
@@ -382,6 +638,7 @@ int RunManagerPanther::add_run(const std::vector<double> &model_pars, const stri
 {
 	int run_id = file_stor.add_run(model_pars, info_txt, info_value);
 	waiting_runs.push_back(run_id);
+	waiting_runs_changed = true;
 	return run_id;
 }
 
@@ -389,9 +646,27 @@ int RunManagerPanther::add_run(const Eigen::VectorXd &model_pars, const string &
 {
 	int run_id = file_stor.add_run(model_pars, info_txt, info_value);
 	waiting_runs.push_back(run_id);
+	waiting_runs_changed = true;
 	return run_id;
 }
 
+vector<int> RunManagerPanther::add_runs(const Eigen::MatrixXd &model_pars_mat, const vector<string> &info_txt_vec,
+	const vector<double> &info_value_vec)
+{
+	vector<int> run_ids = file_stor.add_runs(model_pars_mat, info_txt_vec, info_value_vec);
+	waiting_runs.insert(waiting_runs.end(), run_ids.begin(), run_ids.end());
+	waiting_runs_changed = true;
+	return run_ids;
+}
+
+vector<int> RunManagerPanther::add_runs(const double *model_pars, int n_runs)
+{
+	vector<int> run_ids = file_stor.add_runs(model_pars, n_runs);
+	waiting_runs.insert(waiting_runs.end(), run_ids.begin(), run_ids.end());
+	waiting_runs_changed = true;
+	return run_ids;
+}
+
 void RunManagerPanther::update_run(int run_id, const Parameters &pars, const Observations &obs)
 {
 
@@ -471,6 +746,7 @@ RunManagerAbstract::RUN_UNTIL_COND RunManagerPanther::run_until(RUN_UNTIL_COND c
 		{
 			n_no_ops = 0;
 		}
+		apply_ingested_results(false);
 
 		if ((condition == RUN_UNTIL_COND::NO_OPS || condition == RUN_UNTIL_COND::NO_OPS_OR_TIME) && n_no_ops >= max_no_ops)
 		{
@@ -508,7 +784,8 @@ RunManagerAbstract::RUN_UNTIL_COND RunManagerPanther::run_until(RUN_UNTIL_COND c
 				f_rmr << " " << fid << "(" << failure_map.count(fid) << ")";
 		}
 		f_rmr << endl << endl;
-			
+		report_ping_stats();
+		report_usage_stats();
 
 		if (init_sim.size() == 0)
 		{
@@ -519,18 +796,419 @@ RunManagerAbstract::RUN_UNTIL_COND RunManagerPanther::run_until(RUN_UNTIL_COND c
 	return terminate_reason;
 }
 
+bool RunManagerPanther::service(long listen_timeout_usec)
+{
+	init_agents();
+	schedule_runs();
+	bool got_message = listen(listen_timeout_usec);
+	if (ping())
+		got_message = true;
+	apply_ingested_results(false);
+	if (got_message)
+		echo();
+	return got_message;
+}
+
+void RunManagerPanther::advance_runs(double sec)
+{
+	//don't sit in select() while decoded results are waiting to be stored
+	long timeout_usec = ingesting_runs.empty() ? 1000000 : 10000;
+	if ((sec >= 0.0) && (sec * 1.0e6 < timeout_usec))
+		timeout_usec = max(long(sec * 1.0e6), 1000L);
+	int n_done = model_runs_done;
+	service(timeout_usec);
+	total_runs += model_runs_done - n_done;
+}
+
+void RunManagerPanther::cancel_run(int run_id)
+{
+	auto it = find(waiting_runs.begin(), waiting_runs.end(), run_id);
+	if (it != waiting_runs.end())
+	{
+		waiting_runs.erase(it);
+		waiting_runs_changed = true;
+	}
+	kill_runs(run_id, false, "cancelled");
+}
+
+unordered_set<int> RunManagerPanther::get_in_flight_run_ids() const
+{
+	unordered_set<int> run_ids(waiting_runs.begin(), waiting_runs.end());
+	for (auto &a : active_runid_to_iterset_map)
+		run_ids.insert(a.first);
+	run_ids.insert(ingesting_runs.begin(), ingesting_runs.end());
+	return run_ids;
+}
+
+bool RunManagerPanther::run_finished(int run_id)
+{
+	if (ingesting_runs.find(run_id) != ingesting_runs.end())
+		return true;
+	return RunManagerAbstract::run_finished(run_id);
+}
+
+void RunManagerPanther::apply_ingested_results(bool wait)
+{
+	if (ingesting_runs.empty())
+		return;
+	vector<PantherResultQueue::Result> results;
+	result_queue->collect(results, wait);
+	for (auto &result : results)
+	{
+		int run_id = result.run_id;
+		ingesting_runs.erase(run_id);
+		if ((int)spare_payloads.size() < MAX_SPARE_PAYLOADS)
+		{
+			result.data.clear();
+			spare_payloads.push_back(std::move(result.data));
+		}
+		if (result.error.empty())
+		{
+			file_stor.update_run(run_id, result.par_data, result.obs_data);
+			if (result.usage.collected)
+			{
+				++n_usage_runs;
+				total_usage.add(result.usage);
+				stringstream ss;
+				ss << "run " << run_id << " usage: cpu " << result.usage.cpu_sec << " sec, max rss " <<
+					result.usage.max_rss_kb / 1024.0 << " MB, reads " << result.usage.n_read_ops << ", writes " <<
+					result.usage.n_write_ops;
+				report(ss.str(), false);
+			}
+			continue;
+		}
+		stringstream ss;
+		ss << "rejecting results of run " << run_id << ": " << result.error;
+		report(ss.str(), false);
+		model_runs_done--;
+		model_runs_failed++;
+		file_stor.update_run_failed(run_id);
+		failure_map.insert(make_pair(run_id, result.socket_fd));
+		auto it_sock = socket_to_iter_map.find(result.socket_fd);
+		if (it_sock != socket_to_iter_map.end())
+			it_sock->second->add_failed_run();
+		if ((get_n_concurrent(run_id) == 0) && ((int)failure_map.count(run_id) < max_n_failure))
+		{
+			waiting_runs.push_front(run_id);
+			waiting_runs_changed = true;
+		}
+	}
+}
+
 bool RunManagerPanther::ping()
 {
 	bool ping_sent = false;
+	if (socket_to_iter_map.empty())
+		return ping_sent;
+	//ping(i_sock) can close agents, so work from a copy of the sockets
+	vector<int> sock_vec;
 	for (auto &i : socket_to_iter_map)
+		sock_vec.push_back(i.first);
+	//cap the pings sent per pass and resume where the last pass stopped so a large farm
+	//is pinged a share at a time rather than in one burst
+	int n_sock = sock_vec.size();
+	int max_pings = max(MIN_PINGS_PER_PASS, n_sock / PING_INTERVAL_SECS);
+	int n_pings = 0;
+	int i = 0;
+	for (; i < n_sock && n_pings < max_pings; ++i)
 	{
-
-		if (ping(i.first))
+		int i_sock = sock_vec[(ping_cursor + i) % n_sock];
+		if (socket_to_iter_map.find(i_sock) == socket_to_iter_map.end())
+			continue;
+		if (ping(i_sock))
+		{
 			ping_sent = true;
+			++n_pings;
+		}
 	}
+	ping_cursor = (ping_cursor + i) % n_sock;
 	return ping_sent;
 }
 
+void RunManagerPanther::add_run_attachment(int run_id, const string &file_name, const string &agent_file_name)
+{
+	string hash = register_attachment(file_name);
+	string agent_name = agent_file_name.empty() ? pest_utils::get_filename(file_name) : agent_file_name;
+	run_attachments[run_id].push_back(make_pair(hash, agent_name));
+}
+
+void RunManagerPanther::set_common_attachments(const vector<string> &file_names)
+{
+	common_attachments = file_names;
+	common_attachment_hashes.clear();
+}
+
+string RunManagerPanther::register_attachment(const string &file_name)
+{
+	ifstream f_in(file_name, ios::binary);
+	if (!f_in.good())
+		throw PestError("RunManagerPanther::register_attachment(): unable to open '" + file_name + "'");
+	int64_t n_bytes = 0;
+	string hash = get_content_hash(f_in, n_bytes);
+	if (attachment_files.find(hash) == attachment_files.end())
+		attachment_files[hash] = make_pair(file_name, n_bytes);
+	return hash;
+}
+
+string RunManagerPanther::get_content_hash(istream &in, int64_t &n_bytes)
+{
+	uint64_t hash = 14695981039346656037ULL;
+	vector<char> buf(1 << 20);
+	n_bytes = 0;
+	while (in)
+	{
+		in.read(buf.data(), buf.size());
+		streamsize n = in.gcount();
+		for (streamsize i = 0; i < n; ++i)
+		{
+			hash ^= uint8_t(buf[i]);
+			hash *= 1099511628211ULL;
+		}
+		n_bytes += n;
+	}
+	stringstream ss;
+	ss << hex << setw(16) << setfill('0') << hash << "_" << dec << n_bytes;
+	return ss.str();
+}
+
+list<list<AgentInfoRec>::iterator>::iterator RunManagerPanther::get_local_agent(int run_id,
+	list<list<AgentInfoRec>::iterator> &free_agent_list)
+{
+	const auto &attachments = run_attachments.at(run_id);
+	auto it_best = free_agent_list.begin();
+	int64_t best_bytes = 0;
+	for (auto it_agent = free_agent_list.begin(); it_agent != free_agent_list.end(); ++it_agent)
+	{
+		auto it_blobs = socket_blobs.find((*it_agent)->get_socket_fd());
+		if (it_blobs == socket_blobs.end())
+			continue;
+		int64_t n_bytes = 0;
+		for (auto &a : attachments)
+		{
+			if (it_blobs->second.find(a.first) != it_blobs->second.end())
+				n_bytes += attachment_files.at(a.first).second + 1;
+		}
+		if (n_bytes > best_bytes)
+		{
+			best_bytes = n_bytes;
+			it_best = it_agent;
+		}
+	}
+	return it_best;
+}
+
+bool RunManagerPanther::queue_run_attachments(int run_id, int socket_fd)
+{
+	if (common_attachment_hashes.size() != common_attachments.size())
+	{
+		common_attachment_hashes.clear();
+		for (auto &f : common_attachments)
+			common_attachment_hashes.push_back(register_attachment(f));
+	}
+	vector<pair<string, string>> attachments;
+	for (size_t i = 0; i < common_attachments.size(); ++i)
+		attachments.push_back(make_pair(common_attachment_hashes[i], pest_utils::get_filename(common_attachments[i])));
+	auto it_attach = run_attachments.find(run_id);
+	if (it_attach != run_attachments.end())
+		attachments.insert(attachments.end(), it_attach->second.begin(), it_attach->second.end());
+	if (attachments.empty())
+		return true;
+	unordered_set<string> &agent_blobs = socket_blobs[socket_fd];
+	for (auto &a : attachments)
+	{
+		//the agent keeps blobs between runs so each one crosses the wire once per agent.  Blobs are read
+		//from disk as the socket drains, so the master neither holds them in memory nor waits on the transfer
+		if (agent_blobs.find(a.first) == agent_blobs.end())
+		{
+			const pair<string, int64_t> &file = attachment_files.at(a.first);
+			NetPackage blob_pack(NetPackage::PackType::BLOB, cur_group_id, run_id, a.first);
+			queue_file(socket_fd, blob_pack, file.first, file.second);
+			agent_blobs.insert(a.first);
+		}
+		NetPackage attach_pack(NetPackage::PackType::ATTACH, cur_group_id, run_id, a.first);
+		if (send_package(socket_fd, attach_pack, a.second.c_str(), a.second.size()) <= 0)
+			return false;
+	}
+	return true;
+}
+
+int RunManagerPanther::send_package(int socket_fd, NetPackage &net_pack, const void *data, int64_t data_len)
+{
+	auto it_queue = send_queues.find(socket_fd);
+	if ((it_queue == send_queues.end()) || it_queue->second.empty())
+		return net_pack.send(socket_fd, data, data_len);
+	queue_package(socket_fd, net_pack, data, data_len);
+	return 1;
+}
+
+void RunManagerPanther::queue_package(int socket_fd, NetPackage &net_pack, const void *data, int64_t data_len, int run_id)
+{
+	int64_t payload_sz = max(data_len, int64_t(0));
+	send_queues[socket_fd].emplace_back();
+	QueuedSend &qs = send_queues[socket_fd].back();
+	qs.bytes.resize(NetPackage::HEADER_LEN + payload_sz);
+	net_pack.pack_header(payload_sz, qs.bytes.data());
+	if (payload_sz > 0)
+		w_memcpy_s(&qs.bytes[NetPackage::HEADER_LEN], payload_sz, data, payload_sz);
+	qs.run_id = run_id;
+}
+
+void RunManagerPanther::queue_file(int socket_fd, NetPackage &net_pack, const string &file_name, int64_t file_size)
+{
+	send_queues[socket_fd].emplace_back();
+	QueuedSend &qs = send_queues[socket_fd].back();
+	qs.bytes.resize(NetPackage::HEADER_LEN);
+	net_pack.pack_header(file_size, qs.bytes.data());
+	qs.file_name = file_name;
+	qs.file_size = file_size;
+}
+
+int RunManagerPanther::pump_send(int socket_fd, QueuedSend &qs, int64_t &budget)
+{
+	int64_t n_bytes = qs.bytes.size();
+	while (budget > 0)
+	{
+		const int8_t *buf;
+		int64_t n_want;
+		if (qs.n_sent < n_bytes)
+		{
+			buf = &qs.bytes[qs.n_sent];
+			n_want = n_bytes - qs.n_sent;
+		}
+		else if (qs.n_sent < n_bytes + qs.file_size)
+		{
+			if (qs.i_chunk == qs.chunk.size())
+			{
+				//the file is opened on the first piece so queued blobs don't hold file handles
+				if (!qs.f_in)
+				{
+					qs.f_in.reset(new ifstream(qs.file_name, ios::binary));
+					if (!qs.f_in->good())
+					{
+						report("unable to open run attachment '" + qs.file_name + "'", true);
+						return -1;
+					}
+				}
+				int64_t n_chunk = min(W_SEND_NOWAIT_MAX, n_bytes + qs.file_size - qs.n_sent);
+				qs.chunk.resize(n_chunk);
+				qs.f_in->read((char*)qs.chunk.data(), n_chunk);
+				if (qs.f_in->gcount() != n_chunk)
+				{
+					report("run attachment '" + qs.file_name + "' changed size while being sent", true);
+					return -1;
+				}
+				qs.i_chunk = 0;
+			}
+			buf = &qs.chunk[qs.i_chunk];
+			n_want = qs.chunk.size() - qs.i_chunk;
+		}
+		else
+		{
+			return 1;
+		}
+		int64_t n = w_send_nowait(socket_fd, buf, min(n_want, budget));
+		if (n < 0)
+			return -1;
+		if (n == 0)
+			return 0;
+		if (qs.n_sent >= n_bytes)
+			qs.i_chunk += n;
+		qs.n_sent += n;
+		budget -= n;
+	}
+	return (qs.n_sent == n_bytes + qs.file_size) ? 1 : 0;
+}
+
+bool RunManagerPanther::pump_send_queues()
+{
+	bool sent = false;
+	vector<int> failed_socks;
+	for (auto &sq : send_queues)
+	{
+		//share the socket time so one big transfer doesn't hold up the master's other work
+		int64_t budget = MAX_SEND_BYTES_PER_PASS;
+		deque<QueuedSend> &queue = sq.second;
+		while (!queue.empty())
+		{
+			int64_t n_before = queue.front().n_sent;
+			int err = pump_send(sq.first, queue.front(), budget);
+			if (queue.front().n_sent > n_before)
+				sent = true;
+			if (err < 0)
+			{
+				failed_socks.push_back(sq.first);
+				break;
+			}
+			if (err == 0)
+				break;
+			if (queue.front().run_id >= 0)
+				restart_run_timer(sq.first, queue.front().run_id);
+			queue.pop_front();
+		}
+	}
+	for (int i_sock : failed_socks)
+	{
+		auto it_agent = socket_to_iter_map.find(i_sock);
+		if (it_agent == socket_to_iter_map.end())
+		{
+			send_queues.erase(i_sock);
+			continue;
+		}
+		report("error sending queued messages to agent:" + it_agent->second->get_hostname() + "$" +
+			it_agent->second->get_work_dir() + "  -> terminating", true);
+		close_agent(i_sock);
+	}
+	return sent;
+}
+
+void RunManagerPanther::restart_run_timer(int socket_fd, int run_id)
+{
+	//the run only starts once the agent has its attachments, so don't charge the transfer to its run time
+	auto range_pair = active_runid_to_iterset_map.equal_range(run_id);
+	for (auto i = range_pair.first; i != range_pair.second; ++i)
+	{
+		if ((i->second->get_socket_fd() == socket_fd) && (i->second->get_state() == AgentInfoRec::State::ACTIVE))
+		{
+			i->second->start_timer();
+			i->second->reset_last_ping_time();
+		}
+	}
+}
+
+void RunManagerPanther::report_ping_stats()
+{
+	int n_agents = 0;
+	int n_replies = 0;
+	double sum_rtt = 0.0;
+	double max_rtt = 0.0;
+	for (auto &i : socket_to_iter_map)
+	{
+		const AgentInfoRec &agent = *i.second;
+		if (agent.get_n_ping_replies() == 0)
+			continue;
+		++n_agents;
+		n_replies += agent.get_n_ping_replies();
+		sum_rtt += agent.get_mean_ping_rtt_ms() * agent.get_n_ping_replies();
+		max_rtt = max(max_rtt, agent.get_max_ping_rtt_ms());
+	}
+	if (n_agents == 0)
+		return;
+	f_rmr << "ping round trip: " << n_replies << " replies from " << n_agents << " agents, mean " <<
+		sum_rtt / n_replies << " ms, max " << max_rtt << " ms" << endl << endl;
+}
+
+void RunManagerPanther::report_usage_stats()
+{
+	if (n_usage_runs > 0)
+	{
+		f_rmr << "model usage: " << n_usage_runs << " runs, total cpu " << total_usage.cpu_sec << " sec, mean cpu " <<
+			total_usage.cpu_sec / n_usage_runs << " sec, peak rss " << total_usage.max_rss_kb / 1024.0 << " MB, reads " <<
+			total_usage.n_read_ops << ", writes " << total_usage.n_write_ops << endl << endl;
+	}
+	n_usage_runs = 0;
+	total_usage = pest_utils::RunUsage();
+}
+
 bool RunManagerPanther::ping(int i_sock)
 {
 	bool ping_sent = false;
@@ -545,11 +1223,22 @@ bool RunManagerPanther::ping(int i_sock)
 		return ping_sent;
 	}
 
+	//an agent still taking queued messages is answered once they are through
+	auto it_queue = send_queues.find(i_sock);
+	if ((it_queue != send_queues.end()) && !it_queue->second.empty())
+		return ping_sent;
 	string sock_hostname = agent_info_iter->get_hostname();
-	fd_set read_fds = master;
-	//if the agent hasn't communicated since the last ping request
-	if ((!FD_ISSET(i_sock, &read_fds)) && agent_info_iter->get_ping())
+	//every message from the agent counts as a ping response (see listen()) so only ping after a silence.
+	//Agents in a long run are given the longer of their run time and the ping interval
+	double ping_time = max(double(PING_INTERVAL_SECS), agent_info_iter->get_runtime_sec()) *
+		(1.0 + agent_info_iter->get_ping_jitter());
+	if (agent_info_iter->seconds_since_last_contact() < ping_time)
+		return ping_sent;
+	if (agent_info_iter->get_ping())
 	{
+		//wait a full interval for the outstanding ping to be answered
+		if (agent_info_iter->seconds_since_last_ping_time() < ping_time)
+			return ping_sent;
 		int fails = agent_info_iter->add_failed_ping();
 		report("failed to receive ping response from agent: " + sock_hostname + "$" + agent_info_iter->get_work_dir(), false);
 		if (fails >= MAX_FAILED_PINGS)
@@ -560,46 +1249,51 @@ bool RunManagerPanther::ping(int i_sock)
 			return ping_sent;
 		}
 	}
-	//check if it is time to ping again...
-	double duration = (double)agent_info_iter->seconds_since_last_ping_time();
-	double ping_time = max(double(PING_INTERVAL_SECS), agent_info_iter->get_runtime_sec());
-	if (duration >= ping_time)
+	ping_sent = true;
+	const char* data = "\0";
+	NetPackage net_pack(NetPackage::PackType::PING, 0, 0, "");
+	int err = net_pack.send(i_sock, data, 0);
+	if (err <= 0)
 	{
-		ping_sent = true;
-		const char* data = "\0";
-		NetPackage net_pack(NetPackage::PackType::PING, 0, 0, "");
-		int err = net_pack.send(i_sock, data, 0);
-		if (err <= 0)
+		int fails = agent_info_iter->add_failed_ping();
+		report("failed to send ping request to agent:" + sock_hostname + "$" + agent_info_iter->get_work_dir(), false);
+		if (fails >= MAX_FAILED_PINGS)
 		{
-			int fails = agent_info_iter->add_failed_ping();
-			report("failed to send ping request to agent:" + sock_hostname + "$" + agent_info_iter->get_work_dir(), false);
-			if (fails >= MAX_FAILED_PINGS)
-			{
-				report("max failed ping communications since last successful run for agent:" + sock_hostname + "$" + agent_info_iter->get_work_dir() + "  -> terminating", true);
-				close_agent(i_sock);
-				return ping_sent;
-			}
+			report("max failed ping communications since last successful run for agent:" + sock_hostname + "$" + agent_info_iter->get_work_dir() + "  -> terminating", true);
+			close_agent(i_sock);
+			return ping_sent;
 		}
-		else agent_info_iter->set_ping(true);
+	}
+	else agent_info_iter->set_ping(true);
 #ifdef _DEBUG
-		report("ping sent to agent:" + sock_hostname + "$" + agent_info_iter->get_work_dir(), false);
+	report("ping sent to agent:" + sock_hostname + "$" + agent_info_iter->get_work_dir(), false);
 #endif
-	}
 	return ping_sent;
 }
 
 
-bool RunManagerPanther::listen()
+bool RunManagerPanther::listen(long timeout_usec)
 {
 	bool got_message = false;
 	struct sockaddr_storage remote_addr;
 	fd_set read_fds; // temp file descriptor list for select()
 	socklen_t addr_len;
 	timeval tv;
-	tv.tv_sec = 1;
-	tv.tv_usec = 0;
+	tv.tv_sec = timeout_usec / 1000000;
+	tv.tv_usec = timeout_usec % 1000000;
 	read_fds = master; // copy it
-	if (w_select(fdmax+1, &read_fds, NULL, NULL, &tv) == -1)
+	//wake up as soon as a socket with queued messages can take more
+	fd_set write_fds;
+	FD_ZERO(&write_fds);
+	bool sending = false;
+	for (auto &sq : send_queues)
+	{
+		if (sq.second.empty())
+			continue;
+		FD_SET(sq.first, &write_fds);
+		sending = true;
+	}
+	if (w_select(fdmax+1, &read_fds, sending ? &write_fds : NULL, NULL, &tv) == -1)
 	{
 		// there are no slaves available.  W need to keep listening until at least one appears
 		got_message = true;
@@ -622,13 +1316,16 @@ bool RunManagerPanther::listen()
 			}
 			else  // handle data from a client
 			{
-				//set the ping flag since the slave sent something back
+				//any message is proof of life and resets the ping clock
 				list<AgentInfoRec>::iterator iter = socket_to_iter_map.at(i);
-				iter->set_ping(false);
+				iter->record_contact();
 				process_message(i);
 			} // END handle data from client
 		} // END got new incoming connection
 	} // END looping through file descriptors
+	//after the reads, as a failed send closes the agent
+	if (sending && pump_send_queues())
+		got_message = true;
 	return got_message;
 }
 
@@ -659,15 +1356,9 @@ void RunManagerPanther::close_agent(int i_sock)
 	close_agent(agent_info_iter);
 }
 
-void RunManagerPanther::close_agent(list<AgentInfoRec>::iterator agent_info_iter)
+void RunManagerPanther::release_agent_run(list<AgentInfoRec>::iterator agent_info_iter)
 {
-	int i_sock = agent_info_iter->get_socket_fd();
 	int run_id = agent_info_iter->get_run_id();
-	AgentInfoRec::State state = agent_info_iter->get_state();
-
-	string socket_name = agent_info_iter->get_socket_name();
-	w_close(i_sock); // bye!
-	FD_CLR(i_sock, &master); // remove from master set
 	// remove run from active_runid_to_iterset_map
 	unschedule_run(agent_info_iter);
 
@@ -676,10 +1367,44 @@ void RunManagerPanther::close_agent(list<AgentInfoRec>::iterator agent_info_iter
 	if (run_id != AgentInfoRec::UNKNOWN_ID &&  agent_info_iter->get_state() == AgentInfoRec::State::ACTIVE && n_concurr == 0)
 	{
 		waiting_runs.push_front(run_id);
+		waiting_runs_changed = true;
+	}
+}
+
+void RunManagerPanther::close_agent(list<AgentInfoRec>::iterator agent_info_iter)
+{
+	int i_sock = agent_info_iter->get_socket_fd();
+	agent_info_iter = socket_to_iter_map.at(i_sock);
+
+	string socket_name = agent_info_iter->get_socket_name();
+	if (agent_info_iter->get_n_ping_replies() > 0)
+	{
+		stringstream ss;
+		ss << "ping round trip for agent " << socket_name << "$" << agent_info_iter->get_work_dir() << ": " <<
+			agent_info_iter->get_n_ping_replies() << " replies, mean " << agent_info_iter->get_mean_ping_rtt_ms() <<
+			" ms, max " << agent_info_iter->get_max_ping_rtt_ms() << " ms";
+		report(ss.str(), false);
+	}
+	w_close(i_sock); // bye!
+	FD_CLR(i_sock, &master); // remove from master set
+	release_agent_run(agent_info_iter);
+	//the other slots of a multi-slot agent share this connection
+	auto it_slots = socket_to_slots_map.find(i_sock);
+	if (it_slots != socket_to_slots_map.end())
+	{
+		for (auto &slot_iter : it_slots->second)
+		{
+			release_agent_run(slot_iter);
+			agent_info_set.erase(slot_iter);
+		}
+		socket_to_slots_map.erase(it_slots);
 	}
 
 	agent_info_set.erase(agent_info_iter);
 	socket_to_iter_map.erase(i_sock);
+	socket_blobs.erase(i_sock);
+	socket_readers.erase(i_sock);
+	send_queues.erase(i_sock);
 
 	stringstream ss;
 	ss << "closed connection to agent: " << socket_name << ", number of agents: " << socket_to_iter_map.size();
@@ -693,6 +1418,11 @@ void RunManagerPanther::schedule_runs()
 
 	std::list<list<AgentInfoRec>::iterator> free_agent_list = get_free_agent_list();
 	int n_responsive_agents = get_n_responsive_agents();
+	if (!waiting_runs.empty() && !free_agent_list.empty())
+	{
+		schedule_policy->order(waiting_runs, waiting_runs_changed, free_agent_list, n_responsive_agents, *this);
+		waiting_runs_changed = false;
+	}
 	//first try to schedule waiting runs
 	for (auto it_run = waiting_runs.begin(); !free_agent_list.empty() && it_run != waiting_runs.end();)
 	{
@@ -805,6 +1535,7 @@ void RunManagerPanther::schedule_runs()
 					if (n_concur == 0 && should_schedule)
 					{
 						waiting_runs.push_front(run_id);
+						waiting_runs_changed = true;
 					}
 				}
 			}
@@ -814,6 +1545,61 @@ void RunManagerPanther::schedule_runs()
 			cout << "exception trying to find overdue runs: " << endl << e.what() << endl;
 		}
 	}
+
+	if ((tail_speculation) && (waiting_runs.empty()) && (!free_agent_list.empty()))
+	{
+		speculate_tail_runs(free_agent_list, n_responsive_agents);
+	}
+}
+
+void RunManagerPanther::speculate_tail_runs(std::list<list<AgentInfoRec>::iterator> &free_agent_list, int n_responsive_agents)
+{
+	//outstanding runs and how long the oldest copy of each has been running
+	unordered_map<int, double> run_duration;
+	for (auto &i : active_runid_to_iterset_map)
+	{
+		if (i.second->get_state() != AgentInfoRec::State::ACTIVE)
+			continue;
+		double duration = i.second->get_duration_minute();
+		auto it = run_duration.find(i.first);
+		if (it == run_duration.end())
+			run_duration[i.first] = duration;
+		else
+			it->second = max(it->second, duration);
+	}
+	//only speculate once the outstanding runs no longer occupy the idle agents
+	if ((run_duration.empty()) || (run_duration.size() >= free_agent_list.size()))
+		return;
+
+	vector<pair<double, int>> tail_runs;
+	for (auto &rd : run_duration)
+		tail_runs.push_back(make_pair(rd.second, rd.first));
+	sort(tail_runs.begin(), tail_runs.end(), greater<pair<double, int>>());
+	sort_agents_by_speed(free_agent_list);
+
+	//duplicate the longest running runs first, spreading the idle agents across them
+	int max_copies = max(2, max_concurrent_runs);
+	bool scheduled = true;
+	while ((!free_agent_list.empty()) && (scheduled))
+	{
+		scheduled = false;
+		for (auto &tr : tail_runs)
+		{
+			if (free_agent_list.empty())
+				break;
+			int run_id = tr.second;
+			if ((run_finished(run_id)) || (get_n_concurrent(run_id) >= max_copies))
+				continue;
+			if (schedule_run(run_id, free_agent_list, n_responsive_agents) > 0)
+			{
+				stringstream ss;
+				ss << "speculative tail run " << run_id << " (" << tr.first << " minutes), " <<
+					get_n_concurrent(run_id) << " concurrent runs";
+				report(ss.str(), false);
+				scheduled = true;
+			}
+		}
+	}
 }
 
 int RunManagerPanther::schedule_run(int run_id, std::list<list<AgentInfoRec>::iterator> &free_agent_list, int n_responsive_agents)
@@ -865,13 +1651,36 @@ int RunManagerPanther::schedule_run(int run_id, std::list<list<AgentInfoRec>::it
 			}
 		}
 	}
+	//move to the agent that already caches most of the run's attachments - but not for a
+	//retry, which must go to an agent that has not already failed this run
+	if ((it_agent == free_agent_list.begin()) && (failure_map.count(run_id) == 0) &&
+		(run_attachments.find(run_id) != run_attachments.end()))
+	{
+		it_agent = get_local_agent(run_id, free_agent_list);
+	}
+	//don't run two copies of the same run on one multi-slot agent
+	while ((n_concurrent > 0) && (it_agent != free_agent_list.end()) && (is_running_on_socket(run_id, (*it_agent)->get_socket_fd())))
+	{
+		++it_agent;
+	}
 	if (it_agent != free_agent_list.end())
 	{
 		int socket_fd = (*it_agent)->get_socket_fd();
 		vector<char> data = file_stor.get_serial_pars(run_id);
 		string host_name = (*it_agent)->get_hostname();
 		NetPackage net_pack(NetPackage::PackType::START_RUN, cur_group_id, run_id, "");
-		int err = net_pack.send(socket_fd, &data[0], data.size());
+		int err = -1;
+		if (queue_run_attachments(run_id, socket_fd))
+		{
+			auto it_queue = send_queues.find(socket_fd);
+			if ((it_queue == send_queues.end()) || it_queue->second.empty())
+				err = net_pack.send(socket_fd, &data[0], data.size());
+			else
+			{
+				queue_package(socket_fd, net_pack, &data[0], data.size(), run_id);
+				err = 1;
+			}
+		}
 		if (err > 0)
 		{
 			(*it_agent)->set_state(AgentInfoRec::State::ACTIVE, run_id, cur_group_id);
@@ -941,15 +1750,56 @@ void RunManagerPanther::report(std::string message,bool to_cout)
 
 void RunManagerPanther::process_message(int i_sock)
 {
-	NetPackage net_pack;
-	int err;
+	NetPackage &net_pack = recv_pack;
+	int err = socket_readers[i_sock].read(i_sock, net_pack);
+	if (err == 2)
+	{
+		//only part of the message has arrived - pick up the rest when the socket is readable again
+		return;
+	}
+	if ((err <= 0) || (net_pack.get_type() != NetPackage::PackType::BATCH))
+	{
+		process_package(i_sock, net_pack, err);
+		return;
+	}
+	//the run results a relay agent resolved together, each followed by its ready message
+	size_t offset = 0;
+	while (offset < net_pack.get_data().size())
+	{
+		NetPackage::PackType t = NetPackage::PackType::UNKN;
+		if (batch_pack.unpack_from_batch(net_pack.get_data(), offset) == 1)
+			t = batch_pack.get_type();
+		if ((t != NetPackage::PackType::RUN_FINISHED) && (t != NetPackage::PackType::RUN_FAILED) &&
+			(t != NetPackage::PackType::RUN_KILLED) && (t != NetPackage::PackType::READY))
+		{
+			list<AgentInfoRec>::iterator agent_info_iter = socket_to_iter_map.at(i_sock);
+			report("received corrupt batch message from agent: " + agent_info_iter->get_hostname() + "$" +
+				agent_info_iter->get_work_dir() + " - terminating agent", false);
+			close_agent(i_sock);
+			return;
+		}
+		process_package(i_sock, batch_pack, 1);
+		if (socket_to_iter_map.find(i_sock) == socket_to_iter_map.end())
+			return;
+	}
+}
+
+void RunManagerPanther::process_package(int i_sock, NetPackage &net_pack, int err)
+{
 	list<AgentInfoRec>::iterator agent_info_iter = socket_to_iter_map.at(i_sock);
 
 	string host_name = agent_info_iter->get_hostname();
 	string port_name = agent_info_iter->get_port();
 	string socket_name = agent_info_iter->get_socket_name();
 
-	if(( err=net_pack.recv(i_sock)) <=0) // error or lost connection
+	if ((err > 0) && (socket_to_slots_map.find(i_sock) != socket_to_slots_map.end()))
+	{
+		NetPackage::PackType t = net_pack.get_type();
+		if ((t == NetPackage::PackType::RUN_FINISHED) || (t == NetPackage::PackType::RUN_FAILED) ||
+			(t == NetPackage::PackType::RUN_KILLED) || (t == NetPackage::PackType::READY))
+			agent_info_iter = get_active_run_iter(i_sock, net_pack.get_run_id());
+	}
+	if (err <= 0) // error or lost connection
 	{
 		if (err  == -2) {
 			report("received corrupt message from agent: " + host_name + "$" + agent_info_iter->get_work_dir() + " - terminating agent", false);
@@ -993,6 +1843,22 @@ void RunManagerPanther::process_message(int i_sock)
 		ss << "new agent ready: " << socket_name;
 		report(ss.str(), false);
 	}
+	else if (net_pack.get_type() == NetPackage::PackType::SLOTS)
+	{
+		int n_slots = net_pack.get_run_id();
+		if (n_slots > 1)
+			agent_info_iter->set_n_slots(n_slots);
+	}
+	else if (net_pack.get_type() == NetPackage::PackType::BLOB_LIST)
+	{
+		vector<string> hash_vec;
+		if (NetPackage::check_string(net_pack.get_data(), 0, net_pack.get_data().size()))
+			Serialization::unserialize(net_pack.get_data(), hash_vec);
+		socket_blobs[i_sock].insert(hash_vec.begin(), hash_vec.end());
+		stringstream ss;
+		ss << "agent " << socket_name << " holds " << hash_vec.size() << " cached attachments";
+		report(ss.str(), false);
+	}
 	else if (net_pack.get_type() == NetPackage::PackType::READY)
 	{
 		// ready message received from slave
@@ -1029,6 +1895,7 @@ void RunManagerPanther::process_message(int i_sock)
 		else
 		{
 			// keep track of model run time
+			record_run_time(run_id, agent_info_iter->get_duration_minute());
 			agent_info_iter->end_run();
 			stringstream ss;
 			ss << "run " << run_id << " received from: " << host_name << "$" << agent_info_iter->get_work_dir() <<
@@ -1054,13 +1921,13 @@ void RunManagerPanther::process_message(int i_sock)
 			report(ss.str(), false);
 			model_runs_failed++;
 			update_run_failed(run_id, i_sock);
-			auto it = get_active_run_iter(i_sock);
-			unschedule_run(it);
+			unschedule_run(agent_info_iter);
 			n_concur = get_n_concurrent(run_id);
 			if (n_concur == 0 && (failure_map.count(run_id) < max_n_failure))
 			{
 				//put model run back into the waiting queue
 				waiting_runs.push_front(run_id);
+				waiting_runs_changed = true;
 			}
 		}
 	}
@@ -1069,14 +1936,14 @@ void RunManagerPanther::process_message(int i_sock)
 		int run_id = net_pack.get_run_id();
 		int group_id = net_pack.get_group_id();
 		int n_concur = get_n_concurrent(run_id);
-		auto it = get_active_run_iter(i_sock);
-		unschedule_run(it);
+		unschedule_run(agent_info_iter);
 		stringstream ss;
 		ss << "Run " << run_id << " killed on agent: " << host_name << "$" << agent_info_iter->get_work_dir() << ", run id:" << run_id << " concurrent: " << n_concur;
 		report(ss.str(), false);
 	}
 	else if (net_pack.get_type() == NetPackage::PackType::PING)
 	{
+		agent_info_iter->record_ping_reply();
 #ifdef _DEBUG
 		report("ping received from agent" + host_name + "$" + agent_info_iter->get_work_dir(), false);
 #endif
@@ -1097,18 +1964,23 @@ void RunManagerPanther::process_message(int i_sock)
 
 bool RunManagerPanther::process_model_run(int sock_id, NetPackage &net_pack)
 {
-	list<AgentInfoRec>::iterator agent_info_iter = socket_to_iter_map.at(sock_id);
 	bool use_run = false;
 	int run_id = net_pack.get_run_id();
+	list<AgentInfoRec>::iterator agent_info_iter = get_active_run_iter(sock_id, run_id);
 
 	//check if another instance of this model run has already completed
 	if (!run_finished(run_id))
 	{
-		Parameters pars;
-		Observations obs;
-		double run_time = 0;
-		Serialization::unserialize(net_pack.get_data(), pars, get_par_name_vec(), obs, get_obs_name_vec(), run_time);
-		file_stor.update_run(run_id, pars, obs);
+		//decoding and checking happen on the result threads - the run counts as finished from here on
+		vector<int8_t> data;
+		if (!spare_payloads.empty())
+		{
+			data.swap(spare_payloads.back());
+			spare_payloads.pop_back();
+		}
+		net_pack.swap_data(data);
+		result_queue->push(run_id, sock_id, get_par_name_vec().size(), get_obs_name_vec().size(), data);
+		ingesting_runs.insert(run_id);
 		agent_info_iter->set_state(AgentInfoRec::State::COMPLETE);
 		//slave_info_iter->set_state(SlaveInfoRec::State::WAITING);
 		use_run = true;
@@ -1116,8 +1988,7 @@ bool RunManagerPanther::process_model_run(int sock_id, NetPackage &net_pack)
 
 	}
 	// remove currently completed run from the active list
-	auto it = get_active_run_iter(sock_id);
-	unschedule_run(it);
+	unschedule_run(agent_info_iter);
 	kill_runs(run_id, false, "completed on alternative node");
 	return use_run;
 }
@@ -1137,9 +2008,10 @@ void RunManagerPanther::kill_run(list<AgentInfoRec>::iterator agent_info_iter, c
 		ss << "sending kill request. reason: " << reason << ", run id:" << run_id;
 		ss<< ",  num previous fails:" << failure_map.count(run_id) << ", agent: " << host_name << "$" << agent_info_iter->get_work_dir();
 		report(ss.str(), false);
-		NetPackage net_pack(NetPackage::PackType::REQ_KILL, 0, 0, "");
+		//the run id lets multi-slot agents find the run to kill
+		NetPackage net_pack(NetPackage::PackType::REQ_KILL, 0, run_id, "");
 		char data = '\0';
-		int err = net_pack.send(socket_id, &data, sizeof(data));
+		int err = send_package(socket_id, net_pack, &data, sizeof(data));
 		if (err == 1)
 		{
 			agent_info_iter->set_state(AgentInfoRec::State::KILLED);
@@ -1248,6 +2120,8 @@ void RunManagerPanther::kill_all_active_runs()
 		else if (cur_state == AgentInfoRec::State::LINPACK_RCV)
 		{
 			i_agent.set_state(AgentInfoRec::State::WAITING);
+			if (i_agent.get_n_slots() > 1)
+				add_agent_slots(socket_to_iter_map.at(i_sock));
 		}
 	}
  }
@@ -1290,6 +2164,12 @@ void RunManagerPanther::kill_all_active_runs()
 			 return false;
 		 }
 	 }
+	 // results still being decoded can be rejected and put back in the queue
+	 if (!ingesting_runs.empty())
+	 {
+		 apply_ingested_results(true);
+		 return waiting_runs.empty();
+	 }
 	 return true;
  }
 
@@ -1300,6 +2180,8 @@ void RunManagerPanther::kill_all_active_runs()
 	 ss << "new connection from: " << w_getnameinfo_string(sock_id);
 	 report(ss.str(), false);
 	 FD_SET(sock_id, &master); // add to master set
+	 if (keepalive_idle_secs > 0)
+		 w_set_keepalive(sock_id, keepalive_idle_secs, keepalive_interval_secs);
 	 if (sock_id > fdmax) { // keep track of the max
 		 fdmax = sock_id;
 	 }
@@ -1330,6 +2212,106 @@ void RunManagerPanther::kill_all_active_runs()
 	 return global_runtime / (double)count;
  }
 
+ double RunManagerPanther::get_linpack_runtime_ratio() const
+ {
+	 double ratio = 0;
+	 int count = 0;
+	 for (auto &si : agent_info_set)
+	 {
+		 if ((si.get_runtime_minute() > 0) && (si.get_linpack_time() > 0))
+		 {
+			 count++;
+			 ratio += si.get_runtime_minute() / si.get_linpack_time();
+		 }
+	 }
+	 if (count == 0)
+		 return 0.0;
+	 return ratio / (double)count;
+ }
+
+ double RunManagerPanther::get_expected_agent_minute(const AgentInfoRec &agent, double global_runtime, double linpack_ratio) const
+ {
+	 double runtime = agent.get_runtime_minute();
+	 if (runtime > 0)
+		 return runtime;
+	 //no runs yet - scale the linpack time by the agents that have a run history
+	 double linpack = agent.get_linpack_time();
+	 if ((linpack > 0) && (linpack_ratio > 0))
+		 return linpack * linpack_ratio;
+	 return global_runtime;
+ }
+
+ void RunManagerPanther::sort_agents_by_speed(std::list<std::list<AgentInfoRec>::iterator> &agent_list) const
+ {
+	 if (agent_list.size() < 2)
+		 return;
+	 double global_runtime = get_global_runtime_minute();
+	 double linpack_ratio = get_linpack_runtime_ratio();
+	 //keyed by record - the slots of a multi-slot agent share a socket but each has its own run history
+	 unordered_map<const AgentInfoRec*, double> agent_minutes;
+	 for (auto &it_agent : agent_list)
+		 agent_minutes[&*it_agent] = get_expected_agent_minute(*it_agent, global_runtime, linpack_ratio);
+	 agent_list.sort([&agent_minutes](const list<AgentInfoRec>::iterator &a, const list<AgentInfoRec>::iterator &b)
+		 { return agent_minutes[&*a] < agent_minutes[&*b]; });
+ }
+
+ double RunManagerPanther::get_expected_run_minute(int run_id, double global_runtime)
+ {
+	 auto it = run_info_txt.find(run_id);
+	 if (it == run_info_txt.end())
+	 {
+		 int status;
+		 string info_txt;
+		 double info_value;
+		 file_stor.get_info(run_id, status, info_txt, info_value);
+		 it = run_info_txt.emplace(run_id, info_txt).first;
+	 }
+	 if (it->second.empty())
+		 return global_runtime;
+	 auto it_rt = info_txt_runtime.find(it->second);
+	 if (it_rt == info_txt_runtime.end())
+		 return global_runtime;
+	 return it_rt->second.first / it_rt->second.second;
+ }
+
+ void RunManagerPanther::record_run_time(int run_id, double run_minutes)
+ {
+	 if (!schedule_policy->uses_run_history())
+		 return;
+	 int status;
+	 string info_txt;
+	 double info_value;
+	 file_stor.get_info(run_id, status, info_txt, info_value);
+	 //unlabelled runs have nothing in common - they are estimated from the global average
+	 if (info_txt.empty())
+		 return;
+	 pair<double, int> &rt = info_txt_runtime[info_txt];
+	 rt.first += run_minutes;
+	 rt.second++;
+ }
+
+ void RunManagerPanther::set_run_priority(int run_id, int priority)
+ {
+	 if (priority == 0)
+		 run_priority.erase(run_id);
+	 else
+		 run_priority[run_id] = priority;
+	 waiting_runs_changed = true;
+ }
+
+ int RunManagerPanther::get_run_priority(int run_id) const
+ {
+	 auto it = run_priority.find(run_id);
+	 if (it == run_priority.end())
+		 return 0;
+	 return it->second;
+ }
+
+ void RunManagerPanther::set_schedule_policy(const string &name)
+ {
+	 schedule_policy.reset(PantherSchedulePolicy::create(name));
+ }
+
  void RunManagerPanther::unschedule_run(list<AgentInfoRec>::iterator agent_info_iter)
  {
 	 int run_id = agent_info_iter->get_run_id();
@@ -1442,9 +2424,14 @@ RunManagerPanther::~RunManagerPanther(void)
 	for(int i = 0; i <= fdmax; i++) {
 		if (FD_ISSET(i, &master))
 		{
-			NetPackage netpack(NetPackage::PackType::TERMINATE, 0, 0,"");
-			char data;
-			netpack.send(i, &data, 0);
+			//don't cut into a partly sent message - the agent sees the connection close instead
+			auto it_queue = send_queues.find(i);
+			if ((it_queue == send_queues.end()) || it_queue->second.empty())
+			{
+				NetPackage netpack(NetPackage::PackType::TERMINATE, 0, 0,"");
+				char data;
+				netpack.send(i, &data, 0);
+			}
 			err = w_close(i);
 			FD_CLR(i, &master);
 		}
@@ -1454,8 +2441,10 @@ RunManagerPanther::~RunManagerPanther(void)
 
 RunManagerYAMRCondor::RunManagerYAMRCondor(const std::string & stor_filename,
 	const std::string & port, std::ofstream & _f_rmr, int _max_n_failure,
-	double overdue_reched_fac, double overdue_giveup_fac, double overdue_giveup_minutes, string _condor_submit_file): RunManagerPanther(stor_filename,
-		port,_f_rmr,_max_n_failure,overdue_reched_fac,overdue_giveup_fac, overdue_giveup_minutes)
+	double overdue_reched_fac, double overdue_giveup_fac, double overdue_giveup_minutes, string _condor_submit_file,
+	const std::string &schedule_policy, bool tail_speculation, int keepalive_idle_secs, int keepalive_interval_secs):
+	RunManagerPanther(stor_filename, port,_f_rmr,_max_n_failure,overdue_reched_fac,overdue_giveup_fac, overdue_giveup_minutes,
+		schedule_policy, tail_speculation, keepalive_idle_secs, keepalive_interval_secs)
 {
 	submit_file = _condor_submit_file;
 	parse_submit_file();
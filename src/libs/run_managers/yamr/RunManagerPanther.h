@@ -22,9 +22,16 @@
 #include <string>
 #include <set>
 #include <deque>
+#include <vector>
 #include <unordered_map>
+#include <unordered_set>
 #include <chrono>
 #include <list>
+#include <fstream>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 #include "network_wrapper.h"
 #include "network_package.h"
 #include "RunManagerAbstract.h"
@@ -67,7 +74,20 @@ public:
 	void reset_failed_pings();
 	void reset_last_ping_time();
 	void reset_runtime() { run_time = std::chrono::system_clock::duration::zero(); }
+	//number of concurrent run slots the agent advertised over this connection
+	int get_n_slots() const { return n_slots; }
+	void set_n_slots(int _n_slots) { n_slots = _n_slots; }
 	int seconds_since_last_ping_time() const;
+	//any message from the agent proves it is alive, so pings are only needed after a silence
+	void record_contact();
+	double seconds_since_last_contact() const;
+	//round trip time of the outstanding ping, if there is one
+	void record_ping_reply();
+	int get_n_ping_replies() const { return n_ping_replies; }
+	double get_mean_ping_rtt_ms() const { return n_ping_replies > 0 ? sum_ping_rtt_ms / n_ping_replies : 0.0; }
+	double get_max_ping_rtt_ms() const { return max_ping_rtt_ms; }
+	//fraction of the ping interval added for this agent so pings to a farm started at once spread out
+	double get_ping_jitter() const { return ping_jitter; }
 	~AgentInfoRec(){}
 private:
 	int socket_fd;
@@ -76,11 +96,18 @@ private:
 	bool ping;
 	int failed_pings;
 	int failed_runs;
+	int n_slots;
 	State state;
 	std::chrono::system_clock::duration linpack_time;
 	std::chrono::system_clock::duration run_time;
 	std::chrono::system_clock::time_point start_time;
 	std::chrono::system_clock::time_point last_ping_time;
+	std::chrono::system_clock::time_point last_contact_time;
+	bool ping_rtt_pending;
+	int n_ping_replies;
+	double sum_ping_rtt_ms;
+	double max_ping_rtt_ms;
+	double ping_jitter;
 	std::string work_dir;
 	std::vector<string> name_info_vec;
 public:
@@ -92,11 +119,92 @@ public:
 	};
 };
 
+class RunManagerPanther;
+
+//decides the order in which waiting runs are offered to free agents.  Runs are taken from the
+//front of waiting_runs and sent to the first acceptable agent in free_agent_list
+class PantherSchedulePolicy
+{
+public:
+	virtual ~PantherSchedulePolicy() {}
+	virtual std::string get_name() const = 0;
+	virtual void order(std::deque<int> &waiting_runs, bool waiting_changed, std::list<std::list<AgentInfoRec>::iterator> &free_agent_list,
+		int n_responsive_agents, RunManagerPanther &run_mgr) = 0;
+	//true if the policy needs the run time history of completed runs
+	virtual bool uses_run_history() const { return false; }
+	static PantherSchedulePolicy* create(const std::string &name);
+};
+
+//runs are dispatched in the order they were added to the first free agent
+class PantherFifoPolicy : public PantherSchedulePolicy
+{
+public:
+	virtual std::string get_name() const { return "FIFO"; }
+	virtual void order(std::deque<int> &waiting_runs, bool waiting_changed, std::list<std::list<AgentInfoRec>::iterator> &free_agent_list,
+		int n_responsive_agents, RunManagerPanther &run_mgr) {}
+};
+
+//runs are dispatched by caller assigned priority to the fastest free agents.  Once the remaining
+//runs fit on the responsive agents, the longest expected runs are sent first
+class PantherPriorityPolicy : public PantherSchedulePolicy
+{
+public:
+	virtual std::string get_name() const { return "PRIORITY"; }
+	virtual bool uses_run_history() const { return true; }
+	virtual void order(std::deque<int> &waiting_runs, bool waiting_changed, std::list<std::list<AgentInfoRec>::iterator> &free_agent_list,
+		int n_responsive_agents, RunManagerPanther &run_mgr);
+};
+
+//decodes and checks RUN_FINISHED payloads on worker threads so the networking thread only has to read sockets.
+//The decoded values are handed back and written to RunStorage by the networking thread, which keeps RunStorage
+//single threaded
+class PantherResultQueue
+{
+public:
+	class Result
+	{
+	public:
+		int run_id;
+		int socket_fd;
+		size_t n_par;
+		size_t n_obs;
+		std::vector<int8_t> data;
+		std::vector<double> par_data;
+		std::vector<double> obs_data;
+		double run_time;
+		//only collected if the agent sent it
+		pest_utils::RunUsage usage;
+		//empty if the payload is good
+		std::string error;
+	};
+	PantherResultQueue(size_t _max_queued, int n_threads);
+	~PantherResultQueue();
+	//queue a payload for decoding.  Blocks while max_queued payloads are waiting
+	void push(int run_id, int socket_fd, size_t n_par, size_t n_obs, std::vector<int8_t> &data);
+	//move decoded results into done_vec.  If wait is true, block until every queued payload is decoded
+	void collect(std::vector<Result> &done_vec, bool wait);
+private:
+	size_t max_queued;
+	size_t n_busy;
+	bool stop;
+	std::mutex queue_mutex;
+	std::condition_variable work_cv;
+	std::condition_variable space_cv;
+	std::condition_variable done_cv;
+	std::deque<Result> todo;
+	std::vector<Result> done;
+	std::vector<std::thread> workers;
+	void work();
+	static void decode(Result &result);
+};
+
 class RunManagerPanther : public RunManagerAbstract
 {
 public:
 	RunManagerPanther(const std::string &stor_filename, const std::string &port, std::ofstream &_f_rmr, int _max_n_failure,
-		double overdue_reched_fac, double overdue_giveup_fac, double overdue_giveup_minutes);
+		double overdue_reched_fac, double overdue_giveup_fac, double overdue_giveup_minutes,
+		const std::string &schedule_policy = "FIFO", bool tail_speculation = false, int keepalive_idle_secs = 0,
+		int keepalive_interval_secs = 10);
 	virtual void initialize(const Parameters &model_pars, const Observations &obs, const std::string &_filename = std::string(""));
 	virtual void initialize_restart(const std::string &_filename);
 	virtual void reinitialize(const std::string &_filename = std::string(""));
@@ -104,14 +212,47 @@ public:
 	virtual int add_run(const Parameters &model_pars, const std::string &info_txt="", double info_value=RunStorage::no_data);
 	virtual int add_run(const std::vector<double> &model_pars, const std::string &info_txt="", double info_valuee=RunStorage::no_data);
 	virtual int add_run(const Eigen::VectorXd &model_pars, const std::string &info_txt="", double info_valuee=RunStorage::no_data);
+	virtual std::vector<int> add_runs(const Eigen::MatrixXd &model_pars_mat, const std::vector<std::string> &info_txt_vec,
+		const std::vector<double> &info_value_vec);
+	virtual std::vector<int> add_runs(const double *model_pars, int n_runs);
 	virtual void update_run(int run_id, const Parameters &pars, const Observations &obs);
 	virtual void run();
 	virtual RunManagerAbstract::RUN_UNTIL_COND run_until(RUN_UNTIL_COND condition, int n_nops = 0, double sec = 0.0);
 	~RunManagerPanther(void);
 	int get_n_waiting_runs() { return waiting_runs.size(); }
 	void close_agents();
+	virtual void set_run_priority(int run_id, int priority);
+	virtual void add_run_attachment(int run_id, const std::string &file_name, const std::string &agent_file_name = "");
+	virtual void set_common_attachments(const std::vector<std::string> &file_names);
+	//FNV-1a hash of a stream's contents (read in chunks), used as its name in the agents' content addressed caches.
+	//n_bytes returns the stream length
+	static std::string get_content_hash(std::istream &in, int64_t &n_bytes);
+	int get_run_priority(int run_id) const;
+	bool has_run_priorities() const { return !run_priority.empty(); }
+	void set_schedule_policy(const std::string &name);
+	//expected run time (minutes) of a run - the mean of completed runs with the same info_txt, or
+	//global_runtime for runs without an info_txt or a history
+	double get_expected_run_minute(int run_id, double global_runtime);
+	//expected run time (minutes) of an agent based on its run history or linpack time
+	double get_expected_agent_minute(const AgentInfoRec &agent, double global_runtime, double linpack_ratio) const;
+	//average ratio of run time (minutes) to linpack time for agents that have completed runs
+	double get_linpack_runtime_ratio() const;
+	//order agents by expected run time, fastest first
+	void sort_agents_by_speed(std::list<std::list<AgentInfoRec>::iterator> &agent_list) const;
+	double get_global_runtime_minute() const;
+	//single non-blocking pass over the agents (handshake, schedule, listen, ping) - used by relay agents
+	//that interleave serving their local agents with talking to an upstream master
+	bool service(long listen_timeout_usec);
+	//drop a run from the queue and kill any running copies without counting it as a failure
+	void cancel_run(int run_id);
+	//ids of runs that are waiting or running on an agent
+	std::unordered_set<int> get_in_flight_run_ids() const;
+	//includes runs whose results are still being ingested
+	virtual bool run_finished(int run_id);
 
-
+protected:
+	//one service() pass so wait_any() returns as soon as a submitted run's results are stored
+	virtual void advance_runs(double sec);
 
 private:
 	std::string port;
@@ -119,7 +260,12 @@ private:
 	static const int MAX_FAILED_PINGS;
 	static const int N_PINGS_UNRESPONSIVE;
 	static const int PING_INTERVAL_SECS;
+	static const int MIN_PINGS_PER_PASS;
 	static const int MAX_CONCURRENT_RUNS_LOWER_LIMIT;
+	static const int MAX_RESULT_THREADS;
+	static const int MAX_QUEUED_RESULTS;
+	static const int MAX_SPARE_PAYLOADS;
+	static const int64_t MAX_SEND_BYTES_PER_PASS;
 
 	double overdue_reched_fac;
 	double overdue_giveup_fac;
@@ -134,9 +280,78 @@ private:
 	fd_set master; // master file descriptor list
 	list<AgentInfoRec> agent_info_set;
 	map<int, list<AgentInfoRec>::iterator> socket_to_iter_map;
+	//additional run slots of multi-slot agents, keyed by socket.  The first slot is in socket_to_iter_map
+	unordered_map<int, vector<list<AgentInfoRec>::iterator>> socket_to_slots_map;
 	multimap<int, list<AgentInfoRec>::iterator> active_runid_to_iterset_map;
 	std::deque<int> waiting_runs;
+	bool waiting_runs_changed;
+	bool tail_speculation;
+	int keepalive_idle_secs;
+	int keepalive_interval_secs;
+	//ping() resumes from here so each pass only pings a share of the agents
+	int ping_cursor;
+	void report_ping_stats();
+	//model resource usage reported by the agents for the runs of this run_until() call
+	int n_usage_runs;
+	pest_utils::RunUsage total_usage;
+	void report_usage_stats();
 	std::unordered_multimap<int, int> failure_map;
+	std::unique_ptr<PantherSchedulePolicy> schedule_policy;
+	std::unordered_map<int, int> run_priority;
+	std::unordered_map<int, std::string> run_info_txt;
+	//info_txt -> (summed run minutes, number of runs) of the completed runs with that info_txt
+	std::unordered_map<std::string, std::pair<double, int>> info_txt_runtime;
+	//run id -> (content hash, agent file name) of the files shipped with the run
+	std::unordered_map<int, std::vector<std::pair<std::string, std::string>>> run_attachments;
+	//content hash -> the master side file it is read from.  Blobs stay on disk and are streamed to the agents
+	std::unordered_map<std::string, std::pair<std::string, int64_t>> attachment_files;
+	//files shipped with every run and, once hashed for the current storage, their content hashes
+	std::vector<std::string> common_attachments;
+	std::vector<std::string> common_attachment_hashes;
+	//hash file_name and record it in attachment_files
+	std::string register_attachment(const std::string &file_name);
+	//content hashes held in each agent's cache, keyed by socket
+	std::unordered_map<int, std::unordered_set<std::string>> socket_blobs;
+	std::list<std::list<AgentInfoRec>::iterator>::iterator get_local_agent(int run_id,
+		std::list<std::list<AgentInfoRec>::iterator> &free_agent_list);
+	bool queue_run_attachments(int run_id, int socket_fd);
+	//a message waiting to go out on an agent's socket: the packed header and payload, optionally followed by
+	//the contents of a file that is read in pieces as the socket takes them
+	class QueuedSend
+	{
+	public:
+		std::vector<int8_t> bytes;
+		std::string file_name;
+		int64_t file_size = 0;
+		std::unique_ptr<std::ifstream> f_in;
+		std::vector<int8_t> chunk;
+		size_t i_chunk = 0;
+		int64_t n_sent = 0;
+		//set for START_RUN - the run timer restarts once the message has actually gone out
+		int run_id = -1;
+	};
+	//messages queued behind an attachment transfer, keyed by socket.  Sockets with an empty queue are sent to directly
+	std::unordered_map<int, std::deque<QueuedSend>> send_queues;
+	//send a package or, if messages are already waiting on the socket, queue it behind them.  Returns as NetPackage::send()
+	int send_package(int socket_fd, NetPackage &net_pack, const void *data, int64_t data_len);
+	void queue_package(int socket_fd, NetPackage &net_pack, const void *data, int64_t data_len, int run_id = -1);
+	void queue_file(int socket_fd, NetPackage &net_pack, const std::string &file_name, int64_t file_size);
+	//push queued messages out without blocking.  Returns true if anything was sent
+	bool pump_send_queues();
+	//-1 on failure, 0 if the socket is full or 1 once the message has gone
+	int pump_send(int socket_fd, QueuedSend &qs, int64_t &budget);
+	void restart_run_timer(int socket_fd, int run_id);
+	void record_run_time(int run_id, double run_minutes);
+	std::unique_ptr<PantherResultQueue> result_queue;
+	//runs that have finished but whose results have not yet been written to storage
+	std::unordered_set<int> ingesting_runs;
+	//messages are processed one at a time, so one package receives all of them and keeps its buffer
+	NetPackage recv_pack;
+	//partially received messages, keyed by socket, so a slow sender never stalls the master
+	std::unordered_map<int, NetPackageReader> socket_readers;
+	//decoded result payloads handed back to recv_pack so large results don't reallocate every message
+	std::vector<std::vector<int8_t>> spare_payloads;
+	void apply_ingested_results(bool wait);
 
 	int schedule_run(int run_id, std::list<list<AgentInfoRec>::iterator> &free_agent_list, int n_responsive_agents);
 	void unschedule_run(list<AgentInfoRec>::iterator agent_info_iter);
@@ -145,12 +360,21 @@ private:
 	void kill_all_active_runs();
 	void close_agent(int i_sock);
 	void close_agent(list<AgentInfoRec>::iterator agent_info_iter);
+	void release_agent_run(list<AgentInfoRec>::iterator agent_info_iter);
+	void add_agent_slots(list<AgentInfoRec>::iterator agent_info_iter);
+	bool is_running_on_socket(int run_id, int socket_fd);
 
 	std::ofstream &f_rmr;
-	bool listen();
+	bool listen(long timeout_usec = 1000000);
 	bool process_model_run(int sock_id, NetPackage &net_pack);
 	void process_message(int i);
+	//act on one received message - err is the result of reading it
+	void process_package(int i_sock, NetPackage &net_pack, int err);
+	//scratch package for the messages unpacked from a BATCH message
+	NetPackage batch_pack;
 	void schedule_runs();
+	//duplicate outstanding runs on idle agents once all waiting runs have been dispatched
+	void speculate_tail_runs(std::list<list<AgentInfoRec>::iterator> &free_agent_list, int n_responsive_agents);
 	void init_agents();
 	list<AgentInfoRec>::iterator add_agent(int sock_id);
 	void erase_agent(int sock_id);
@@ -162,9 +386,8 @@ private:
 	void echo();
 	vector<int> get_overdue_runs_over_kill_threshold(int run_id);
 	bool all_runs_complete();
-	list<AgentInfoRec>::iterator get_active_run_iter(int socket);
+	list<AgentInfoRec>::iterator get_active_run_iter(int socket, int run_id);
 	std::list<std::list<AgentInfoRec>::iterator> get_free_agent_list();
-	double get_global_runtime_minute() const;
 	int get_n_concurrent(int run_id);
 	int get_n_unique_failures();
 	int get_n_responsive_agents();
@@ -177,7 +400,9 @@ class RunManagerYAMRCondor : public RunManagerPanther
 {
 public:
 	RunManagerYAMRCondor(const std::string &stor_filename, const std::string &port, std::ofstream &_f_rmr, int _max_n_failure,
-		double overdue_reched_fac, double overdue_giveup_fac, double overdue_giveup_minutes, string _condor_submit_file);
+		double overdue_reched_fac, double overdue_giveup_fac, double overdue_giveup_minutes, string _condor_submit_file,
+		const std::string &schedule_policy = "FIFO", bool tail_speculation = false, int keepalive_idle_secs = 0,
+		int keepalive_interval_secs = 10);
 	virtual void run();
 
 private:
@@ -36,6 +36,7 @@
 #include "ModelRunPP.h"
 #include "FileManager.h"
 #include "RunManagerSerial.h"
+#include "RunManagerLocal.h"
 #include "OutputFileWriter.h"
 #include "PantherAgent.h"
 #include "Serialization.h"
@@ -147,6 +148,9 @@ int main(int argc, char* argv[])
 				throw(e);
 			}
 
+			//relay agent: local agents connect to this host with /H hostname:relay_port
+			yam_agent.set_relay(cmd_arg_vec);
+
 			yam_agent.start(sock_parts[0], sock_parts[1]);
 		}
 		catch (PestError &perr)
@@ -233,19 +237,46 @@ int main(int argc, char* argv[])
 			pest_scenario.get_pestpp_options().get_max_run_fail(),
 			pest_scenario.get_pestpp_options().get_overdue_reched_fac(),
 			pest_scenario.get_pestpp_options().get_overdue_giveup_fac(),
-			pest_scenario.get_pestpp_options().get_overdue_giveup_minutes());
+			pest_scenario.get_pestpp_options().get_overdue_giveup_minutes(),
+			pest_scenario.get_pestpp_options().get_panther_schedule(),
+			pest_scenario.get_pestpp_options().get_panther_tail_speculation(),
+			pest_scenario.get_pestpp_options().get_panther_keepalive_idle(),
+			pest_scenario.get_pestpp_options().get_panther_keepalive_interval());
 	}
 	else
 	{
 		const ModelExecInfo &exi = pest_scenario.get_model_exec_info();
-		run_manager_ptr = new RunManagerSerial(exi.comline_vec,
-			exi.tplfile_vec, exi.inpfile_vec, exi.insfile_vec, exi.outfile_vec,
-			file_manager.build_filename("rns"), pathname,
-			pest_scenario.get_pestpp_options().get_max_run_fail(),
-			pest_scenario.get_pestpp_options().get_fill_tpl_zeros(),
-			pest_scenario.get_pestpp_options().get_additional_ins_delimiters());
+		if (pest_scenario.get_pestpp_options().get_num_local_workers() > 0)
+		{
+			run_manager_ptr = new RunManagerLocal(exi.comline_vec,
+				exi.tplfile_vec, exi.inpfile_vec, exi.insfile_vec, exi.outfile_vec,
+				file_manager.build_filename("rns"), pathname,
+				pest_scenario.get_pestpp_options().get_num_local_workers(),
+				pest_scenario.get_pestpp_options().get_max_run_fail(),
+				pest_scenario.get_pestpp_options().get_overdue_reched_fac(),
+				pest_scenario.get_pestpp_options().get_overdue_giveup_fac(),
+				pest_scenario.get_pestpp_options().get_overdue_giveup_minutes(),
+				pest_scenario.get_pestpp_options().get_fill_tpl_zeros(),
+				pest_scenario.get_pestpp_options().get_additional_ins_delimiters(),
+				pest_scenario.get_pestpp_options().get_atomic_model_io(),
+				pest_scenario.get_pestpp_options().get_model_plugin());
+		}
+		else
+		{
+			run_manager_ptr = new RunManagerSerial(exi.comline_vec,
+				exi.tplfile_vec, exi.inpfile_vec, exi.insfile_vec, exi.outfile_vec,
+				file_manager.build_filename("rns"), pathname,
+				pest_scenario.get_pestpp_options().get_max_run_fail(),
+				pest_scenario.get_pestpp_options().get_fill_tpl_zeros(),
+				pest_scenario.get_pestpp_options().get_additional_ins_delimiters(),
+				pest_scenario.get_pestpp_options().get_atomic_model_io(),
+				pest_scenario.get_pestpp_options().get_model_plugin());
+		}
 	}
 
+	run_manager_ptr->set_sparse_run_storage(pest_scenario.get_pestpp_options().get_sparse_run_storage());
+	run_manager_ptr->set_common_attachments(pest_scenario.get_pestpp_options().get_panther_attachments());
+
 	cout << endl;
 	fout_rec << endl;
 	cout << "using control file: \"" <<  complete_path << "\"" << endl;
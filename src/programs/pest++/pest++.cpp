@@ -35,6 +35,7 @@
 #include "FileManager.h"
 #include "TerminationController.h"
 #include "RunManagerSerial.h"
+#include "RunManagerLocal.h"
 #include "RunManagerExternal.h"
 #include "SVD_PROPACK.h"
 #include "OutputFileWriter.h"
@@ -101,6 +102,8 @@ int main(int argc, char* argv[])
 			cerr << "        pestpp-glm control_file.pst /H :port" << endl << endl;
 			cerr << "    PANTHER runner:" << endl;
 			cerr << "        pestpp-glm control_file.pst /H hostname:port " << endl << endl;
+			cerr << "    PANTHER relay:" << endl;
+			cerr << "        pestpp-glm control_file.pst /H hostname:port /relay :relay_port n_runs" << endl << endl;
 			cerr << "    external run manager:" << endl;
 			cerr << "        pestpp-glm control_file.pst /E" << endl << endl;
 			cerr << " additional options can be found in the PEST++ manual" << endl;
@@ -168,6 +171,9 @@ int main(int argc, char* argv[])
 					throw(e);
 				}
 
+				//relay agent: local agents connect to this host with /H hostname:relay_port
+				yam_agent.set_relay(cmd_arg_vec);
+
 				yam_agent.start(sock_parts[0], sock_parts[1]);
 			}
 			catch (PestError &perr)
@@ -338,7 +344,11 @@ int main(int argc, char* argv[])
 					pest_scenario.get_pestpp_options().get_overdue_reched_fac(),
 					pest_scenario.get_pestpp_options().get_overdue_giveup_fac(),
 					pest_scenario.get_pestpp_options().get_overdue_giveup_minutes(),
-					csf);
+					csf,
+					pest_scenario.get_pestpp_options().get_panther_schedule(),
+					pest_scenario.get_pestpp_options().get_panther_tail_speculation(),
+					pest_scenario.get_pestpp_options().get_panther_keepalive_idle(),
+					pest_scenario.get_pestpp_options().get_panther_keepalive_interval());
 			}
 			else
 			{
@@ -348,7 +358,11 @@ int main(int argc, char* argv[])
 					pest_scenario.get_pestpp_options().get_max_run_fail(),
 					pest_scenario.get_pestpp_options().get_overdue_reched_fac(),
 					pest_scenario.get_pestpp_options().get_overdue_giveup_fac(),
-					pest_scenario.get_pestpp_options().get_overdue_giveup_minutes());
+					pest_scenario.get_pestpp_options().get_overdue_giveup_minutes(),
+					pest_scenario.get_pestpp_options().get_panther_schedule(),
+					pest_scenario.get_pestpp_options().get_panther_tail_speculation(),
+					pest_scenario.get_pestpp_options().get_panther_keepalive_idle(),
+					pest_scenario.get_pestpp_options().get_panther_keepalive_interval());
 			}
 		}
 		
@@ -369,18 +383,43 @@ int main(int argc, char* argv[])
 			performance_log.log_event("finished basic model IO error checking");
 			cout << "done" << endl;
 			const ModelExecInfo &exi = pest_scenario.get_model_exec_info();
-			run_manager_ptr = new RunManagerSerial(exi.comline_vec,
-				exi.tplfile_vec, exi.inpfile_vec, exi.insfile_vec, exi.outfile_vec,
-				file_manager.build_filename("rns"), pathname,
-				pest_scenario.get_pestpp_options().get_max_run_fail(),
-				pest_scenario.get_pestpp_options().get_fill_tpl_zeros(),
-				pest_scenario.get_pestpp_options().get_additional_ins_delimiters());
+			if (pest_scenario.get_pestpp_options().get_num_local_workers() > 0)
+			{
+				run_manager_ptr = new RunManagerLocal(exi.comline_vec,
+					exi.tplfile_vec, exi.inpfile_vec, exi.insfile_vec, exi.outfile_vec,
+					file_manager.build_filename("rns"), pathname,
+					pest_scenario.get_pestpp_options().get_num_local_workers(),
+					pest_scenario.get_pestpp_options().get_max_run_fail(),
+					pest_scenario.get_pestpp_options().get_overdue_reched_fac(),
+					pest_scenario.get_pestpp_options().get_overdue_giveup_fac(),
+					pest_scenario.get_pestpp_options().get_overdue_giveup_minutes(),
+					pest_scenario.get_pestpp_options().get_fill_tpl_zeros(),
+					pest_scenario.get_pestpp_options().get_additional_ins_delimiters(),
+					pest_scenario.get_pestpp_options().get_atomic_model_io(),
+					pest_scenario.get_pestpp_options().get_model_plugin());
+			}
+			else
+			{
+				run_manager_ptr = new RunManagerSerial(exi.comline_vec,
+					exi.tplfile_vec, exi.inpfile_vec, exi.insfile_vec, exi.outfile_vec,
+					file_manager.build_filename("rns"), pathname,
+					pest_scenario.get_pestpp_options().get_max_run_fail(),
+					pest_scenario.get_pestpp_options().get_fill_tpl_zeros(),
+					pest_scenario.get_pestpp_options().get_additional_ins_delimiters(),
+					pest_scenario.get_pestpp_options().get_atomic_model_io(),
+					pest_scenario.get_pestpp_options().get_model_plugin());
+			}
 		}
 
+		run_manager_ptr->set_sparse_run_storage(pest_scenario.get_pestpp_options().get_sparse_run_storage());
+		run_manager_ptr->set_common_attachments(pest_scenario.get_pestpp_options().get_panther_attachments());
+
 		const ParamTransformSeq &base_trans_seq = pest_scenario.get_base_par_tran_seq();
 
 		ObjectiveFunc obj_func(&(pest_scenario.get_ctl_observations()), &(pest_scenario.get_ctl_observation_info()), &(pest_scenario.get_prior_info()));
-		Jacobian *base_jacobian_ptr = new Jacobian_1to1(file_manager,output_file_writer);
+		Jacobian_1to1 *jacobian_1to1_ptr = new Jacobian_1to1(file_manager,output_file_writer);
+		jacobian_1to1_ptr->set_batch_runs(pest_scenario.get_pestpp_options().get_jac_batch_runs());
+		Jacobian *base_jacobian_ptr = jacobian_1to1_ptr;
 
 		TerminationController termination_ctl(pest_scenario.get_control_info().noptmax, pest_scenario.get_control_info().phiredstp,
 			pest_scenario.get_control_info().nphistp, pest_scenario.get_control_info().nphinored, pest_scenario.get_control_info().relparstp,
@@ -415,6 +454,8 @@ int main(int argc, char* argv[])
 			tran_svd->set_SVD_pack();
 		}
 		tran_svd->set_performance_log(&performance_log);
+		tran_svd->set_incremental(pest_scenario.get_pestpp_options().get_super_incremental(),
+			pest_scenario.get_pestpp_options().get_super_incremental_tol());
 
 		TranFixed *tr_svda_fixed = new TranFixed("SVDA Fixed Parameter Transformation");
 		trans_svda = base_trans_seq;